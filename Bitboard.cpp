@@ -0,0 +1,251 @@
+#include <cstring>
+#include <cctype>
+#include "Bitboard.h"
+#include "Evaluation.h"
+
+Bitboard knightAttacks[64];
+Bitboard kingAttacks[64];
+Bitboard pawnAttacks[2][64];
+Bitboard betweenSquares[64][64];
+
+Magic rookMagics[64];
+Magic bishopMagics[64];
+
+// Shared attack tables for all squares ("fancy" magics)
+static Bitboard rookTable[0x19000];
+static Bitboard bishopTable[0x1480];
+
+// Maps a FEN piece character to its bitboard index (0-11)
+int pieceIndex(char type) {
+    switch (type) {
+        case 'P': return PAWN;
+        case 'N': return KNIGHT;
+        case 'B': return BISHOP;
+        case 'R': return ROOK;
+        case 'Q': return QUEEN;
+        case 'K': return KING;
+        case 'p': return PAWN + 6;
+        case 'n': return KNIGHT + 6;
+        case 'b': return BISHOP + 6;
+        case 'r': return ROOK + 6;
+        case 'q': return QUEEN + 6;
+        case 'k': return KING + 6;
+        default: return -1;
+    }
+}
+
+// Maps a bitboard index back to its FEN piece character
+char pieceType(int index) {
+    return "PNBRQKpnbrqk"[index];
+}
+
+// Empties the board
+void Board::clear() {
+    memset(pieces, 0, sizeof(pieces));
+    colours[WHITE] = colours[BLACK] = occupied = 0;
+    memset(squares, 0, sizeof(squares));
+    mgScore = egScore = phase = 0;
+}
+
+// Places a piece of the given FEN type on an empty square
+void Board::addPiece(char type, int square) {
+    Bitboard bb = squareBB(square);
+    int index = pieceIndex(type);
+    pieces[index] |= bb;
+    colours[isupper(type) ? WHITE : BLACK] |= bb;
+    occupied |= bb;
+    squares[square] = type;
+    mgScore += pieceSquareMg[index][square];
+    egScore += pieceSquareEg[index][square];
+    phase += phaseWeight[index];
+    if (network) {
+        network->addPiece(*this, index, square, accumulator);
+    }
+}
+
+// Removes whatever piece stands on the square
+void Board::removePiece(int square) {
+    char type = squares[square];
+    if (type == 0) {
+        return;
+    }
+    Bitboard bb = squareBB(square);
+    int index = pieceIndex(type);
+    pieces[index] ^= bb;
+    colours[isupper(type) ? WHITE : BLACK] ^= bb;
+    occupied ^= bb;
+    squares[square] = 0;
+    mgScore -= pieceSquareMg[index][square];
+    egScore -= pieceSquareEg[index][square];
+    phase -= phaseWeight[index];
+    if (network) {
+        network->removePiece(*this, index, square, accumulator);
+    }
+}
+
+// Moves a piece to an empty square
+void Board::movePiece(int from, int to) {
+    char type = squares[from];
+    Bitboard fromTo = squareBB(from) | squareBB(to);
+    int index = pieceIndex(type);
+    pieces[index] ^= fromTo;
+    colours[isupper(type) ? WHITE : BLACK] ^= fromTo;
+    occupied ^= fromTo;
+    squares[from] = 0;
+    squares[to] = type;
+    mgScore += pieceSquareMg[index][to] - pieceSquareMg[index][from];
+    egScore += pieceSquareEg[index][to] - pieceSquareEg[index][from];
+    if (network) {
+        network->movePiece(*this, index, from, to, accumulator);
+    }
+}
+
+// Attaches a network and builds both halves of its accumulator
+void Board::setNetwork(const NnueNetwork* newNetwork) {
+    network = newNetwork;
+    if (network) {
+        network->refresh(*this, WHITE, accumulator);
+        network->refresh(*this, BLACK, accumulator);
+    }
+}
+
+// Returns the squares reachable by stepping (rowStep, colStep) from a square, if on the board
+static Bitboard stepTargets(int square, const int steps[][2], int count) {
+    Bitboard targets = 0;
+    for (int i = 0; i < count; i++) {
+        int row = squareRow(square) + steps[i][0];
+        int col = squareCol(square) + steps[i][1];
+        if (row >= 0 && row < 8 && col >= 0 && col < 8) {
+            targets |= squareBB(makeSquare(row, col));
+        }
+    }
+    return targets;
+}
+
+// Walks each ray until it leaves the board or hits a blocker (only used to build the tables)
+static Bitboard slidingAttacks(int square, Bitboard occupied, const int directions[4][2]) {
+    Bitboard attacks = 0;
+    for (int i = 0; i < 4; i++) {
+        int row = squareRow(square);
+        int col = squareCol(square);
+        while (true) {
+            row += directions[i][0];
+            col += directions[i][1];
+            if (row < 0 || row >= 8 || col < 0 || col >= 8) {
+                break;
+            }
+            attacks |= squareBB(makeSquare(row, col));
+            if (occupied & squareBB(makeSquare(row, col))) {
+                break; // Stop at the first blocker, which is included as a capture target
+            }
+        }
+    }
+    return attacks;
+}
+
+// Magic multipliers for each square, found offline with a sparse random search so that
+// every blocker subset of the mask maps to an attack-table slot without harmful collisions
+static const Bitboard rookMagicNumbers[64] = {
+    0x1080004008801020ULL, 0x0840092002C03000ULL, 0x1900200010400900ULL, 0x0880100008000480ULL,
+    0x4200100420080200ULL, 0x8100020100080400ULL, 0x0200040110886200ULL, 0x0200008040220411ULL,
+    0x0404800084400220ULL, 0x0000401000402000ULL, 0x0086001081220440ULL, 0x0408800800100280ULL,
+    0x000A001201040820ULL, 0x8848800200840080ULL, 0x4001000100040200ULL, 0x0442000102105084ULL,
+    0x9080010020804100ULL, 0x0040404000201009ULL, 0x0000808010002009ULL, 0x2200090021D00100ULL,
+    0x0008008008040080ULL, 0x0004004002010040ULL, 0x0011040008015042ULL, 0x00000A0001768104ULL,
+    0x0000800080204009ULL, 0x2010004140002001ULL, 0x9800200280100080ULL, 0x1000100080080080ULL,
+    0x0442000A00049020ULL, 0x2100040080020080ULL, 0x0800120400900148ULL, 0x0010040A00128541ULL,
+    0x2800804000800030ULL, 0x1010002000400041ULL, 0x4000200011004100ULL, 0x0610008410800800ULL,
+    0x0400802402800800ULL, 0xC100020080800400ULL, 0x0002000802000401ULL, 0x0182085882000401ULL,
+    0x0220204000808000ULL, 0x2860100040024022ULL, 0x0001002004110040ULL, 0x99101042000A0020ULL,
+    0x0004080004008080ULL, 0x0010040002008080ULL, 0x2012004881020004ULL, 0x8300842444820011ULL,
+    0x0088403882010200ULL, 0x0820400080210100ULL, 0x0110910040A00300ULL, 0x0801100280080480ULL,
+    0x0242009008200600ULL, 0x1002000489500200ULL, 0x0040800200010080ULL, 0x0091800041000080ULL,
+    0x0000209300488001ULL, 0x04C1002414824001ULL, 0x020020000B001041ULL, 0x7000100004200901ULL,
+    0x8002002004100802ULL, 0x30010002084C0007ULL, 0x0888221800813004ULL, 0x4000002840840112ULL
+};
+
+static const Bitboard bishopMagicNumbers[64] = {
+    0x10102002004A1420ULL, 0x8020040400584008ULL, 0x10510800811201C8ULL, 0x5204042080000088ULL,
+    0x2204106880000002ULL, 0x1401042004000000ULL, 0x0400880410042004ULL, 0x0028208200A02020ULL,
+    0x1500241990010E00ULL, 0x8001200182020A40ULL, 0x40004101030B0000ULL, 0x8002041042000100ULL,
+    0x4010011041020038ULL, 0x0000010421044000ULL, 0x1500210808020A00ULL, 0x8000088400880520ULL,
+    0x0405004010040100ULL, 0x1005823210040108ULL, 0x2708008102040011ULL, 0x4048200404009100ULL,
+    0x0018104101400024ULL, 0x0003000601190101ULL, 0x8004803108491000ULL, 0x8014241200820800ULL,
+    0x0006E080100C3040ULL, 0x0501044A11041800ULL, 0x9020300008004045ULL, 0x0894080000220040ULL,
+    0x1001010083104000ULL, 0x5004030040900080ULL, 0x000400422C012400ULL, 0x0002128698404812ULL,
+    0x1010108404900440ULL, 0x0928021182084100ULL, 0x2006080409020024ULL, 0x1010202020180080ULL,
+    0xA010008200202200ULL, 0x2098015100019004ULL, 0x0002041440810811ULL, 0x802A02020000B098ULL,
+    0x0009015090004060ULL, 0x4000821082081001ULL, 0x0100210040420800ULL, 0x0800004010488A00ULL,
+    0x2000081104004040ULL, 0x4C8E029015000082ULL, 0x0420340322224842ULL, 0x1298260043400210ULL,
+    0x0000822802400008ULL, 0x00008A0101600000ULL, 0x3040003412080021ULL, 0x3040290220884800ULL,
+    0x4A1500401041004AULL, 0x8010200282020781ULL, 0x0020203142209091ULL, 0x0070300600902110ULL,
+    0x0040808800B62048ULL, 0x0000810400C44420ULL, 0x00080400440C0441ULL, 0x8340080020840411ULL,
+    0x0000000104208200ULL, 0x0000800810D00080ULL, 0x0400530411080200ULL, 0x4040702400932244ULL
+};
+
+// Fills the shared attack table for every square using the precomputed magic multipliers
+static void initMagics(Magic magics[64], Bitboard* table, const Bitboard magicNumbers[64], const int directions[4][2]) {
+    // Edge squares never influence the attack set unless the piece is on that edge
+    const Bitboard rank1 = 0xFFULL, rank8 = rank1 << 56;
+    const Bitboard fileA = 0x0101010101010101ULL, fileH = fileA << 7;
+
+    Bitboard* attacks = table;
+    for (int square = 0; square < 64; square++) {
+        Bitboard edges = ((rank1 | rank8) & ~(squareRow(square) == 0 ? rank1 : squareRow(square) == 7 ? rank8 : 0))
+                       | ((fileA | fileH) & ~(squareCol(square) == 0 ? fileA : squareCol(square) == 7 ? fileH : 0));
+        Magic& m = magics[square];
+        m.mask = slidingAttacks(square, 0, directions) & ~edges;
+        m.magic = magicNumbers[square];
+        m.shift = 64 - popCount(m.mask);
+        m.attacks = attacks;
+
+        // Enumerate every subset of the mask (Carry-Rippler) and store its true attack set
+        Bitboard subset = 0;
+        do {
+            m.attacks[m.index(subset)] = slidingAttacks(square, subset, directions);
+            subset = (subset - m.mask) & m.mask;
+        } while (subset);
+
+        attacks += Bitboard(1) << popCount(m.mask);
+    }
+}
+
+// Builds the leaper and slider attack tables
+static bool buildTables() {
+    const int knightSteps[8][2] = {{2, 1}, {2, -1}, {-2, 1}, {-2, -1}, {1, 2}, {1, -2}, {-1, 2}, {-1, -2}};
+    const int kingSteps[8][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}, {1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+    const int whitePawnSteps[2][2] = {{1, -1}, {1, 1}};
+    const int blackPawnSteps[2][2] = {{-1, -1}, {-1, 1}};
+    const int rookDirections[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+    const int bishopDirections[4][2] = {{1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+
+    for (int square = 0; square < 64; square++) {
+        knightAttacks[square] = stepTargets(square, knightSteps, 8);
+        kingAttacks[square] = stepTargets(square, kingSteps, 8);
+        pawnAttacks[WHITE][square] = stepTargets(square, whitePawnSteps, 2);
+        pawnAttacks[BLACK][square] = stepTargets(square, blackPawnSteps, 2);
+    }
+
+    initMagics(rookMagics, rookTable, rookMagicNumbers, rookDirections);
+    initMagics(bishopMagics, bishopTable, bishopMagicNumbers, bishopDirections);
+
+    // Two squares on a shared rank, file or diagonal see each other on an empty board; the squares
+    // between them are those both rays cover when each square blocks the other's ray
+    for (int from = 0; from < 64; from++) {
+        for (int to = 0; to < 64; to++) {
+            betweenSquares[from][to] = 0;
+            if (rookAttacks(from, 0) & squareBB(to)) {
+                betweenSquares[from][to] = rookAttacks(from, squareBB(to)) & rookAttacks(to, squareBB(from));
+            } else if (bishopAttacks(from, 0) & squareBB(to)) {
+                betweenSquares[from][to] = bishopAttacks(from, squareBB(to)) & bishopAttacks(to, squareBB(from));
+            }
+        }
+    }
+    return true;
+}
+
+// Builds the attack tables once; the function-local static makes this thread safe
+void initBitboards() {
+    static const bool initialised = buildTables();
+    (void)initialised;
+}
@@ -0,0 +1,108 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <cstdint>
+#include "Nnue.h"
+
+using namespace std;
+
+// A set of board squares, one bit per square (bit 0 = A1, bit 63 = H8)
+typedef uint64_t Bitboard;
+
+// Colour indices used by the bitboard position
+const int WHITE = 0;
+const int BLACK = 1;
+
+// Piece type indices, black pieces are offset by 6 (e.g. 'n' -> KNIGHT + 6)
+enum PieceIndex { PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING };
+
+// Square index helpers: square = row * 8 + col, row 0 is rank 1 and col 0 is file A
+inline int makeSquare(int row, int col) { return row * 8 + col; }
+inline int squareRow(int square) { return square >> 3; }
+inline int squareCol(int square) { return square & 7; }
+inline Bitboard squareBB(int square) { return Bitboard(1) << square; }
+
+// Returns the index of the least significant set bit (bb must not be empty)
+inline int lsb(Bitboard bb) { return __builtin_ctzll(bb); }
+// Removes the least significant set bit and returns its index
+inline int popLsb(Bitboard& bb) { int square = lsb(bb); bb &= bb - 1; return square; }
+// Returns the number of set bits
+inline int popCount(Bitboard bb) { return __builtin_popcountll(bb); }
+
+// Maps a FEN piece character to its bitboard index (0-11), or -1 if it is not a piece
+int pieceIndex(char type);
+// Maps a bitboard index (0-11) back to its FEN piece character
+char pieceType(int index);
+
+// Builds the attack tables; safe to call more than once and from several threads
+void initBitboards();
+
+// Precomputed leaper attacks
+extern Bitboard knightAttacks[64];
+extern Bitboard kingAttacks[64];
+extern Bitboard pawnAttacks[2][64]; // indexed by the colour of the attacking pawn
+// Squares strictly between two squares on a shared rank, file or diagonal; 0 if they share none
+extern Bitboard betweenSquares[64][64];
+
+// Magic bitboard entry for one square: index = ((occupied & mask) * magic) >> shift
+struct Magic {
+  Bitboard mask;
+  Bitboard magic;
+  Bitboard* attacks;
+  unsigned shift;
+
+  unsigned index(Bitboard occupied) const {
+    return unsigned(((occupied & mask) * magic) >> shift);
+  }
+};
+
+extern Magic rookMagics[64];
+extern Magic bishopMagics[64];
+
+// Slider attacks from a square given the board occupancy (includes the first blocker)
+inline Bitboard rookAttacks(int square, Bitboard occupied) {
+  const Magic& m = rookMagics[square];
+  return m.attacks[m.index(occupied)];
+}
+
+inline Bitboard bishopAttacks(int square, Bitboard occupied) {
+  const Magic& m = bishopMagics[square];
+  return m.attacks[m.index(occupied)];
+}
+
+inline Bitboard queenAttacks(int square, Bitboard occupied) {
+  return rookAttacks(square, occupied) | bishopAttacks(square, occupied);
+}
+
+// Bitboard position: one 64-bit set per piece type plus colour occupancy
+struct Board {
+  Bitboard pieces[12];  // indexed by pieceIndex()
+  Bitboard colours[2];  // all pieces of each colour
+  Bitboard occupied;    // all pieces
+  char squares[64];     // FEN piece character on each square, or 0 when empty
+  // Evaluation terms summed over the pieces (see Evaluation.h), kept up to date by the three
+  // piece operations below so the static evaluation never has to scan the board
+  int mgScore;          // middlegame material and piece-square score, white minus black
+  int egScore;          // endgame material and piece-square score, white minus black
+  int phase;            // game phase, MAX_PHASE for the full starting material
+  // Optional neural network evaluation: when a network is attached, the three piece operations
+  // also keep its accumulator up to date (see Nnue.h)
+  const NnueNetwork* network = nullptr;
+  NnueAccumulator accumulator;
+
+  // Empties the board
+  void clear();
+  // Places a piece of the given FEN type on an empty square
+  void addPiece(char type, int square);
+  // Removes whatever piece stands on the square
+  void removePiece(int square);
+  // Moves a piece to an empty square
+  void movePiece(int from, int to);
+  // Attaches a network (nullptr detaches it) and computes its accumulator from scratch
+  void setNetwork(const NnueNetwork* newNetwork);
+
+  // Returns the piece of the given type/colour bitboard
+  Bitboard piecesOf(int colour, PieceIndex index) const { return pieces[index + 6 * colour]; }
+};
+
+#endif // BITBOARD_H
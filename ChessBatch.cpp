@@ -0,0 +1,172 @@
+#include "ChessGame.h"
+#include "WorkQueues.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+using std::cout;
+using std::cerr;
+
+/* Positions are handed between threads in chunks to keep synchronisation cheap */
+static const size_t CHUNK_SIZE = 512;
+
+/* A numbered run of input positions, in FEN form */
+struct PositionChunk {
+	size_t sequence;
+	std::vector<std::string> fens;
+};
+
+/* Analysis of one position */
+struct PositionResult {
+	unsigned long long legalMoves;
+	const char* status; // "normal", "check", "checkmate", "stalemate" or "invalid"
+};
+
+/* The analysed positions of one chunk */
+struct ResultChunk {
+	std::vector<PositionResult> results;
+	std::vector<std::string> fens;
+};
+
+/* Turns an EPD or FEN line into the FEN fields the loader needs (placement, side, castling,
+   en passant); returns false for blank lines and comments */
+static bool extractFen(const std::string& line, std::string& fen) {
+	std::istringstream fields(line);
+	std::string field;
+	fen.clear();
+	for (int i = 0; i < 4 && fields >> field; i++) {
+		if (i == 0 && field[0] == '#') {
+			return false;
+		}
+		if (i > 0) {
+			fen += ' ';
+		}
+		fen += field;
+	}
+	return !fen.empty();
+}
+
+/* Legal move count and check/checkmate/stalemate status of a position */
+static PositionResult analysePosition(ChessGame& cg, const std::string& fen) {
+	PositionResult result;
+	// A malformed line is reported in the output rather than stopping the run
+	if (!cg.parseFen(fen).ok()) {
+		result.legalMoves = 0;
+		result.status = "invalid";
+		return result;
+	}
+
+	static const char* statusNames[] = {"normal", "check", "checkmate", "stalemate"};
+	result.status = statusNames[cg.computeGameStatus()];
+	result.legalMoves = cg.legalMoveList().size();
+	return result;
+}
+
+/* Usage:
+     Batch <input.epd> [output|-] [threads]
+   Writes one line per position, in input order: "<fen>\t<legal moves>\t<status>" */
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		cerr << "Usage: " << argv[0] << " <input.epd> [output|-] [threads]\n";
+		return 1;
+	}
+
+	std::ifstream input(argv[1]);
+	if (!input) {
+		cerr << "Cannot open " << argv[1] << '\n';
+		return 1;
+	}
+
+	std::ofstream outputFile;
+	if (argc > 2 && strcmp(argv[2], "-") != 0) {
+		outputFile.open(argv[2]);
+		if (!outputFile) {
+			cerr << "Cannot open " << argv[2] << " for writing\n";
+			return 1;
+		}
+	}
+	std::ostream& output = outputFile.is_open() ? outputFile : cout;
+
+	int hardwareThreads = int(std::thread::hardware_concurrency());
+	int workerCount = argc > 3 ? atoi(argv[3]) : (hardwareThreads > 0 ? hardwareThreads : 1);
+	if (workerCount < 1) {
+		workerCount = 1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	ChunkQueue<PositionChunk> work(size_t(workerCount) * 4);
+	ResultQueue<ResultChunk> done(size_t(workerCount) * 4);
+
+	// Reader: parses lines into chunks of FENs
+	std::thread reader([&] {
+		std::string line, fen;
+		size_t sequence = 0;
+		PositionChunk chunk{sequence, {}};
+		while (std::getline(input, line)) {
+			if (!extractFen(line, fen)) {
+				continue;
+			}
+			chunk.fens.push_back(fen);
+			if (chunk.fens.size() == CHUNK_SIZE) {
+				work.push(std::move(chunk));
+				chunk = PositionChunk{++sequence, {}};
+			}
+		}
+		if (!chunk.fens.empty()) {
+			work.push(std::move(chunk));
+			sequence++;
+		}
+		done.setChunkCount(sequence);
+		work.close();
+	});
+
+	// Workers: one ChessGame each, reused for every position
+	std::vector<std::thread> workers;
+	for (int i = 0; i < workerCount; i++) {
+		workers.emplace_back([&] {
+			ChessGame cg;
+			PositionChunk chunk;
+			while (work.pop(chunk)) {
+				ResultChunk finished;
+				finished.results.reserve(chunk.fens.size());
+				for (const std::string& fen : chunk.fens) {
+					finished.results.push_back(analysePosition(cg, fen));
+				}
+				finished.fens = std::move(chunk.fens);
+				done.put(chunk.sequence, std::move(finished));
+			}
+		});
+	}
+
+	// Writer (this thread): emits chunks strictly in input order
+	size_t positions = 0;
+	ResultChunk chunk;
+	for (size_t sequence = 0; done.take(sequence, chunk); sequence++) {
+		for (size_t i = 0; i < chunk.results.size(); i++) {
+			output << chunk.fens[i] << '\t' << chunk.results[i].legalMoves << '\t' << chunk.results[i].status << '\n';
+		}
+		positions += chunk.results.size();
+	}
+	output.flush();
+
+	reader.join();
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	double perSecond = elapsed.count() > 0 ? positions / elapsed.count() : 0;
+	cerr << "Positions: " << positions
+	     << "  Time: " << (long long)(elapsed.count() * 1000) << " ms"
+	     << "  Positions/s: " << (unsigned long long)perSecond
+	     << "  Per core: " << (unsigned long long)(perSecond / workerCount)
+	     << " (" << workerCount << " workers)\n";
+	return 0;
+}
@@ -0,0 +1,273 @@
+#include "ChessGame.h"
+#include "TranspositionTable.h"
+#include "OpeningBook.h"
+#include "Nnue.h"
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <chrono>
+
+using std::cout;
+
+/* Middlegame positions used for the search benchmarks */
+static const char* benchPositions[] = {
+	"r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4",
+	"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+	"r2q1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP3PPP/R2QKB1R w KQ - 0 9",
+	"2r2rk1/pp1bqppp/2n1pn2/3p4/3P4/2PBPN2/P2N1PPP/R2Q1RK1 w - - 0 12",
+};
+
+/* Lazy SMP scaling: time to reach a fixed depth and nodes/second for 1, 2, 4, ... threads */
+static int benchSmp(int maxThreads, int depth) {
+	cout << "Lazy SMP benchmark: depth " << depth << ", "
+	     << sizeof(benchPositions) / sizeof(benchPositions[0]) << " positions, up to "
+	     << maxThreads << " threads\n\n";
+	cout << std::setw(8) << "Threads" << std::setw(12) << "Time (ms)" << std::setw(14) << "Nodes"
+	     << std::setw(12) << "NPS" << std::setw(10) << "Speedup" << std::setw(12) << "NPS ratio" << '\n';
+
+	// Powers of two up to the maximum, plus the maximum itself
+	std::vector<int> threadCounts;
+	for (int threads = 1; threads < maxThreads; threads *= 2) {
+		threadCounts.push_back(threads);
+	}
+	threadCounts.push_back(maxThreads);
+
+	TranspositionTable table(64);
+	double baseTime = 0, baseNps = 0;
+
+	for (int threads : threadCounts) {
+		int64_t totalTime = 0;
+		uint64_t totalNodes = 0;
+		for (const char* fen : benchPositions) {
+			ChessGame cg;
+			cg.loadState(fen, false);
+			table.clear();
+
+			SearchLimits limits;
+			limits.depth = depth;
+			limits.threads = threads;
+			SearchResult result = parallelSearch(cg, limits, table);
+			totalTime += result.timeMs;
+			totalNodes += result.nodes;
+		}
+
+		double nps = totalTime > 0 ? totalNodes * 1000.0 / totalTime : 0;
+		if (threads == 1) {
+			baseTime = double(totalTime);
+			baseNps = nps;
+		}
+		cout << std::setw(8) << threads << std::setw(12) << totalTime << std::setw(14) << totalNodes
+		     << std::setw(12) << (uint64_t)nps
+		     << std::setw(10) << std::fixed << std::setprecision(2) << (totalTime > 0 ? baseTime / totalTime : 0)
+		     << std::setw(12) << (baseNps > 0 ? nps / baseNps : 0) << '\n';
+	}
+	return 0;
+}
+
+/* FEN throughput: parse and write back every benchmark position many times */
+static int benchFen(int iterations) {
+	const int positionCount = sizeof(benchPositions) / sizeof(benchPositions[0]);
+	ChessGame cg;
+
+	// Every position must survive a round trip unchanged before it is timed
+	for (const char* fen : benchPositions) {
+		if (!cg.parseFen(fen).ok() || cg.toFen() != fen) {
+			std::cerr << "Round trip failed for " << fen << '\n';
+			return 1;
+		}
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	int failures = 0;
+	for (int i = 0; i < iterations; i++) {
+		for (const char* fen : benchPositions) {
+			failures += !cg.parseFen(fen).ok();
+		}
+	}
+	std::chrono::duration<double, std::nano> parseTime = std::chrono::steady_clock::now() - start;
+
+	start = std::chrono::steady_clock::now();
+	size_t written = 0;
+	for (int i = 0; i < iterations; i++) {
+		written += cg.toFen().size();
+	}
+	std::chrono::duration<double, std::nano> writeTime = std::chrono::steady_clock::now() - start;
+
+	long long parses = (long long)iterations * positionCount;
+	cout << "FEN benchmark: " << parses << " parses, " << iterations << " writes\n";
+	cout << "Parse: " << std::fixed << std::setprecision(1) << parseTime.count() / parses << " ns/position\n";
+	cout << "Write: " << writeTime.count() / iterations << " ns/position (" << written / iterations << " chars)\n";
+	return failures ? 1 : 0;
+}
+
+/* Move making: perft on the legal move generator with makeMove/unmakeMove against the older
+   temporary-move path (pseudo-legal moves, each played and tested for king safety) on the same
+   positions. The older path has no castling, en passant or promotion, so its node counts can be
+   slightly lower. */
+static int benchMakeMove(int depth) {
+	cout << "Move making benchmark: perft depth " << depth << "\n\n";
+	cout << std::setw(20) << "Path" << std::setw(14) << "Nodes" << std::setw(12) << "Time (ms)" << std::setw(12) << "NPS" << '\n';
+
+	const char* pathNames[] = {"legal moves", "temporary moves"};
+	for (int path = 0; path < 2; path++) {
+		uint64_t totalNodes = 0;
+		double totalSeconds = 0;
+		for (const char* fen : benchPositions) {
+			ChessGame cg;
+			cg.parseFen(fen);
+			auto start = std::chrono::steady_clock::now();
+			totalNodes += path == 0 ? cg.perft(depth) : cg.perftTemporaryMoves(depth);
+			totalSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+		cout << std::setw(20) << pathNames[path] << std::setw(14) << totalNodes
+		     << std::setw(12) << (int64_t)(totalSeconds * 1000)
+		     << std::setw(12) << (uint64_t)(totalSeconds > 0 ? totalNodes / totalSeconds : 0) << '\n';
+	}
+	return 0;
+}
+
+/* Opening book lookups: time per probe of the memory-mapped book, over the initial position and the
+   benchmark positions (mostly misses, which cost the same binary search) */
+static int benchBook(const char* bookPath, int iterations) {
+	OpeningBook book;
+	BookStatus status = book.open(bookPath);
+	if (status != BOOK_OK) {
+		std::cerr << bookPath << ": " << bookStatusMessage(status) << '\n';
+		return 1;
+	}
+	cout << "Opening book benchmark: " << book.size() << " entries\n\n";
+
+	ChessGame games[5];
+	games[0].parseFen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+	for (int index = 0; index < 4; index++) {
+		games[index + 1].parseFen(benchPositions[index]);
+	}
+
+	BookMove moves[MoveList::CAPACITY];
+	int found = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (int iteration = 0; iteration < iterations; iteration++) {
+		for (const ChessGame& game : games) {
+			found += book.probe(game, moves, MoveList::CAPACITY);
+		}
+	}
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+	int count = book.probe(games[0], moves, MoveList::CAPACITY);
+	cout << "Initial position:";
+	for (int index = 0; index < count; index++) {
+		cout << ' ' << moves[index].move.toString() << " (" << moves[index].weight << ')';
+	}
+	cout << (count ? "\n" : " not in book\n");
+	cout << "Probe: " << (int64_t)(elapsed.count() / (iterations * 5.0)) << " ns/position ("
+	     << found / iterations << " moves found per round)\n";
+	return 0;
+}
+
+/* Counts the nodes of the legal move tree, evaluating each one: with the accumulator the board keeps
+   up to date, or rebuilt from scratch as an evaluator without incremental updates would */
+static uint64_t evaluateTree(ChessGame& game, int depth, bool incremental, int64_t& checksum) {
+	checksum += incremental ? game.evaluate() : (game.isWhiteToMove() ? 1 : -1) * game.evaluateFromScratch();
+	if (depth == 0) {
+		return 1;
+	}
+	MoveList moves;
+	game.generateLegalMoves(moves);
+	uint64_t nodes = 1;
+	for (Move move : moves) {
+		game.makeMove(move);
+		nodes += evaluateTree(game, depth - 1, incremental, checksum);
+		game.unmakeMove();
+	}
+	return nodes;
+}
+
+/* Neural network evaluation: evaluations/second over the benchmark trees for each instruction set
+   the processor supports, with incremental accumulator updates and with a full rebuild per node.
+   Without a weights file a random network of the same shape is used, which costs the same */
+static int benchNnue(const char* weightsPath, int depth) {
+	NnueNetwork network;
+	if (weightsPath) {
+		NnueStatus status = network.load(weightsPath);
+		if (status != NNUE_OK) {
+			std::cerr << weightsPath << ": " << nnueStatusMessage(status) << '\n';
+			return 1;
+		}
+	} else {
+		network.randomize(1);
+	}
+	cout << "NNUE benchmark: every node to depth " << depth << "\n\n";
+	cout << std::setw(10) << "Kernels" << std::setw(14) << "Accumulator" << std::setw(12) << "Nodes"
+	     << std::setw(12) << "Time (ms)" << std::setw(14) << "Evals/s" << std::setw(12) << "Checksum" << '\n';
+
+	NnueSimd bestSimd = nnueSimd();
+	for (NnueSimd simd : {NNUE_SCALAR, NNUE_SSE41, NNUE_AVX2}) {
+		if (!setNnueSimd(simd)) {
+			continue;
+		}
+		for (bool incremental : {true, false}) {
+			uint64_t nodes = 0;
+			int64_t checksum = 0;
+			auto start = std::chrono::steady_clock::now();
+			for (const char* fen : benchPositions) {
+				ChessGame cg;
+				cg.parseFen(fen);
+				cg.setNetwork(&network);
+				nodes += evaluateTree(cg, depth, incremental, checksum);
+			}
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			cout << std::setw(10) << nnueSimdName(simd) << std::setw(14) << (incremental ? "incremental" : "rebuilt")
+			     << std::setw(12) << nodes << std::setw(12) << (int64_t)(seconds * 1000)
+			     << std::setw(14) << (uint64_t)(seconds > 0 ? nodes / seconds : 0) << std::setw(12) << checksum << '\n';
+		}
+	}
+	setNnueSimd(bestSimd);
+	return 0;
+}
+
+/* Usage:
+     Bench smp [maxThreads] [depth]   Lazy SMP speedup versus thread count (default: all cores, depth 7)
+     Bench fen [iterations]           FEN parse/write time per position (default: 200000 rounds)
+     Bench makemove [depth]           perft nodes/second, legal generator versus temporary moves (default: depth 4)
+     Bench book <book.bin> [iterations] Polyglot book probe time (default: 100000 rounds)
+     Bench nnue [weights|random] [depth] network evaluations/second per instruction set, incremental versus
+                                      rebuilt accumulators (default: random weights, depth 3) */
+int main(int argc, char** argv) {
+	if (argc >= 2 && strcmp(argv[1], "smp") == 0) {
+		int hardwareThreads = int(std::thread::hardware_concurrency());
+		int maxThreads = argc > 2 ? atoi(argv[2]) : (hardwareThreads > 0 ? hardwareThreads : 1);
+		int depth = argc > 3 ? atoi(argv[3]) : 7;
+		return benchSmp(maxThreads > 0 ? maxThreads : 1, depth);
+	}
+
+	if (argc >= 2 && strcmp(argv[1], "fen") == 0) {
+		int iterations = argc > 2 ? atoi(argv[2]) : 200000;
+		return benchFen(iterations > 0 ? iterations : 1);
+	}
+
+	if (argc >= 2 && strcmp(argv[1], "makemove") == 0) {
+		int depth = argc > 2 ? atoi(argv[2]) : 4;
+		return benchMakeMove(depth > 0 ? depth : 1);
+	}
+
+	if (argc >= 3 && strcmp(argv[1], "book") == 0) {
+		int iterations = argc > 3 ? atoi(argv[3]) : 100000;
+		return benchBook(argv[2], iterations > 0 ? iterations : 1);
+	}
+
+	if (argc >= 2 && strcmp(argv[1], "nnue") == 0) {
+		const char* weightsPath = argc > 2 && strcmp(argv[2], "random") != 0 ? argv[2] : nullptr;
+		int depth = argc > 3 ? atoi(argv[3]) : 3;
+		return benchNnue(weightsPath, depth > 0 ? depth : 1);
+	}
+
+	std::cerr << "Usage: " << argv[0] << " smp [maxThreads] [depth]\n"
+	          << "       " << argv[0] << " fen [iterations]\n"
+	          << "       " << argv[0] << " makemove [depth]\n"
+	          << "       " << argv[0] << " book <book.bin> [iterations]\n"
+	          << "       " << argv[0] << " nnue [weights|random] [depth]\n";
+	return 1;
+}
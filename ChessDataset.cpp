@@ -0,0 +1,301 @@
+#include "ChessGame.h"
+#include "Dataset.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+using std::cout;
+using std::cerr;
+
+/* Records are streamed in chunks of this many */
+static const size_t CHUNK_RECORDS = 4096;
+
+/* Turns an EPD or FEN line into FEN fields: the four position fields, plus the two clocks when the
+   line is a full FEN. Returns false for blank lines and comments */
+static bool extractFen(const std::string& line, std::string& fen) {
+	std::istringstream fields(line);
+	std::string field;
+	fen.clear();
+	for (int i = 0; i < 6 && fields >> field; i++) {
+		if (i == 0 && field[0] == '#') {
+			return false;
+		}
+		// EPD opcodes follow the fourth field; only numbers can be clocks
+		if (i >= 4 && field.find_first_not_of("0123456789") != std::string::npos) {
+			break;
+		}
+		if (i > 0) {
+			fen += ' ';
+		}
+		fen += field;
+	}
+	return !fen.empty();
+}
+
+/* Seconds since a starting point */
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/* Converts FEN/EPD lines to a dataset, skipping (and counting) lines that do not parse */
+static int pack(const char* inputPath, const char* outputPath, bool withIndex) {
+	std::ifstream inputFile;
+	if (strcmp(inputPath, "-") != 0) {
+		inputFile.open(inputPath);
+		if (!inputFile) {
+			cerr << "Cannot open " << inputPath << '\n';
+			return 1;
+		}
+	}
+	std::istream& input = inputFile.is_open() ? inputFile : std::cin;
+
+	DatasetWriter writer;
+	DatasetStatus status = writer.open(outputPath, withIndex);
+	if (status != DATASET_OK) {
+		cerr << outputPath << ": " << datasetStatusMessage(status) << '\n';
+		return 1;
+	}
+	ChessGame cg;
+	cg.setOutput(nullptr);
+	std::string line, fen;
+	size_t skipped = 0, textBytes = 0;
+	auto start = std::chrono::steady_clock::now();
+	while (std::getline(input, line)) {
+		textBytes += line.size() + 1;
+		if (!extractFen(line, fen)) {
+			continue;
+		}
+		if (!cg.parseFen(fen).ok() || !writer.add(cg)) {
+			skipped++;
+		}
+	}
+	uint64_t records = writer.size();
+	status = writer.finish();
+	if (status != DATASET_OK) {
+		cerr << outputPath << ": " << datasetStatusMessage(status) << '\n';
+		return 1;
+	}
+	cerr << "Records: " << records << "  Skipped: " << skipped
+	     << "  Text: " << textBytes << " bytes  Records: " << records * sizeof(PackedPosition) << " bytes"
+	     << "  Time: " << (long long)(secondsSince(start) * 1000) << " ms\n";
+	return 0;
+}
+
+/* Streams a dataset back out as FEN (or four-field EPD) lines */
+static int unpack(const char* inputPath, const char* outputPath, bool epd) {
+	DatasetReader reader;
+	DatasetStatus status = reader.open(inputPath);
+	if (status != DATASET_OK) {
+		cerr << inputPath << ": " << datasetStatusMessage(status) << '\n';
+		return 1;
+	}
+	std::ofstream outputFile;
+	if (strcmp(outputPath, "-") != 0) {
+		outputFile.open(outputPath);
+		if (!outputFile) {
+			cerr << "Cannot open " << outputPath << " for writing\n";
+			return 1;
+		}
+	}
+	std::ostream& output = outputFile.is_open() ? outputFile : cout;
+
+	ChessGame cg;
+	cg.setOutput(nullptr);
+	std::vector<PackedPosition> chunk(CHUNK_RECORDS);
+	uint64_t written = 0, invalid = 0;
+	while (size_t count = reader.read(chunk.data(), chunk.size())) {
+		for (size_t i = 0; i < count; i++) {
+			if (!cg.unpack(chunk[i])) {
+				invalid++;
+				continue;
+			}
+			std::string fen = cg.toFen();
+			if (epd) {
+				// Drop the two clock fields
+				fen.resize(fen.rfind(' ', fen.rfind(' ') - 1));
+			}
+			output << fen << '\n';
+			written++;
+		}
+	}
+	output.flush();
+	if (written + invalid != reader.size()) {
+		cerr << inputPath << ": file ends after " << written + invalid << " of " << reader.size() << " records\n";
+		return 1;
+	}
+	if (invalid) {
+		cerr << invalid << " invalid records skipped\n";
+	}
+	return 0;
+}
+
+/* Lists the records holding a position, through the index when the file has one */
+static int find(const char* inputPath, const char* fen) {
+	ChessGame cg;
+	cg.setOutput(nullptr);
+	FenResult parsed = cg.parseFen(fen);
+	if (!parsed.ok()) {
+		cerr << "Invalid FEN: " << fenStatusMessage(parsed.status) << " at character " << parsed.position << '\n';
+		return 1;
+	}
+	Dataset dataset;
+	DatasetStatus status = dataset.open(inputPath, false);
+	if (status != DATASET_OK) {
+		cerr << inputPath << ": " << datasetStatusMessage(status) << '\n';
+		return 1;
+	}
+
+	std::vector<uint64_t> matches;
+	if (dataset.hasIndex()) {
+		matches.resize(64);
+		matches.resize(dataset.find(cg.getHashKey(), matches.data(), matches.size()));
+		if (matches.size() > 64) {
+			dataset.find(cg.getHashKey(), matches.data(), matches.size());
+		}
+	} else {
+		// Without an index every record is compared, clocks aside
+		PackedPosition wanted;
+		cg.pack(wanted);
+		size_t compared = offsetof(PackedPosition, halfmoveClock);
+		for (uint64_t record = 0; record < dataset.size(); record++) {
+			if (memcmp(&dataset[record], &wanted, compared) == 0) {
+				matches.push_back(record);
+			}
+		}
+	}
+	for (uint64_t record : matches) {
+		cg.unpack(dataset[record]);
+		cout << record << '\t' << cg.toFen() << '\n';
+	}
+	cerr << matches.size() << " matching records" << (dataset.hasIndex() ? " (index)" : " (scan)") << '\n';
+	return 0;
+}
+
+/* Prints one benchmark line */
+static void report(const char* name, uint64_t positions, uint64_t bytes, double seconds) {
+	cout << name << ": " << positions << " positions in " << (long long)(seconds * 1000) << " ms, "
+	     << (unsigned long long)(seconds > 0 ? positions / seconds : 0) << " positions/s, "
+	     << (unsigned long long)(seconds > 0 ? bytes / seconds / 1e6 : 0) << " MB/s\n";
+}
+
+/* Read throughput: the mapped records scanned raw and decoded into a ChessGame, the same through
+   chunked reads, and FEN text parsed into a ChessGame (the given file, or the dataset written out
+   as FEN in memory) */
+static int bench(const char* inputPath, const char* textPath) {
+	Dataset dataset;
+	DatasetStatus status = dataset.open(inputPath);
+	if (status != DATASET_OK) {
+		cerr << inputPath << ": " << datasetStatusMessage(status) << '\n';
+		return 1;
+	}
+	uint64_t count = dataset.size();
+	uint64_t recordBytes = count * sizeof(PackedPosition);
+	ChessGame cg;
+	cg.setOutput(nullptr);
+	uint64_t checksum = 0;
+
+	// Raw scan: one read of every record, the floor for any analysis pass
+	auto start = std::chrono::steady_clock::now();
+	for (uint64_t record = 0; record < count; record++) {
+		checksum += popCount(dataset[record].occupied) + dataset[record].flags;
+	}
+	report("Mapped scan", count, recordBytes, secondsSince(start));
+
+	start = std::chrono::steady_clock::now();
+	for (uint64_t record = 0; record < count; record++) {
+		checksum += cg.unpack(dataset[record]) ? cg.getHashKey() : 0;
+	}
+	report("Mapped decode", count, recordBytes, secondsSince(start));
+
+	DatasetReader reader;
+	reader.open(inputPath);
+	std::vector<PackedPosition> chunk(CHUNK_RECORDS);
+	uint64_t streamed = 0;
+	start = std::chrono::steady_clock::now();
+	while (size_t read = reader.read(chunk.data(), chunk.size())) {
+		for (size_t i = 0; i < read; i++) {
+			checksum += cg.unpack(chunk[i]) ? cg.getHashKey() : 0;
+		}
+		streamed += read;
+	}
+	report("Streamed decode", streamed, streamed * sizeof(PackedPosition), secondsSince(start));
+
+	// FEN text, held in memory so only parsing is timed
+	std::vector<std::string> lines;
+	if (textPath) {
+		std::ifstream text(textPath);
+		if (!text) {
+			cerr << "Cannot open " << textPath << '\n';
+			return 1;
+		}
+		std::string line, fen;
+		while (std::getline(text, line)) {
+			if (extractFen(line, fen)) {
+				lines.push_back(fen);
+			}
+		}
+	} else {
+		lines.reserve(count);
+		for (uint64_t record = 0; record < count; record++) {
+			if (cg.unpack(dataset[record])) {
+				lines.push_back(cg.toFen());
+			}
+		}
+	}
+	uint64_t textBytes = 0;
+	for (const std::string& line : lines) {
+		textBytes += line.size() + 1;
+	}
+	start = std::chrono::steady_clock::now();
+	for (const std::string& line : lines) {
+		checksum += cg.parseFen(line).ok() ? cg.getHashKey() : 0;
+	}
+	report("FEN parse", lines.size(), textBytes, secondsSince(start));
+	cout << "Bytes per position: " << sizeof(PackedPosition) << " binary, "
+	     << (lines.empty() ? 0.0 : double(textBytes) / lines.size()) << " FEN text"
+	     << "  (checksum " << checksum % 1000000 << ")\n";
+	return 0;
+}
+
+/* Usage:
+     Dataset pack <positions.epd|-> <output.cpd> [--index]
+     Dataset unpack <input.cpd|-> [output|-] [--epd]
+     Dataset find <input.cpd> "<fen>"
+     Dataset bench <input.cpd> [positions.fen] */
+int main(int argc, char** argv) {
+	bool withIndex = false, epd = false;
+	std::vector<const char*> args;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--index") == 0) {
+			withIndex = true;
+		} else if (strcmp(argv[i], "--epd") == 0) {
+			epd = true;
+		} else {
+			args.push_back(argv[i]);
+		}
+	}
+
+	if (args.size() >= 3 && strcmp(args[0], "pack") == 0) {
+		return pack(args[1], args[2], withIndex);
+	}
+	if (args.size() >= 2 && strcmp(args[0], "unpack") == 0) {
+		return unpack(args[1], args.size() > 2 ? args[2] : "-", epd);
+	}
+	if (args.size() >= 3 && strcmp(args[0], "find") == 0) {
+		return find(args[1], args[2]);
+	}
+	if (args.size() >= 2 && strcmp(args[0], "bench") == 0) {
+		return bench(args[1], args.size() > 2 ? args[2] : nullptr);
+	}
+	cerr << "Usage: " << argv[0] << " pack <positions.epd|-> <output.cpd> [--index]\n"
+	     << "       " << argv[0] << " unpack <input.cpd|-> [output|-] [--epd]\n"
+	     << "       " << argv[0] << " find <input.cpd> \"<fen>\"\n"
+	     << "       " << argv[0] << " bench <input.cpd> [positions.fen]\n";
+	return 1;
+}
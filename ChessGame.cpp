@@ -1,296 +1,837 @@
 #include <iostream>
-#include <vector>
 #include <string>
+#include <string_view>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+#include <cassert>
 #include "ChessPiece.h"
 #include "ChessGame.h"
+#include "Zobrist.h"
+#include "Evaluation.h"
+#include "TranspositionTable.h"
 
 using namespace std;
 
 /* Constructor */
-ChessGame::ChessGame() {    
+ChessGame::ChessGame() {
+    initBitboards(); // Build the attack tables on first use
+    initZobrist();
+    initEvaluation();
+    board.clear();
+    kingSquare[WHITE] = kingSquare[BLACK] = -1;
+    whiteToMove = true;
+    castlingRights = 0;
+    enPassantSquare = -1;
+    halfmoveClock = 0;
+    fullmoveNumber = 1;
+    undoCount = 0;
+    cachedMovesValid = false;
+    hashKey = computeHashKey();
+    output = &consoleSink();
 }
 
-  
-/* Destructor */
-ChessGame::~ChessGame() {
-    for (int i = 0; i < 8; i++) {
-        for (int j = 0; j < 8; j++) {
-            delete board[i][j];  // Deallocate any dynamically allocated chess pieces
-        }
+
+/* Returns a human-readable description of a FEN parse status */
+const char* fenStatusMessage(FenStatus status) {
+    switch (status) {
+        case FEN_OK: return "OK";
+        case FEN_BAD_PLACEMENT: return "Invalid piece placement";
+        case FEN_BAD_KINGS: return "Each side needs exactly one king";
+        case FEN_BAD_SIDE: return "Invalid active color";
+        case FEN_BAD_CASTLING: return "Invalid castling rights";
+        case FEN_BAD_EN_PASSANT: return "Invalid en passant square";
+        case FEN_BAD_CLOCK: return "Invalid halfmove clock or fullmove number";
+        case FEN_TRAILING_TEXT: return "Unexpected text after the last field";
     }
+    return "Unknown error";
 }
 
-/* Loads the board state from a FEN string */
-void ChessGame::loadState(const char* fen){
-    cout << "A new board state is loaded!" << endl;
+/* Splits off the next space-separated field, recording where it starts; empty at end of input */
+static string_view nextFenField(string_view fen, size_t& position, size_t& fieldStart) {
+    while (position < fen.size() && fen[position] == ' ') {
+        position++;
+    }
+    fieldStart = position;
+    while (position < fen.size() && fen[position] != ' ') {
+        position++;
+    }
+    return fen.substr(fieldStart, position - fieldStart);
+}
 
-    // Initialize the board by clearing existing pieces
-    for (int i = 0; i < 8; i++) {
-        for (int j = 0; j < 8; j++) {
-            board[i][j] = nullptr; // Initialize all squares to nullptr (empty)
+/* Parses a non-negative decimal number; returns false if the field has anything else in it */
+static bool parseFenNumber(string_view field, int& value) {
+    if (field.empty() || field.size() > 6) {
+        return false;
+    }
+    value = 0;
+    for (char ch : field) {
+        if (ch < '0' || ch > '9') {
+            return false;
         }
+        value = value * 10 + (ch - '0');
     }
-    
-    // Part 2: Parse the FEN string for board setup
-    int row = 7, col = 0; // Start parsing from the top-left corner
-    int fileSt = 0;
-
-    while (fen[fileSt] != ' ' && fen[fileSt] != '\0') {  // Loop until space or end of string
-        char ch = fen[fileSt];
-        if (ch == '/'){
-            // Move to the next row
-            if (col != 8) {
-                cerr << "Invalid FEN: Row does not have 8 squares" << endl;
-                exit(1);
+    return true;
+}
+
+/* Drops the castling rights whose king or rook no longer stands on its original square */
+static int possibleCastlingRights(const Board& board, int rights) {
+    if (board.squares[makeSquare(0, 4)] != 'K') rights &= ~(WHITE_KINGSIDE | WHITE_QUEENSIDE);
+    if (board.squares[makeSquare(0, 7)] != 'R') rights &= ~WHITE_KINGSIDE;
+    if (board.squares[makeSquare(0, 0)] != 'R') rights &= ~WHITE_QUEENSIDE;
+    if (board.squares[makeSquare(7, 4)] != 'k') rights &= ~(BLACK_KINGSIDE | BLACK_QUEENSIDE);
+    if (board.squares[makeSquare(7, 7)] != 'r') rights &= ~BLACK_KINGSIDE;
+    if (board.squares[makeSquare(7, 0)] != 'r') rights &= ~BLACK_QUEENSIDE;
+    return rights;
+}
+
+/* Parses all six FEN fields into the game without copying the string. The castling, en passant
+   and clock fields may be omitted (defaulting to "- - 0 1"). On failure the game is left
+   unchanged and the result holds the status and the offset of the offending character. */
+FenResult ChessGame::parseFen(string_view fen) {
+    Board newBoard;
+    newBoard.clear();
+    int newKingSquare[2] = {-1, -1};
+    uint64_t newHashKey = 0; // Built alongside the board rather than in a second pass
+    size_t position = 0, fieldStart = 0;
+
+    // Part 1: Piece placement, from the top-left corner (A8) rank by rank
+    string_view placement = nextFenField(fen, position, fieldStart);
+    int row = 7, col = 0;
+    for (size_t i = 0; i < placement.size(); i++) {
+        char ch = placement[i];
+        size_t at = fieldStart + i;
+        if (ch == '/') {
+            // Move to the next row, which is only allowed after a complete one
+            if (col != 8 || row == 0) {
+                return {FEN_BAD_PLACEMENT, at};
             }
             row--;
-            col = 0; // Reset column to the first square
-        } else if (isdigit(ch)){
+            col = 0;
+        } else if (ch >= '1' && ch <= '8') {
             // Skip empty squares
-            int emptySquares = ch - '0';
-            if (emptySquares < 1 || emptySquares > 8 || col + emptySquares > 8){
-                cerr << "Invalid FEN: Invalid empty square count" << endl;
-                exit(1);
+            col += ch - '0';
+            if (col > 8) {
+                return {FEN_BAD_PLACEMENT, at};
+            }
+        } else if (isalpha(ch) && pieceIndex(ch) >= 0) {
+            if (col >= 8) {
+                return {FEN_BAD_PLACEMENT, at};
             }
-            col += emptySquares; // Move to next non-digit column
-        
-        } else if (isalpha(ch)){
-            // Validate and create pieces based on the character
-            if (ch != 'p' && ch != 'n' && ch != 'b' && ch != 'r' && ch != 'q' && ch != 'k' &&
-                ch != 'P' && ch != 'N' && ch != 'B' && ch != 'R' && ch != 'Q' && ch != 'K' ){
-                cerr << "Invalid FEN: Invalid chess piece. " << endl;
-                exit(1);
+            int square = makeSquare(row, col);
+            if (ch == 'K' || ch == 'k') {
+                int colour = ch == 'K' ? WHITE : BLACK;
+                if (newKingSquare[colour] >= 0) {
+                    return {FEN_BAD_KINGS, at};
+                }
+                newKingSquare[colour] = square;
             }
-            // Place a piece
-            board[row][col] = createChessPiece(ch, row, col);
-            col++; // Move to next column 
-        
+            newBoard.addPiece(ch, square);
+            newHashKey ^= zobristPieces[pieceIndex(ch)][square];
+            col++;
         } else {
-            cerr << "Invalid FEN: Unrecognized character" << ch << endl;
-            exit(1);
+            return {FEN_BAD_PLACEMENT, at};
         }
+    }
+    if (row != 0 || col != 8) {
+        return {FEN_BAD_PLACEMENT, fieldStart + placement.size()};
+    }
+    if (newKingSquare[WHITE] < 0 || newKingSquare[BLACK] < 0) {
+        return {FEN_BAD_KINGS, fieldStart};
+    }
 
-        fileSt++;  // Move to the next character
+    // Part 2: Active color
+    string_view side = nextFenField(fen, position, fieldStart);
+    if (side != "w" && side != "b") {
+        return {FEN_BAD_SIDE, fieldStart};
+    }
+    bool newWhiteToMove = side == "w";
+    if (!newWhiteToMove) {
+        newHashKey ^= zobristBlackToMove;
     }
 
-    if (row != 0 || col != 8){
-        cerr << "Error: Incomplete board setup" << endl;
-        exit(1);
+    // Part 3: Castling rights
+    string_view castling = nextFenField(fen, position, fieldStart);
+    int newCastlingRights = 0;
+    if (!castling.empty() && castling != "-") {
+        for (size_t i = 0; i < castling.size(); i++) {
+            size_t flag = string_view("KQkq").find(castling[i]);
+            if (flag == string_view::npos || (newCastlingRights & (1 << flag))) {
+                return {FEN_BAD_CASTLING, fieldStart + i};
+            }
+            newCastlingRights |= 1 << flag;
+        }
     }
+    newCastlingRights = possibleCastlingRights(newBoard, newCastlingRights);
 
-    // Part 2: Determine the active color
-    fileSt++;  // Skip the space after the board part
-    while (fen[fileSt] != ' ' && fen[fileSt] != '\0') {  // Loop until space or end of string
-        if (fen[fileSt] == 'w') {           
-            whiteToMove = true;
-        } else if (fen[fileSt] == 'b') {
-            whiteToMove = false;
-        } else {
-            cerr << "Invalid FEN: Invalid active color" << endl;
-            exit(1);
+    // Part 4: En passant target square, which lies behind a pawn that just advanced two squares
+    string_view enPassant = nextFenField(fen, position, fieldStart);
+    int newEnPassantSquare = -1;
+    if (!enPassant.empty() && enPassant != "-") {
+        if (enPassant.size() != 2 || enPassant[0] < 'a' || enPassant[0] > 'h' ||
+            enPassant[1] != (newWhiteToMove ? '6' : '3')) {
+            return {FEN_BAD_EN_PASSANT, fieldStart};
         }
-        fileSt++;  // Increment to move to the next character
+        newEnPassantSquare = makeSquare(enPassant[1] - '1', enPassant[0] - 'a');
     }
 
+    // Part 5 and 6: Halfmove clock and fullmove number
+    int newHalfmoveClock = 0, newFullmoveNumber = 1;
+    string_view halfmove = nextFenField(fen, position, fieldStart);
+    if (!halfmove.empty() && !parseFenNumber(halfmove, newHalfmoveClock)) {
+        return {FEN_BAD_CLOCK, fieldStart};
+    }
+    string_view fullmove = nextFenField(fen, position, fieldStart);
+    if (!fullmove.empty() && !parseFenNumber(fullmove, newFullmoveNumber)) {
+        return {FEN_BAD_CLOCK, fieldStart};
+    }
+    if (newFullmoveNumber < 1) {
+        newFullmoveNumber = 1; // Some writers emit 0 for the first move
+    }
+    newHashKey ^= zobristCastling[newCastlingRights];
 
-    // Part 3: Castling Status 
-    fileSt++; // Skip the space after active color
-    while (fen[fileSt] != ' ' && fen[fileSt] != '\0') {  // Loop until space or end of string
-        fileSt++; 
-    } 
-}  
+    nextFenField(fen, position, fieldStart);
+    if (fieldStart < fen.size()) {
+        return {FEN_TRAILING_TEXT, fieldStart};
+    }
 
+    // Everything parsed, so the new state can replace the old one
+    newBoard.setNetwork(board.network);
+    board = newBoard;
+    kingSquare[WHITE] = newKingSquare[WHITE];
+    kingSquare[BLACK] = newKingSquare[BLACK];
+    whiteToMove = newWhiteToMove;
+    castlingRights = newCastlingRights;
+    enPassantSquare = newEnPassantSquare;
+    halfmoveClock = newHalfmoveClock;
+    fullmoveNumber = newFullmoveNumber;
+    undoCount = 0;
+    cachedMovesValid = false;
+    // The position key is set here and updated incrementally afterwards
+    hashKey = newHashKey ^ enPassantKey();
+    return {FEN_OK, 0};
+}
 
-/* Finds the position of the king on the board */
-pair<int, int> ChessGame::findKingPos(char kingType){
-    // Iterate through the board to find the king with the given type
-    for (int row = 0; row < 8; row++){
-        for (int col = 0; col < 8; col++){
-            ChessPiece* piece = board[row][col];
-            if (piece && piece->getType() == kingType) {
-                // King found, return its position as (row, col)
-                return make_pair(row, col);
+/* Loads the board state from a FEN string, reporting (rather than exiting on) malformed input */
+FenResult ChessGame::loadState(const char* fen, bool announce){
+    FenResult result = parseFen(fen);
+    if (!result.ok()) {
+        if (output) {
+            output->error(string("Invalid FEN: ") + fenStatusMessage(result.status)
+                          + " at character " + to_string(result.position));
+        }
+        return result;
+    }
+    if (announce && output) {
+        output->message("A new board state is loaded!");
+    }
+    return result;
+}
+
+/* Writes the position back out as a six-field FEN string */
+string ChessGame::toFen() const {
+    string fen;
+    fen.reserve(92);
+
+    for (int row = 7; row >= 0; row--) {
+        int emptySquares = 0;
+        for (int col = 0; col < 8; col++) {
+            char type = board.squares[makeSquare(row, col)];
+            if (type == 0) {
+                emptySquares++;
+                continue;
+            }
+            if (emptySquares > 0) {
+                fen += char('0' + emptySquares);
+                emptySquares = 0;
+            }
+            fen += type;
+        }
+        if (emptySquares > 0) {
+            fen += char('0' + emptySquares);
+        }
+        if (row > 0) {
+            fen += '/';
+        }
+    }
+
+    fen += whiteToMove ? " w " : " b ";
+    if (castlingRights == 0) {
+        fen += '-';
+    } else {
+        if (castlingRights & WHITE_KINGSIDE) fen += 'K';
+        if (castlingRights & WHITE_QUEENSIDE) fen += 'Q';
+        if (castlingRights & BLACK_KINGSIDE) fen += 'k';
+        if (castlingRights & BLACK_QUEENSIDE) fen += 'q';
+    }
+
+    fen += ' ';
+    if (enPassantSquare < 0) {
+        fen += '-';
+    } else {
+        fen += char('a' + squareCol(enPassantSquare));
+        fen += char('1' + squareRow(enPassantSquare));
+    }
+
+    fen += ' ';
+    fen += to_string(halfmoveClock);
+    fen += ' ';
+    fen += to_string(fullmoveNumber);
+    return fen;
+}
+
+/* Packs the position: the occupancy bitboard, then one nibble per piece in square order */
+bool ChessGame::pack(PackedPosition& packed) const {
+    if (popCount(board.occupied) > 32) {
+        return false;
+    }
+    memset(&packed, 0, sizeof(packed));
+    packed.occupied = board.occupied;
+    Bitboard pieces = board.occupied;
+    for (int slot = 0; pieces; slot++) {
+        int square = popLsb(pieces);
+        packed.pieces[slot >> 1] |= uint8_t(pieceIndex(board.squares[square]) << (4 * (slot & 1)));
+    }
+    packed.flags = uint8_t((whiteToMove ? 0 : 1) | castlingRights << 1);
+    packed.enPassantSquare = uint8_t(enPassantSquare < 0 ? 64 : enPassantSquare);
+    packed.halfmoveClock = uint16_t(min(halfmoveClock, 65535));
+    packed.fullmoveNumber = uint16_t(min(fullmoveNumber, 65535));
+    return true;
+}
+
+/* Rebuilds the position from a packed record, checking it the way parseFen checks a FEN string.
+   The record is checked in full first, so the board can then be rebuilt in place */
+bool ChessGame::unpack(const PackedPosition& packed) {
+    if (popCount(packed.occupied) > 32 || packed.flags > 31 || packed.reserved != 0) {
+        return false;
+    }
+    int pieceCount = popCount(packed.occupied);
+    int newKingSquare[2] = {-1, -1};
+    Bitboard pieces = packed.occupied;
+    for (int slot = 0; slot < pieceCount; slot++) {
+        int square = popLsb(pieces);
+        int index = (packed.pieces[slot >> 1] >> (4 * (slot & 1))) & 15;
+        if (index >= 12) {
+            return false;
+        }
+        if (index % 6 == KING) {
+            if (newKingSquare[index / 6] >= 0) {
+                return false;
+            }
+            newKingSquare[index / 6] = square;
+        }
+    }
+    if (newKingSquare[WHITE] < 0 || newKingSquare[BLACK] < 0) {
+        return false;
+    }
+    bool newWhiteToMove = !(packed.flags & 1);
+    if (packed.enPassantSquare != 64 &&
+        (packed.enPassantSquare > 64 || squareRow(packed.enPassantSquare) != (newWhiteToMove ? 5 : 2))) {
+        return false;
+    }
+
+    // The network's accumulator is rebuilt once at the end rather than piece by piece
+    const NnueNetwork* network = board.network;
+    board.network = nullptr;
+    board.clear();
+    uint64_t newHashKey = newWhiteToMove ? 0 : zobristBlackToMove;
+    pieces = packed.occupied;
+    for (int slot = 0; slot < pieceCount; slot++) {
+        int square = popLsb(pieces);
+        int index = (packed.pieces[slot >> 1] >> (4 * (slot & 1))) & 15;
+        board.addPiece(pieceType(index), square);
+        newHashKey ^= zobristPieces[index][square];
+    }
+    board.setNetwork(network);
+    kingSquare[WHITE] = newKingSquare[WHITE];
+    kingSquare[BLACK] = newKingSquare[BLACK];
+    whiteToMove = newWhiteToMove;
+    castlingRights = possibleCastlingRights(board, packed.flags >> 1);
+    enPassantSquare = packed.enPassantSquare == 64 ? -1 : packed.enPassantSquare;
+    halfmoveClock = packed.halfmoveClock;
+    fullmoveNumber = max(int(packed.fullmoveNumber), 1);
+    undoCount = 0;
+    cachedMovesValid = false;
+    hashKey = newHashKey ^ zobristCastling[castlingRights] ^ enPassantKey();
+    return true;
+}
+
+static_assert(is_trivially_copyable<PositionSnapshot>::value, "snapshots are copied as raw bytes");
+
+/* Copies the position fields; the board is one block of plain data */
+void ChessGame::snapshot(PositionSnapshot& position) const {
+    position.board = board;
+    position.kingSquare[WHITE] = int8_t(kingSquare[WHITE]);
+    position.kingSquare[BLACK] = int8_t(kingSquare[BLACK]);
+    position.whiteToMove = whiteToMove;
+    position.castlingRights = uint8_t(castlingRights);
+    position.enPassantSquare = int8_t(enPassantSquare);
+    position.halfmoveClock = halfmoveClock;
+    position.fullmoveNumber = fullmoveNumber;
+    position.hashKey = hashKey;
+}
+
+/* Copies the position fields back and drops the history and cached moves, which belonged to
+   whatever position the game held before. The game keeps its own network: the snapshot's
+   accumulator is used as it is only when it was built by that same network */
+void ChessGame::restore(const PositionSnapshot& position) {
+    const NnueNetwork* network = board.network;
+    board = position.board;
+    if (board.network != network) {
+        board.setNetwork(network);
+    }
+    kingSquare[WHITE] = position.kingSquare[WHITE];
+    kingSquare[BLACK] = position.kingSquare[BLACK];
+    whiteToMove = position.whiteToMove;
+    castlingRights = position.castlingRights;
+    enPassantSquare = position.enPassantSquare;
+    halfmoveClock = position.halfmoveClock;
+    fullmoveNumber = position.fullmoveNumber;
+    hashKey = position.hashKey;
+    undoCount = 0;
+    cachedMovesValid = false;
+}
+
+// Castling rights kept when a piece moves from or to each square: moving the king or a rook,
+// or capturing a rook on its original square, loses the corresponding right
+static int castlingMask(int square) {
+    switch (square) {
+        case 0: return ~WHITE_QUEENSIDE & 15;                    // A1
+        case 4: return ~(WHITE_KINGSIDE | WHITE_QUEENSIDE) & 15; // E1
+        case 7: return ~WHITE_KINGSIDE & 15;                     // H1
+        case 56: return ~BLACK_QUEENSIDE & 15;                   // A8
+        case 60: return ~(BLACK_KINGSIDE | BLACK_QUEENSIDE) & 15; // E8
+        case 63: return ~BLACK_KINGSIDE & 15;                    // H8
+        default: return 15;
+    }
+}
+
+/* Zobrist key of the en passant square, or 0 when no pawn of the side to move can capture there.
+   Leaving out uncapturable squares keeps positions that only differ by a useless double push equal. */
+uint64_t ChessGame::enPassantKey() const {
+    if (enPassantSquare < 0) {
+        return 0;
+    }
+    int us = whiteToMove ? WHITE : BLACK;
+    if (!(pawnAttacks[us ^ 1][enPassantSquare] & board.piecesOf(us, PAWN))) {
+        return 0;
+    }
+    return zobristEnPassant[squareCol(enPassantSquare)];
+}
+
+static_assert(is_trivially_default_constructible<Move>::value, "move lists are left uninitialised past count");
+
+/* Appends every pseudo-legal move of the side to move: the piece moves from the move generators,
+   plus en passant and castling, which depend on the game state rather than the board alone */
+void ChessGame::generateMoves(MoveList& moves) const {
+    int us = whiteToMove ? WHITE : BLACK;
+    Bitboard movers = board.colours[us];
+    while (movers) {
+        getLegalMoves(board, popLsb(movers), moves);
+    }
+
+    // En passant: our pawns that attack the square behind the pawn that just advanced two squares
+    if (enPassantSquare >= 0) {
+        Bitboard capturers = pawnAttacks[us ^ 1][enPassantSquare] & board.piecesOf(us, PAWN);
+        while (capturers) {
+            moves.add(Move(popLsb(capturers), enPassantSquare, EN_PASSANT));
+        }
+    }
+
+    addCastlingMoves(moves);
+}
+
+/* Appends the castling moves of the side to move: the squares between king and rook must be
+   empty, and the king may not start on, pass through or land on an attacked square */
+void ChessGame::addCastlingMoves(MoveList& moves) const {
+    int us = whiteToMove ? WHITE : BLACK;
+    int rights = castlingRights & (whiteToMove ? (WHITE_KINGSIDE | WHITE_QUEENSIDE) : (BLACK_KINGSIDE | BLACK_QUEENSIDE));
+    if (rights && !isSquareAttacked(kingSquare[us], !whiteToMove)) {
+        int king = kingSquare[us];
+        if ((rights & (WHITE_KINGSIDE | BLACK_KINGSIDE))
+            && !(board.occupied & (squareBB(king + 1) | squareBB(king + 2)))
+            && !isSquareAttacked(king + 1, !whiteToMove) && !isSquareAttacked(king + 2, !whiteToMove)) {
+            moves.add(Move(king, king + 2, CASTLING));
+        }
+        if ((rights & (WHITE_QUEENSIDE | BLACK_QUEENSIDE))
+            && !(board.occupied & (squareBB(king - 1) | squareBB(king - 2) | squareBB(king - 3)))
+            && !isSquareAttacked(king - 1, !whiteToMove) && !isSquareAttacked(king - 2, !whiteToMove)) {
+            moves.add(Move(king, king - 2, CASTLING));
+        }
+    }
+}
+
+/* Returns the pieces of the given colour attacking the square, with sliders seeing through
+   the given occupancy (so a king can be taken out of it to test where it may step) */
+Bitboard ChessGame::attackersOf(int square, int colour, Bitboard occupied) const {
+    Bitboard queens = board.piecesOf(colour, QUEEN);
+    return (pawnAttacks[colour ^ 1][square] & board.piecesOf(colour, PAWN))
+         | (knightAttacks[square] & board.piecesOf(colour, KNIGHT))
+         | (kingAttacks[square] & board.piecesOf(colour, KING))
+         | (bishopAttacks(square, occupied) & (board.piecesOf(colour, BISHOP) | queens))
+         | (rookAttacks(square, occupied) & (board.piecesOf(colour, ROOK) | queens));
+}
+
+/* Appends only the legal moves of the side to move. Checkers and pinned pieces are found once:
+   in double check only the king moves; otherwise every other move must capture the checker or
+   block its ray, and a pinned piece must stay on the line between its king and the pinner. */
+void ChessGame::generateLegalMoves(MoveList& moves) const {
+    int us = whiteToMove ? WHITE : BLACK;
+    int them = us ^ 1;
+    int king = kingSquare[us];
+    Bitboard own = board.colours[us];
+
+    // King steps: the target may not be attacked once the king has left, so sliders see through its square
+    Bitboard withoutKing = board.occupied ^ squareBB(king);
+    Bitboard targets = kingAttacks[king] & ~own;
+    while (targets) {
+        int to = popLsb(targets);
+        if (!attackersOf(to, them, withoutKing)) {
+            moves.add(Move(king, to));
+        }
+    }
+
+    Bitboard checkers = attackersOf(king, them, board.occupied);
+    if (popCount(checkers) > 1) {
+        return;
+    }
+    Bitboard checkMask = checkers ? checkers | betweenSquares[king][lsb(checkers)] : ~Bitboard(0);
+
+    // A piece is pinned when it is the only piece between its king and an enemy slider on the same line
+    Bitboard queens = board.piecesOf(them, QUEEN);
+    Bitboard rookLike = board.piecesOf(them, ROOK) | queens;
+    Bitboard bishopLike = board.piecesOf(them, BISHOP) | queens;
+    Bitboard snipers = (rookAttacks(king, board.colours[them]) & rookLike)
+                     | (bishopAttacks(king, board.colours[them]) & bishopLike);
+    Bitboard pinned = 0;
+    Bitboard pinLine[64];
+    while (snipers) {
+        int sniper = popLsb(snipers);
+        Bitboard blockers = betweenSquares[king][sniper] & board.occupied;
+        if (popCount(blockers) == 1 && (blockers & own)) {
+            pinned |= blockers;
+            pinLine[lsb(blockers)] = betweenSquares[king][sniper] | squareBB(sniper);
+        }
+    }
+
+    // Other pieces: their generated moves, kept only where the check and pin masks allow
+    Bitboard movers = own ^ squareBB(king);
+    while (movers) {
+        int from = popLsb(movers);
+        Bitboard allowed = (pinned & squareBB(from)) ? checkMask & pinLine[from] : checkMask;
+        int first = moves.size();
+        getLegalMoves(board, from, moves);
+        int kept = first;
+        for (int i = first; i < moves.size(); i++) {
+            if (allowed & squareBB(moves[i].to())) {
+                moves[kept++] = moves[i];
+            }
+        }
+        moves.count = kept;
+    }
+
+    // En passant removes two pawns from a line at once, so it is checked by replaying the
+    // slider attacks on the king with the resulting occupancy
+    if (enPassantSquare >= 0) {
+        int capturedSquare = whiteToMove ? enPassantSquare - 8 : enPassantSquare + 8;
+        Bitboard capturers = pawnAttacks[them][enPassantSquare] & board.piecesOf(us, PAWN);
+        Bitboard otherCheckers = checkers & ~squareBB(capturedSquare) & ~(rookLike | bishopLike);
+        while (capturers) {
+            int from = popLsb(capturers);
+            Bitboard after = (board.occupied ^ squareBB(from) ^ squareBB(capturedSquare)) | squareBB(enPassantSquare);
+            if (!otherCheckers && !(bishopAttacks(king, after) & bishopLike) && !(rookAttacks(king, after) & rookLike)) {
+                moves.add(Move(from, enPassantSquare, EN_PASSANT));
             }
         }
     }
+
+    if (!checkers) {
+        addCastlingMoves(moves);
+    }
+}
+
+/* Plays a pseudo-legal move of the side to move, pushing what is needed to take it back */
+void ChessGame::makeMove(Move move) {
+    int from = move.from();
+    int to = move.to();
+    char piece = board.squares[from];
+    int us = whiteToMove ? WHITE : BLACK;
+
+    // The pawn taken en passant stands beside the mover, behind the target square
+    int captureSquare = move.flags() == EN_PASSANT ? (whiteToMove ? to - 8 : to + 8) : to;
+    char capturedPiece = board.squares[captureSquare];
+
+    // A long enough game would otherwise run off the end of the undo stack
+    trimHistory();
+    assert(undoCount < UNDO_STACK_SIZE);
+    UndoRecord& undo = undoStack[undoCount++];
+    undo.hashKey = hashKey;
+    undo.move = move;
+    undo.capturedPiece = capturedPiece;
+    undo.castlingRights = uint8_t(castlingRights);
+    undo.enPassantSquare = int8_t(enPassantSquare);
+    undo.halfmoveClock = uint16_t(halfmoveClock);
+
+    hashKey ^= enPassantKey();
+    if (capturedPiece != 0) {
+        hashKey ^= zobristPieces[pieceIndex(capturedPiece)][captureSquare];
+        board.removePiece(captureSquare);
+    }
+    int index = pieceIndex(piece);
+    hashKey ^= zobristPieces[index][from] ^ zobristPieces[index][to];
+    board.movePiece(from, to);
+
+    if (move.isPromotion()) {
+        // Swap the pawn for the promoted piece
+        char promoted = pieceType(move.promotionIndex() + 6 * us);
+        hashKey ^= zobristPieces[index][to] ^ zobristPieces[pieceIndex(promoted)][to];
+        board.removePiece(to);
+        board.addPiece(promoted, to);
+    } else if (move.flags() == CASTLING) {
+        // The rook jumps over to the square the king passed through
+        int rookFrom = to > from ? from + 3 : from - 4;
+        int rookTo = (from + to) / 2;
+        int rookIndex = pieceIndex(board.squares[rookFrom]);
+        hashKey ^= zobristPieces[rookIndex][rookFrom] ^ zobristPieces[rookIndex][rookTo];
+        board.movePiece(rookFrom, rookTo);
+    }
+    if (index % 6 == KING) {
+        kingSquare[us] = to;
+    }
+
+    hashKey ^= zobristCastling[castlingRights];
+    castlingRights &= castlingMask(from) & castlingMask(to);
+    hashKey ^= zobristCastling[castlingRights];
+
+    enPassantSquare = move.flags() == DOUBLE_PAWN_PUSH ? (from + to) / 2 : -1;
+    halfmoveClock = (index % 6 == PAWN || capturedPiece != 0) ? 0 : halfmoveClock + 1;
+    if (!whiteToMove) {
+        fullmoveNumber++;
+    }
+
+    switchSide();
+    hashKey ^= enPassantKey();
+}
+
+/* Takes back the last move played by makeMove; does nothing when there is none */
+void ChessGame::unmakeMove() {
+    assert(undoCount > 0);
+    if (undoCount == 0) {
+        return;
+    }
+    const UndoRecord& undo = undoStack[--undoCount];
+    Move move = undo.move;
+    int from = move.from();
+    int to = move.to();
+
+    whiteToMove = !whiteToMove;
+    int us = whiteToMove ? WHITE : BLACK;
+    if (!whiteToMove) {
+        fullmoveNumber--;
+    }
+
+    if (move.isPromotion()) {
+        board.removePiece(to);
+        board.addPiece(whiteToMove ? 'P' : 'p', to);
+    } else if (move.flags() == CASTLING) {
+        int rookFrom = to > from ? from + 3 : from - 4;
+        board.movePiece((from + to) / 2, rookFrom);
+    }
+    board.movePiece(to, from);
+    if (board.squares[from] == (whiteToMove ? 'K' : 'k')) {
+        kingSquare[us] = from;
+    }
+    if (undo.capturedPiece != 0) {
+        int captureSquare = move.flags() == EN_PASSANT ? (whiteToMove ? to - 8 : to + 8) : to;
+        board.addPiece(undo.capturedPiece, captureSquare);
+    }
+
+    castlingRights = undo.castlingRights;
+    enPassantSquare = undo.enPassantSquare;
+    halfmoveClock = undo.halfmoveClock;
+    hashKey = undo.hashKey;
+}
+
+/* Checks whether the given side has any move that does not leave its king attacked */
+bool ChessGame::hasLegalMove(bool forWhite) {
+    // Look at the position with the given side to move; en passant only belongs to the side to move
+    bool switched = forWhite != whiteToMove;
+    int savedEnPassant = enPassantSquare;
+    if (switched) {
+        switchSide();
+        enPassantSquare = -1;
+    }
+
+    MoveList moves;
+    generateLegalMoves(moves);
+    bool found = moves.size() > 0;
+
+    if (switched) {
+        enPassantSquare = savedEnPassant;
+        switchSide();
+    }
+    return found;
+}
+
+/* Finds the position of the king on the board */
+pair<int, int> ChessGame::findKingPos(char kingType){
+    // King squares are tracked on every move, so no board scan is needed
+    int square = kingSquare[isupper(kingType) ? WHITE : BLACK];
+    if (square >= 0) {
+        // King found, return its position as (row, col)
+        return make_pair(squareRow(square), squareCol(square));
+    }
     // If the king cannot be found, return an invalid position (-1, -1)
     return make_pair(-1, -1);
 }
 
+/* Checks whether any piece of the given colour attacks the square, looking outward from
+   the square with each piece's attack pattern (pawn, knight, king offsets and slider rays) */
+bool ChessGame::isSquareAttacked(int square, bool byWhite) const {
+    int attacker = byWhite ? WHITE : BLACK;
+
+    // A pawn attacks the square if a pawn of the other colour standing there would attack it back
+    if (pawnAttacks[attacker ^ 1][square] & board.piecesOf(attacker, PAWN)) {
+        return true;
+    }
+    if (knightAttacks[square] & board.piecesOf(attacker, KNIGHT)) {
+        return true;
+    }
+    if (kingAttacks[square] & board.piecesOf(attacker, KING)) {
+        return true;
+    }
+
+    // Slider rays stop at the first blocker, so only unobstructed attackers are found
+    Bitboard queens = board.piecesOf(attacker, QUEEN);
+    if (bishopAttacks(square, board.occupied) & (board.piecesOf(attacker, BISHOP) | queens)) {
+        return true;
+    }
+    return (rookAttacks(square, board.occupied) & (board.piecesOf(attacker, ROOK) | queens)) != 0;
+}
+
 /* Checks if the king of the specified color is safe from attacks */
 bool ChessGame::isKingSafe(const bool kingIsWhite) {
-    // Identify the king's type based on the color (white or black)
-    char kingType = kingIsWhite ? 'K' : 'k';
-
-    // Find the king's current position on the board
-    pair<int, int> kingPos = findKingPos(kingType);
-    int kingRow = kingPos.first;
-    int kingCol = kingPos.second;
+    int square = kingSquare[kingIsWhite ? WHITE : BLACK];
 
     // Ensure the king exists on the board
-    if (kingRow == -1 || kingCol == -1) {
+    if (square < 0) {
         cout << endl;
         cerr << "Error: King not found on the board!" << endl;
         exit(1);
     }
 
-    // Iterate through all pieces on the board to check for threats
-    for (int row = 0; row < 8; row++){
-        for (int col = 0; col < 8; col++){
-
-            ChessPiece* piece = board[row][col];
-            // Skip empty squares and pieces of the same color as the king
-            if (piece && piece->isWhiteSide() != kingIsWhite) {
-                // Get all legal moves for the opponent's piece
-                vector<pair<int,int>> legalMoves = piece->getLegalMoves(board);
-                // Check if any move targets the king's position
-                for (size_t moveIndex = 0; moveIndex < legalMoves.size(); moveIndex++) {
-                    if (legalMoves[moveIndex].first == kingRow && 
-                        legalMoves[moveIndex].second == kingCol) {
-                        return false; // King is in danger
-                    }
-                }
-            }
-        }
-    }
-
-    return true; // King is safe from all threats
+    // The king is safe unless an opposing piece attacks its square
+    return !isSquareAttacked(square, !kingIsWhite);
 }
 
 /* Helper to perform a temporary move on the chessboard */
-void ChessGame::performTemporaryMove(
-    ChessPiece*& piece, int startRow, int startCol, int endRow, int endCol, ChessPiece*& capturedPiece) {
-    // Move the piece to the target square
-    board[endRow][endCol] = piece;
-    // Clear the piece from its original square
-    board[startRow][startCol] = nullptr;
-    // Update the piece's internal position to reflect the new location
-    piece->setPosition(endRow, endCol);
+void ChessGame::performTemporaryMove(int startSquare, int endSquare, char capturedPiece) {
+    // Take the captured piece (if any) off the bitboards
+    if (capturedPiece != 0) {
+        hashKey ^= zobristPieces[pieceIndex(capturedPiece)][endSquare];
+        board.removePiece(endSquare);
+    }
+    // Move the piece to the target square and clear its original square
+    char type = board.squares[startSquare];
+    int index = pieceIndex(type);
+    hashKey ^= zobristPieces[index][startSquare] ^ zobristPieces[index][endSquare];
+    board.movePiece(startSquare, endSquare);
+    // Keep the tracked king square in step with the king
+    if (toupper(type) == 'K') {
+        kingSquare[isWhitePiece(type) ? WHITE : BLACK] = endSquare;
+    }
 }
 
 /* Helper to undo a temporary move on the chessboard */
-void ChessGame::undoTemporaryMove(
-    ChessPiece*& piece, int startRow, int startCol, int endRow, int endCol, ChessPiece*& capturedPiece) {
+void ChessGame::undoTemporaryMove(int startSquare, int endSquare, char capturedPiece) {
     // Move the piece back to its original square
-    board[startRow][startCol] = piece;
+    char type = board.squares[endSquare];
+    int index = pieceIndex(type);
+    hashKey ^= zobristPieces[index][startSquare] ^ zobristPieces[index][endSquare];
+    board.movePiece(endSquare, startSquare);
+    if (toupper(type) == 'K') {
+        kingSquare[isWhitePiece(type) ? WHITE : BLACK] = startSquare;
+    }
     // Restore the captured piece (if any) to its original position
-    board[endRow][endCol] = capturedPiece;
-    // Update the piece's internal position to its original location
-    piece->setPosition(startRow, startCol);
+    if (capturedPiece != 0) {
+        hashKey ^= zobristPieces[pieceIndex(capturedPiece)][endSquare];
+        board.addPiece(capturedPiece, endSquare);
+    }
 }
 
 
 /* Check if the opponent's king is in checkmate */
 bool ChessGame::isCheckMate(const bool opponentIsWhite) {
-    
-    // 1. Check if the opponent's king has any legal moves to escape from check 
-    char kingType = opponentIsWhite ? 'K' : 'k';
-    pair<int, int> kingPos = findKingPos(kingType);
-    int kingRow = kingPos.first;
-    int kingCol = kingPos.second;
-
-    ChessPiece* kingPiece = board[kingRow][kingCol];
-
-    // Get all legal moves for the opponent's king
-    vector<pair<int,int>> kingLegalMoves = kingPiece->getLegalMoves(board);
-    // Check all legal moves of the king
-    for (size_t i = 0; i < kingLegalMoves.size(); i++) {
-        int endRow = kingLegalMoves[i].first;
-        int endCol = kingLegalMoves[i].second; 
-
-        ChessPiece* capturedPiece = board[endRow][endCol]; // Save the piece being captured (if any) 
-        // Perform temporary move
-        performTemporaryMove(kingPiece, kingRow, kingCol, endRow, endCol, capturedPiece);
-
-        // Check if the move allows the king to escape check
-        if (isKingSafe(opponentIsWhite)) {
-            // Undo the move if the king is safe
-            undoTemporaryMove(kingPiece, kingRow, kingCol, endRow, endCol, capturedPiece);
-            return false; // The king can escape, so it's not checkmate
-        } 
-
-        // Undo the move
-        undoTemporaryMove(kingPiece, kingRow, kingCol, endRow, endCol, capturedPiece);
-
-    }
-
-    // 2. Check if any of the opponent's pieces can block or capture the checking piece
-    for (int startRow = 0; startRow < 8; startRow++) {
-        for (int startCol = 0; startCol < 8; startCol++){
-            if (!(startRow == kingRow && startCol == kingCol)){
-                
-                ChessPiece* otherPiece = board[startRow][startCol];
-
-                // Check if the piece belongs to the opponent
-                if (otherPiece && otherPiece->isWhiteSide() == opponentIsWhite){
-                    // Get all legal moves for this piece
-                    vector<pair<int,int>> otherPieceLegalMoves = otherPiece->getLegalMoves(board);
-                    
-                    // Check all legal moves of the opponent's piece
-                    for (size_t i = 0; i < otherPieceLegalMoves.size(); i++) {
-                        int endRow = otherPieceLegalMoves[i].first;
-                        int endCol = otherPieceLegalMoves[i].second; 
-
-                        ChessPiece* capturedPiece = board[endRow][endCol]; // Save the piece being captured (if any)
-                        // Perform temporary move
-                        performTemporaryMove(otherPiece, startRow, startCol, endRow, endCol, capturedPiece);
-                        // Check if the move allows the king to escape check
-                        if (isKingSafe(opponentIsWhite)) {
-                            // Undo the move if the king is safe
-                            undoTemporaryMove(otherPiece, startRow, startCol, endRow, endCol, capturedPiece);
-                            return false; // The opponent can escape the check, so it's not checkmate
-                        }
-                        // Undo the move
-                        undoTemporaryMove(otherPiece, startRow, startCol, endRow, endCol, capturedPiece);
-
-                    }
-                }
-            }
-        }
-    }
-    
-    return true; // If no escape moves are found, it's checkmate
+    // The king is attacked and no move (king escape, block or capture, including en passant)
+    // gets it out of check
+    return !isKingSafe(opponentIsWhite) && !hasLegalMove(opponentIsWhite);
 }
 
 /* Check if the opponent is in a stalemate situation */
 bool ChessGame::isStaleMate(const bool opponentIsWhite) {
-    // 1. Check if the opponent has any feasible moves that don't put their king in danger
-    for (int startRow = 0; startRow < 8; startRow++) {
-        for (int startCol = 0; startCol < 8; startCol++){
-            // Get the piece at the current position
-            ChessPiece* opponentPiece = board[startRow][startCol];
-            // Proceed only if it's the opponent's piece
-            if (opponentPiece && opponentPiece->isWhiteSide() == opponentIsWhite){
-                // Get all legal moves for the opponent's piece
-                vector<pair<int,int>> legalMoves = opponentPiece->getLegalMoves(board);
-                // 2. Check if any legal move would leave the opponent's king in danger (in check)
-                for (size_t moveIndex = 0; moveIndex < legalMoves.size(); moveIndex++) {
-                    int endRow = legalMoves[moveIndex].first;
-                    int endCol = legalMoves[moveIndex].second;
-                    
-                    // Perform temporary move
-                    ChessPiece* capturedPiece = board[endRow][endCol]; // Save the piece being captured (if any) 
-                    performTemporaryMove(opponentPiece, startRow, startCol, endRow, endCol, capturedPiece);
-                    // Check if the move leaves the king in check
-                    if (!isKingSafe(opponentPiece->isWhiteSide())) {
-                        // Undo the move if the king would be in check
-                        undoTemporaryMove(opponentPiece, startRow, startCol, endRow, endCol, capturedPiece);
-                    }else{
-                        // If any move leaves the king safe, it's not a stalemate
-                        undoTemporaryMove(opponentPiece, startRow, startCol, endRow, endCol, capturedPiece);
-                        return false; // Not a stalemate
-                    }
-                }
-            }
+    // The opponent is not in check but every feasible move would put their king in danger
+    return isKingSafe(opponentIsWhite) && !hasLegalMove(opponentIsWhite);
+}
+
+/* Finds the move with the given start and end squares; the first match wins */
+static bool findMove(const MoveList& moves, int startSquare, int endSquare, Move& move) {
+    for (int i = 0; i < moves.size(); i++) {
+        if (moves[i].from() == startSquare && moves[i].to() == endSquare) {
+            move = moves[i];
+            return true;
         }
     }
-    // 3. If no legal moves for any of the opponent's pieces result in a safe king, it's a stalemate
-    return true;
+    return false;
+}
+
+/* Returns the legal moves of the side to move, generating them only if the cached list
+   belongs to another position */
+const MoveList& ChessGame::legalMoveList() {
+    if (!cachedMovesValid || cachedMovesKey != hashKey) {
+        cachedMoves.clear();
+        generateLegalMoves(cachedMoves);
+        cachedMovesKey = hashKey;
+        cachedMovesValid = true;
+    }
+    return cachedMoves;
 }
 
+/* Derives check, checkmate and stalemate for the side to move from a single generation of its
+   legal moves, which stays cached for validating the next submitted move */
+GameStatus ChessGame::computeGameStatus() {
+    bool inCheck = isSquareAttacked(kingSquare[whiteToMove ? WHITE : BLACK], !whiteToMove);
+    bool canMove = legalMoveList().size() > 0;
+    if (inCheck) {
+        return canMove ? GAME_CHECK : GAME_CHECKMATE;
+    }
+    return canMove ? GAME_NORMAL : GAME_STALEMATE;
+}
+
+/* One report line assembled in place, so reporting a move allocates nothing; text beyond the
+   capacity is dropped */
+class ReportLine {
+    char text[128];
+    size_t length = 0;
+
+  public:
+    ReportLine& operator<<(string_view part) {
+        size_t count = min(part.size(), sizeof(text) - length);
+        memcpy(text + length, part.data(), count);
+        length += count;
+        return *this;
+    }
+    ReportLine& operator<<(char c) {
+        return *this << string_view(&c, 1);
+    }
+    operator string_view() const { return string_view(text, length); }
+};
+
 /* Handles submitting a move in the chess game, validating positions, legal moves, 
-    and ensuring the king is not in check before updating the board and switching turns. */
-void ChessGame::submitMove(const char* posFrom, const char* posTo){
+    and ensuring the king is not in check before updating the board and switching turns.
+    The report is built only when there is a sink to send it to */
+MoveResult ChessGame::submitMove(const char* posFrom, const char* posTo){
+    MoveResult result = {MOVE_OK, Move(), 0, 0, false, false, false, false, false};
 
     // Convert input positions from chess notation to board indices
     int startRow = posFrom[1] - '1';
@@ -301,96 +842,441 @@ void ChessGame::submitMove(const char* posFrom, const char* posTo){
     // Validate if positions are within bounds
     if (startRow < 0 || startRow >= 8 || startCol < 0 || startCol >= 8 ||
         endRow < 0 || endRow >= 8 || endCol < 0 || endCol >= 8) {
-        cout << "Move out of bounds " << endl;
-        return ;
+        if (output) {
+            output->message("Move out of bounds ");
+        }
+        result.status = MOVE_OUT_OF_BOUNDS;
+        return result;
     }
+    int startSquare = makeSquare(startRow, startCol);
+    int endSquare = makeSquare(endRow, endCol);
 
     // Check if a piece exists at the source position
-    ChessPiece* piece = board[startRow][startCol];
-    if(piece == nullptr){
-        cout << "There is no piece at position " 
-        << char('A' + startCol) <<  startRow + 1 << endl;
-        return ;
+    char piece = board.squares[startSquare];
+    result.piece = piece;
+    if(piece == 0){
+        if (output) {
+            output->message(ReportLine() << "There is no piece at position "
+                            << char('A' + startCol) << char('1' + startRow));
+        }
+        result.status = MOVE_NO_PIECE;
+        return result;
     } 
+    bool pieceIsWhite = isWhitePiece(piece);
+    const char* side = pieceIsWhite ? "White's " : "Black's ";
 
    // Ensure the move is made by the correct player
-    if ((piece->isWhiteSide() && !whiteToMove) || (!piece->isWhiteSide() && whiteToMove)) {
-        cout <<  "It is not " 
-        << (piece->isWhiteSide() ? "White's " : "Black's ") 
-        << "turn to move!" << endl;
-        return ;
+    if ((pieceIsWhite && !whiteToMove) || (!pieceIsWhite && whiteToMove)) {
+        if (output) {
+            output->message(ReportLine() << "It is not " << side << "turn to move!");
+        }
+        result.status = MOVE_WRONG_TURN;
+        return result;
     }
 
-    // Get the list of legal moves for the piece
-    vector<pair<int,int>> legalMoves = piece->getLegalMoves(board);
+    // Get the legal moves for the side to move; usually they were already generated when the
+    // previous move's game status was computed
+    const MoveList& legalMoves = legalMoveList();
     
-    // Check if the destination position is a valid move
-    bool isLegal = false;
-    for (size_t i = 0; i < legalMoves.size(); i++) {
-        if (legalMoves[i].first == endRow && legalMoves[i].second == endCol) {
-            isLegal = true;
-            break;
+    // Check if the destination position is a valid move; a promotion is to a queen, which
+    // the generator lists first
+    Move move;
+    if (!findMove(legalMoves, startSquare, endSquare, move)) {
+        // Tell a move the piece cannot make apart from one that would expose its king
+        MoveList pseudoLegalMoves;
+        generateMoves(pseudoLegalMoves);
+        if (findMove(pseudoLegalMoves, startSquare, endSquare, move)) {
+            if (output) {
+                output->message("Move leaves the king in check");
+            }
+            result.status = MOVE_LEAVES_KING_IN_CHECK;
+            return result;
         }
+
+        if (output) {
+            output->message(ReportLine() << side << pieceName(piece) << " cannot move to " << posTo);
+        }
+        result.status = MOVE_ILLEGAL;
+        return result;
     }
 
-    if (!isLegal) {
-        cout << (piece->isWhiteSide() ? "White's " : "Black's ") 
-        << piece->getName() 
-        << " cannot move to " << posTo << endl;
+    // Play the move; this also hands the turn to the other player
+    makeMove(move);
+    result.move = move;
+    result.capturedPiece = undoStack[undoCount - 1].capturedPiece;
 
-        return;
+    // Check for check, checkmate, or stalemate after the move, from one pass over the opponent's moves
+    GameStatus status = computeGameStatus();
+    result.check = status == GAME_CHECK;
+    result.checkmate = status == GAME_CHECKMATE;
+    result.stalemate = status == GAME_STALEMATE;
+    // Checkmate ends the game first, even on the move that completes a repetition or fifty moves
+    result.threefoldRepetition = !result.checkmate && isThreefoldRepetition();
+    result.fiftyMoveDraw = !result.checkmate && isFiftyMoveDraw();
+
+    if (output) {
+        // Successful move details, then any capture
+        ReportLine line;
+        line << side << pieceName(piece) << " moves from " << posFrom << " to " << posTo;
+        if (result.capturedPiece != 0) {
+            line << " taking " << (isWhitePiece(result.capturedPiece) ? "White's " : "Black's ")
+                 << pieceName(result.capturedPiece);
+        }
+        output->message(line);
+
+        const char* opponent = pieceIsWhite ? "Black " : "White ";
+        if (result.check) {
+            output->message(ReportLine() << opponent << "is in check");
+        } else if (result.checkmate) {
+            output->message(ReportLine() << opponent << "is in checkmate");
+        } else if (result.stalemate) {
+            output->message("The game is in stalemate");
+        }
+        if (result.threefoldRepetition) {
+            output->message("The game is drawn by threefold repetition");
+        } else if (result.fiftyMoveDraw) {
+            output->message("The game is drawn by the fifty-move rule");
+        }
     }
 
-    // Perform temporary move
-    ChessPiece* capturedPiece = board[endRow][endCol]; // Save the piece being captured (if any) 
-    performTemporaryMove(piece, startRow, startCol, endRow, endCol, capturedPiece);
+    return result;
+}
 
-    // Ensure the move does not leave the king in check
-    if (!isKingSafe(piece->isWhiteSide())) {
-        undoTemporaryMove(piece, startRow, startCol, endRow, endCol, capturedPiece);
-        cout << "Move leaves the king in check" << endl;
-        return;
+/* Plays a legal move given in coordinate notation ("e2e4", or "e7e8q" for a promotion);
+   returns false, leaving the game unchanged, if it is not legal */
+bool ChessGame::playMove(string_view coordinates) {
+    const MoveList& moves = legalMoveList();
+    for (int i = 0; i < moves.size(); i++) {
+        if (moves[i].toString() == coordinates) {
+            makeMove(moves[i]);
+            return true;
+        }
     }
+    return false;
+}
 
-    // Print successful move details
-    cout << (piece->isWhiteSide() ? "White's " : "Black's ") 
-         << piece->getName() 
-         << " moves from " << posFrom << " to " << posTo;
+const char* sanStatusMessage(SanStatus status) {
+    switch (status) {
+        case SAN_OK: return "OK";
+        case SAN_MALFORMED: return "Not a move in algebraic notation";
+        case SAN_ILLEGAL: return "Illegal move";
+        case SAN_AMBIGUOUS: return "Ambiguous move";
+    }
+    return "Unknown error";
+}
+
+/* Maps a SAN piece letter to its PieceIndex, or -1 */
+static int sanPieceIndex(char letter) {
+    switch (letter) {
+        case 'N': return KNIGHT;
+        case 'B': return BISHOP;
+        case 'R': return ROOK;
+        case 'Q': return QUEEN;
+        case 'K': return KING;
+    }
+    return -1;
+}
 
-    // Handle captured piece, if any
-    if (capturedPiece != nullptr) {
-        cout << " taking " 
-             << (capturedPiece->isWhiteSide() ? "White's " : "Black's ") 
-             << capturedPiece->getName();
-        delete capturedPiece; // Free memory if dynamically allocated
+/* Reads the SAN from the back (suffixes, promotion, target square) and then the front (piece letter,
+   disambiguation, capture mark), and matches what it describes against the legal moves */
+SanStatus ChessGame::parseSan(string_view san, Move& move) {
+    while (!san.empty() && (san.back() == '+' || san.back() == '#' || san.back() == '!' || san.back() == '?')) {
+        san.remove_suffix(1);
     }
+    const MoveList& moves = legalMoveList();
 
-    // Check for check, checkmate, or stalemate after the move
-    if(!isKingSafe(!piece->isWhiteSide())){
-        if (!isCheckMate(!piece->isWhiteSide())){
-            cout << endl
-            <<(!piece->isWhiteSide() ? "White " : "Black ") 
-            << "is in check";
+    if (san == "O-O" || san == "0-0" || san == "O-O-O" || san == "0-0-0") {
+        bool kingside = san.size() == 3;
+        for (Move candidate : moves) {
+            if (candidate.flags() == CASTLING && (candidate.to() > candidate.from()) == kingside) {
+                move = candidate;
+                return SAN_OK;
+            }
         }
-        else{
-            cout << endl
-            <<(!piece->isWhiteSide() ? "White " : "Black ") 
-            << "is in checkmate";
+        return SAN_ILLEGAL;
+    }
+
+    // Promotion piece, written "e8=Q" or "e8Q"
+    int promotion = -1;
+    if (san.size() >= 3 && sanPieceIndex(san.back()) >= KNIGHT && sanPieceIndex(san.back()) <= QUEEN) {
+        promotion = sanPieceIndex(san.back());
+        san.remove_suffix(san.size() >= 4 && san[san.size() - 2] == '=' ? 2 : 1);
+    }
+
+    // Target square
+    if (san.size() < 2 || san[san.size() - 2] < 'a' || san[san.size() - 2] > 'h'
+        || san.back() < '1' || san.back() > '8') {
+        return SAN_MALFORMED;
+    }
+    int to = makeSquare(san.back() - '1', san[san.size() - 2] - 'a');
+    san.remove_suffix(2);
+
+    int piece = PAWN;
+    if (!san.empty() && sanPieceIndex(san.front()) >= 0) {
+        piece = sanPieceIndex(san.front());
+        san.remove_prefix(1);
+    }
+    if (!san.empty() && (san.back() == 'x' || san.back() == ':')) {
+        san.remove_suffix(1);
+    }
+    // What is left can only be the start file and/or rank
+    int fromCol = -1, fromRow = -1;
+    if (!san.empty() && san.front() >= 'a' && san.front() <= 'h') {
+        fromCol = san.front() - 'a';
+        san.remove_prefix(1);
+    }
+    if (!san.empty() && san.front() >= '1' && san.front() <= '8') {
+        fromRow = san.front() - '1';
+        san.remove_prefix(1);
+    }
+    if (!san.empty() || (promotion >= 0 && piece != PAWN)) {
+        return SAN_MALFORMED;
+    }
+
+    char mover = pieceType(piece + (whiteToMove ? 0 : 6));
+    int matches = 0;
+    Move found = Move();
+    for (Move candidate : moves) {
+        int from = candidate.from();
+        if (candidate.to() != to || board.squares[from] != mover || candidate.flags() == CASTLING
+            || (fromCol >= 0 && squareCol(from) != fromCol) || (fromRow >= 0 && squareRow(from) != fromRow)
+            || (candidate.isPromotion() ? candidate.promotionIndex() != promotion : promotion >= 0)) {
+            continue;
         }
-    
-    }else {
+        found = candidate;
+        matches++;
+    }
+    if (matches == 1) {
+        move = found;
+        return SAN_OK;
+    }
+    return matches == 0 ? SAN_ILLEGAL : SAN_AMBIGUOUS;
+}
 
-        if (isStaleMate(!piece->isWhiteSide())) {
-            cout << endl;
-            cout << "The game is in stalemate";
+/* Plays a SAN move */
+SanStatus ChessGame::playSan(string_view san) {
+    Move move;
+    SanStatus status = parseSan(san, move);
+    if (status == SAN_OK) {
+        makeMove(move);
+    }
+    return status;
+}
+
+/* Names the piece and its start file or rank only as far as another piece of the same kind could
+   reach the same square, then tries the move to see whether it gives check or mate */
+string ChessGame::toSan(Move move) {
+    int from = move.from();
+    int to = move.to();
+    int piece = pieceIndex(board.squares[from]) % 6;
+    string san;
+
+    if (move.flags() == CASTLING) {
+        san = to > from ? "O-O" : "O-O-O";
+    } else {
+        bool capture = board.squares[to] != 0 || move.flags() == EN_PASSANT;
+        if (piece == PAWN) {
+            if (capture) {
+                san += char('a' + squareCol(from));
+            }
+        } else {
+            san += "PNBRQK"[piece];
+            bool sameFile = false, sameRank = false, ambiguous = false;
+            for (Move other : legalMoveList()) {
+                int otherFrom = other.from();
+                if (other.to() == to && otherFrom != from && pieceIndex(board.squares[otherFrom]) % 6 == piece) {
+                    ambiguous = true;
+                    sameFile |= squareCol(otherFrom) == squareCol(from);
+                    sameRank |= squareRow(otherFrom) == squareRow(from);
+                }
+            }
+            if (ambiguous && (!sameFile || sameRank)) {
+                san += char('a' + squareCol(from));
+            }
+            if (ambiguous && sameFile) {
+                san += char('1' + squareRow(from));
+            }
+        }
+        if (capture) {
+            san += 'x';
+        }
+        san += char('a' + squareCol(to));
+        san += char('1' + squareRow(to));
+        if (move.isPromotion()) {
+            san += '=';
+            san += "PNBRQK"[move.promotionIndex()];
         }
     }
 
-    cout << endl;
+    makeMove(move);
+    GameStatus status = computeGameStatus();
+    unmakeMove();
+    if (status == GAME_CHECK) {
+        san += '+';
+    } else if (status == GAME_CHECKMATE) {
+        san += '#';
+    }
+    return san;
+}
 
-    // Switch turn to the other player
-    whiteToMove = !whiteToMove; 
-    
+/* Played moves are only kept for their history, so when the undo stack fills up the
+   oldest half is dropped, leaving room for a search below the current position */
+void ChessGame::trimHistory() {
+    if (undoCount > UNDO_STACK_SIZE - 256) {
+        int kept = undoCount / 2;
+        memmove(undoStack, undoStack + (undoCount - kept), kept * sizeof(UndoRecord));
+        undoCount = kept;
+    }
+}
+
+/* The undo stack already holds the key of every earlier position, the one `back` plies ago at
+   undoCount - back. A capture or pawn move can never be undone, so nothing older than the halfmove
+   clock can match, and only every second position has the same side to move: the scan starts four
+   plies back and steps by two through that window */
+int ChessGame::repetitionCount(int limit) const {
+    int window = min(halfmoveClock, undoCount);
+    int count = 0;
+    for (int back = 4; back <= window && count < limit; back += 2) {
+        count += undoStack[undoCount - back].hashKey == hashKey;
+    }
+    return count;
+}
+
+/* Hands the move to the other side, keeping the position key in step */
+void ChessGame::switchSide() {
+    whiteToMove = !whiteToMove;
+    hashKey ^= zobristBlackToMove;
+}
+
+/* Computes the Zobrist key of the current position from scratch */
+uint64_t ChessGame::computeHashKey() const {
+    uint64_t key = whiteToMove ? 0 : zobristBlackToMove;
+    Bitboard pieces = board.occupied;
+    while (pieces) {
+        int square = popLsb(pieces);
+        key ^= zobristPieces[pieceIndex(board.squares[square])][square];
+    }
+    return key ^ zobristCastling[castlingRights] ^ enPassantKey();
+}
+
+/* Runs the attached network on the board's accumulator, or tapers the board's running totals by the
+   game phase */
+int ChessGame::evaluate() const {
+    if (board.network) {
+        int score = board.network->evaluate(board.accumulator, whiteToMove ? WHITE : BLACK);
+        assert(score == (whiteToMove ? evaluateFromScratch() : -evaluateFromScratch()));
+        return score;
+    }
+    int score = taperedScore(board.mgScore, board.egScore, board.phase);
+    assert(score == evaluateFromScratch());
+    return whiteToMove ? score : -score;
+}
+
+/* Rebuilds the network's accumulator, or sums the piece-square tables over the occupied squares */
+int ChessGame::evaluateFromScratch() const {
+    if (board.network) {
+        NnueAccumulator accumulator;
+        board.network->refresh(board, WHITE, accumulator);
+        board.network->refresh(board, BLACK, accumulator);
+        int score = board.network->evaluate(accumulator, whiteToMove ? WHITE : BLACK);
+        return whiteToMove ? score : -score;
+    }
+    int mg = 0, eg = 0, phase = 0;
+    Bitboard pieces = board.occupied;
+    while (pieces) {
+        int square = popLsb(pieces);
+        int index = pieceIndex(board.squares[square]);
+        mg += pieceSquareMg[index][square];
+        eg += pieceSquareEg[index][square];
+        phase += phaseWeight[index];
+    }
+    return taperedScore(mg, eg, phase);
+}
+
+/* Searches for the best move of the side to move within the given budget; helper threads, if any,
+   share the caller's transposition table */
+SearchResult ChessGame::search(const SearchLimits& limits, TranspositionTable& table) {
+    if (limits.threads > 1) {
+        return parallelSearch(*this, limits, table);
+    }
+
+    // The searcher raises its own flag when the budget runs out and only reads limits.stopSignal
+    atomic<bool> stop(false);
+    Searcher searcher(*this, table, stop);
+    return searcher.run(limits);
+}
+
+/* Counts the leaf nodes of the legal move tree for the side to move, down to the given depth */
+unsigned long long ChessGame::perft(int depth) {
+    if (depth == 0) {
+        return 1;
+    }
+
+    MoveList moves;
+    generateLegalMoves(moves);
+    // Every generated move is legal, so the last ply is counted without playing it
+    if (depth == 1) {
+        return moves.size();
+    }
+
+    unsigned long long nodes = 0;
+    for (int i = 0; i < moves.size(); i++) {
+        makeMove(moves[i]);
+        nodes += perft(depth - 1);
+        unmakeMove();
+    }
+    return nodes;
+}
+
+/* Runs perft and prints the number of leaf nodes below each root move (e.g. "e2e4: 20") */
+unsigned long long ChessGame::perftDivide(int depth) {
+    if (depth <= 0) {
+        return 1;
+    }
+
+    MoveList moves;
+    generateLegalMoves(moves);
+    unsigned long long nodes = 0;
+    for (int i = 0; i < moves.size(); i++) {
+        makeMove(moves[i]);
+        unsigned long long childNodes = perft(depth - 1);
+        unmakeMove();
+        cout << moves[i].toString() << ": " << childNodes << '\n';
+        nodes += childNodes;
+    }
+    cout << "Nodes searched: " << nodes << endl;
+    return nodes;
+}
+
+/* Perft on the temporary-move helpers, as it was before makeMove/unmakeMove; it knows nothing of castling,
+   en passant or promotion and is only kept as a baseline for the move-making benchmark */
+unsigned long long ChessGame::perftTemporaryMoves(int depth) {
+    if (depth == 0) {
+        return 1;
+    }
+
+    unsigned long long nodes = 0;
+    Bitboard movers = board.colours[whiteToMove ? WHITE : BLACK];
+    while (movers) {
+        int startSquare = popLsb(movers);
+
+        MoveList legalMoves;
+        getLegalMoves(board, startSquare, legalMoves);
+        for (int i = 0; i < legalMoves.size(); i++) {
+            int endSquare = legalMoves[i].to();
+
+            char capturedPiece = board.squares[endSquare]; // Save the piece being captured (if any)
+            performTemporaryMove(startSquare, endSquare, capturedPiece);
+            // Only moves that keep our own king safe are part of the tree
+            if (isKingSafe(whiteToMove)) {
+                switchSide();
+                nodes += perftTemporaryMoves(depth - 1);
+                switchSide();
+            }
+            undoTemporaryMove(startSquare, endSquare, capturedPiece);
+        }
+    }
+    return nodes;
 }
 
 /* Prints the current state of the chessboard with row and column labels. */  
@@ -402,9 +1288,10 @@ void ChessGame::printBoard() const {
         cout << i + 1  << " ";  // Row labels
 
         for (int j = 0; j < 8; j++) {
-            if (board[i][j] != nullptr) {
+            char type = board.squares[makeSquare(i, j)];
+            if (type != 0) {
                 // Display the piece type or symbol
-                cout << "| " << board[i][j]->getType() << " ";
+                cout << "| " << type << " ";
             } else {
                 cout << "|   ";  // Empty square
 	        }
@@ -414,25 +1301,3 @@ void ChessGame::printBoard() const {
         cout << "  ---------------------------------" << endl;
     }
 }
-
-/* Creates and returns a new chess piece object based on the provided type, row, and column. */
-ChessPiece* ChessGame::createChessPiece(char type, int row, int col){
-
-    switch (type) {
-        case 'p': return new Pawn('p', row, col);
-        case 'P': return new Pawn('P', row, col);
-        case 'r': return new Rook('r', row, col);  
-        case 'R': return new Rook('R', row, col);
-        case 'n': return new Knight('n', row, col);
-        case 'N': return new Knight('N', row, col);
-        case 'b': return new Bishop('b', row, col);
-        case 'B': return new Bishop('B', row, col);
-        case 'q': return new Queen('q', row, col);
-        case 'Q': return new Queen('Q', row, col);
-        case 'k': return new King('k', row, col);
-        case 'K': return new King('K', row, col);
-
-        default: return nullptr; // Invalid character  
-    }
-}
-
@@ -1,52 +1,279 @@
 #ifndef CHESSGAME_H
 #define CHESSGAME_H
 #include <iostream>
-#include <vector>
 #include <string>
+#include <string_view>
+#include "Bitboard.h"
+#include "Move.h"
+#include "OutputSink.h"
+#include "Search.h"
 
 using namespace std;
 
-/* forward declaration of ChessPiece class */
-class ChessPiece;
+/* Castling rights, one bit per side and wing */
+enum CastlingRight { WHITE_KINGSIDE = 1, WHITE_QUEENSIDE = 2, BLACK_KINGSIDE = 4, BLACK_QUEENSIDE = 8 };
+
+/* Outcome of parsing a FEN string */
+enum FenStatus {
+  FEN_OK,
+  FEN_BAD_PLACEMENT,
+  FEN_BAD_KINGS,
+  FEN_BAD_SIDE,
+  FEN_BAD_CASTLING,
+  FEN_BAD_EN_PASSANT,
+  FEN_BAD_CLOCK,
+  FEN_TRAILING_TEXT
+};
+
+/* Parse status plus the offset of the offending character in the input */
+struct FenResult {
+  FenStatus status;
+  size_t position;
+  bool ok() const { return status == FEN_OK; }
+};
+
+/* Returns a human-readable description of a FEN parse status */
+const char* fenStatusMessage(FenStatus status);
+
+/* Outcome for the side to move */
+enum GameStatus { GAME_NORMAL, GAME_CHECK, GAME_CHECKMATE, GAME_STALEMATE };
+
+/* Outcome of submitMove */
+enum MoveStatus {
+  MOVE_OK,
+  MOVE_OUT_OF_BOUNDS,          // a square is off the board
+  MOVE_NO_PIECE,               // nothing stands on the start square
+  MOVE_WRONG_TURN,             // the piece belongs to the side not to move
+  MOVE_LEAVES_KING_IN_CHECK,   // the piece moves that way, but not while its king would be attacked
+  MOVE_ILLEGAL                 // the piece cannot move to the target square
+};
+
+/* What submitMove did, for callers that want the facts rather than the printed report */
+struct MoveResult {
+  MoveStatus status;
+  Move move;           // the move played; only set for MOVE_OK
+  char piece;          // FEN code of the piece on the start square, 0 if none
+  char capturedPiece;  // FEN code of the piece taken, 0 if none
+  bool check;          // the opponent is now in check (but can move)
+  bool checkmate;      // the opponent is checkmated
+  bool stalemate;      // the opponent has no legal move and is not in check
+  bool threefoldRepetition; // the position has now occurred three times (and is not checkmate)
+  bool fiftyMoveDraw;  // fifty moves by each side without a capture or pawn move (and not checkmate)
+  bool ok() const { return status == MOVE_OK; }
+};
+
+/* Outcome of reading a move in standard algebraic notation (e.g. "Nbd7", "exd8=Q+", "O-O") */
+enum SanStatus { SAN_OK, SAN_MALFORMED, SAN_ILLEGAL, SAN_AMBIGUOUS };
+
+/* Returns a human-readable description of a SAN status */
+const char* sanStatusMessage(SanStatus status);
+
+/* State that makeMove overwrites and unmakeMove needs back, pushed once per move (16 bytes) */
+struct UndoRecord {
+  uint64_t hashKey;
+  Move move;
+  char capturedPiece;     // 0 if the move captured nothing
+  uint8_t castlingRights;
+  int8_t enPassantSquare;
+  uint8_t unused;
+  uint16_t halfmoveClock;
+};
+
+/* A position packed into 32 bytes, for keeping many games in memory: the occupied squares, then
+   the pieces on them in square order (A1 first), one pieceIndex() per nibble, low nibble first */
+struct PackedPosition {
+  uint64_t occupied;
+  uint8_t pieces[16];       // room for 32 pieces
+  uint8_t flags;            // bit 0 set when black is to move, bits 1-4 the CastlingRight bits
+  uint8_t enPassantSquare;  // 64 if none
+  uint16_t halfmoveClock;
+  uint16_t fullmoveNumber;
+  uint16_t reserved;        // always 0
+};
+
+/* The whole position of a game, without its move history or cached moves: a plain value that can
+   be copied with memcpy, stored or handed to another thread, and restored into any game. The board
+   keeps its evaluation totals and network accumulator, so nothing is recomputed on restore into a
+   game with the same network */
+struct PositionSnapshot {
+  Board board;
+  int8_t kingSquare[2];
+  bool whiteToMove;
+  uint8_t castlingRights;
+  int8_t enPassantSquare;
+  int halfmoveClock;
+  int fullmoveNumber;
+  uint64_t hashKey;
+};
 
 /* ChessGame class represents the entire chess game */
 class ChessGame {
 
   private:
-    // 8x8 board that holds pointers to ChessPiece objects
-    ChessPiece* board[8][8];
+    // Bitboard position: one bitboard per piece type plus colour occupancy
+    Board board;
+    // Square of each side's king (indexed by WHITE/BLACK), -1 if absent; updated on every move
+    int kingSquare[2];
     // Flag indicating whether it's white's turn to move
     bool whiteToMove;
-    // String representing the castling rights in FEN notation
-    string castlingRights;
+    // Castling rights still available (CastlingRight bits)
+    int castlingRights;
+    // Square a pawn can be captured on en passant, -1 if none
+    int enPassantSquare;
+    // Half-moves since the last capture or pawn move, and the current move number
+    int halfmoveClock;
+    int fullmoveNumber;
+    // Zobrist key of the current position, updated incrementally by every move
+    uint64_t hashKey;
+
+    // Moves played since the position was loaded, most recent last, so they can be taken back
+    static const int UNDO_STACK_SIZE = 1024;
+    UndoRecord undoStack[UNDO_STACK_SIZE];
+    int undoCount;
+
+    // Where submitMove and loadState print their reports, nullptr for nowhere; not owned
+    OutputSink* output;
+
+    // Legal moves of the side to move, kept between computeGameStatus and the next submitMove;
+    // valid while the position key still matches
+    MoveList cachedMoves;
+    uint64_t cachedMovesKey;
+    bool cachedMovesValid;
+
+    /* Hands the move to the other side, keeping the position key in step */
+    void switchSide();
+    /* Zobrist key of the en passant square, or 0 when no pawn of the side to move can capture there */
+    uint64_t enPassantKey() const;
+    /* Drops the oldest played moves when the undo stack is nearly full */
+    void trimHistory();
+    /* Checks whether the given side has any move that does not leave its king attacked */
+    bool hasLegalMove(bool forWhite);
+    /* Appends the castling moves of the side to move */
+    void addCastlingMoves(MoveList& moves) const;
+    /* Returns the pieces of the given colour attacking the square, sliders seeing through the given occupancy */
+    Bitboard attackersOf(int square, int colour, Bitboard occupied) const;
+
+    // The search plays moves directly on the board state
+    friend class Searcher;
   
   public:
     // Constructor initializes a new chess game
     ChessGame();
-    // Destructor cleans up dynamically allocated memory
-    ~ChessGame();
+    // Pieces are stored by value in the board, so the default copy is a full independent copy
+    // (e.g. one game per search thread) and no destructor is needed
 
-    /* Loads the chess game state from a FEN string */
-    void loadState(const char* fen);
-    /* Submits a move from one position to another */
-    void submitMove(const char* pos_from, const char* pos_to);
+    /* Parses a full FEN string into the game; on failure the game is unchanged */
+    FenResult parseFen(string_view fen);
+    /* Loads the chess game state from a FEN string, optionally without the announcement;
+       malformed input is reported as an error to the output sink and leaves the game unchanged */
+    FenResult loadState(const char* fen, bool announce = true);
+    /* Returns the position as a six-field FEN string */
+    string toFen() const;
+    /* Packs the position into 32 bytes (the move history is not kept); returns false if the board
+       has more than 32 pieces. A fullmove number past 65535 is stored as 65535 */
+    bool pack(PackedPosition& packed) const;
+    /* Replaces the position with a packed one; returns false, leaving the game unchanged, if the
+       record does not hold a position parseFen would accept */
+    bool unpack(const PackedPosition& packed);
+    /* Copies the position out (about 1.3 KB, against some 18 KB for a copy of the whole game) */
+    void snapshot(PositionSnapshot& position) const;
+    /* Replaces the position with a snapshot, starting a fresh move history; the game keeps its own
+       network, recomputing the accumulator if the snapshot was taken under a different one */
+    void restore(const PositionSnapshot& position);
+    /* Submits a move from one square to another (e.g. "E2", "E4"), plays it if it is legal and
+       reports the outcome to the output sink; the returned result carries the same facts */
+    MoveResult submitMove(const char* pos_from, const char* pos_to);
+    /* Sends the printed reports to the given sink (the console by default, nullptr for none); the
+       sink must outlive the game and its copies */
+    void setOutput(OutputSink* sink) { output = sink; }
+    /* Plays a legal move in coordinate notation (e.g. "e2e4", "e7e8q"); returns false if it is not legal.
+       Whether the move draws the game is left to isThreefoldRepetition and isFiftyMoveDraw */
+    bool playMove(string_view coordinates);
+    /* Finds the legal move a SAN string names; check and annotation suffixes ("+", "#", "!?") are
+       accepted and ignored, and castling may be written with zeros. move is set only on SAN_OK */
+    SanStatus parseSan(string_view san, Move& move);
+    /* Plays a legal move given in SAN; the position is unchanged unless the result is SAN_OK */
+    SanStatus playSan(string_view san);
+    /* Writes a legal move of the side to move in SAN, with the least disambiguation needed and a
+       "+" or "#" suffix */
+    string toSan(Move move);
+    /* Returns true if it is white's turn to move */
+    bool isWhiteToMove() const { return whiteToMove; }
+    /* Accessors for the remaining FEN state */
+    int getCastlingRights() const { return castlingRights; }
+    int getEnPassantSquare() const { return enPassantSquare; }
+    int getHalfmoveClock() const { return halfmoveClock; }
+    int getFullmoveNumber() const { return fullmoveNumber; }
+    /* Read-only view of the bitboard position */
+    const Board& getBoard() const { return board; }
     /* Prints the current state of the chessboard */
     void printBoard() const;
+    /* Checks if any piece of the given colour attacks the square */
+    bool isSquareAttacked(int square, bool byWhite) const;
     /* Checks if the king of the given color is in a safe position */
     bool isKingSafe(const bool kingIsWhite);
     /* Finds and returns the position of the king for the specified color */
     pair<int, int> findKingPos(char kingType);
+    /* Computes check, checkmate or stalemate for the side to move from one generation of its legal moves */
+    GameStatus computeGameStatus();
+    /* Returns the legal moves of the side to move, reusing the list cached by computeGameStatus */
+    const MoveList& legalMoveList();
     /* Checks if the given player's opponent is in checkmate */
     bool isCheckMate(const bool opponentIsWhite);
     /* Checks if the given player's opponent is in stalemate */
     bool isStaleMate(const bool opponentIsWhite);
-    /* Performs a temporary move on the board for the given piece */
-    void performTemporaryMove(ChessPiece*& piece, int startRow, int startCol, int endRow, int endCol, ChessPiece*& capturedPiece);
-    /* Undoes a temporary move and restores the previous state */
-    void undoTemporaryMove(ChessPiece*& piece, int startRow, int startCol, int endRow, int endCol, ChessPiece*& capturedPiece);
+    /* Appends every pseudo-legal move of the side to move, including castling, en passant and promotions */
+    void generateMoves(MoveList& moves) const;
+    /* Appends only the legal moves of the side to move, using check and pin masks instead of trying each move */
+    void generateLegalMoves(MoveList& moves) const;
+    /* Plays a pseudo-legal move of the side to move and hands the turn over; the caller checks that
+       the mover's king is not left attacked */
+    void makeMove(Move move);
+    /* Takes back the last move played by makeMove; does nothing when there is none */
+    void unmakeMove();
+
+    /* Performs a temporary move of the piece on startSquare; capturedPiece is the code on endSquare (0 if empty) */
+    void performTemporaryMove(int startSquare, int endSquare, char capturedPiece);
+    /* Undoes a temporary move and restores the captured piece */
+    void undoTemporaryMove(int startSquare, int endSquare, char capturedPiece);
+
+    /* Counts the earlier occurrences of the current position in the move history, stopping at the
+       given limit. Only the moves since the last capture or pawn move are looked at */
+    int repetitionCount(int limit = 2) const;
+    /* True if the current position occurred before since the last capture or pawn move; cheap
+       enough for every search node, which scores such a position as a draw */
+    bool isRepetition() const { return repetitionCount(1) > 0; }
+    /* True if the current position is on the board for the third time */
+    bool isThreefoldRepetition() const { return repetitionCount(2) >= 2; }
+    /* True once fifty moves by each side have been played without a capture or pawn move */
+    bool isFiftyMoveDraw() const { return halfmoveClock >= 100; }
+
+    /* Returns the Zobrist key of the current position */
+    uint64_t getHashKey() const { return hashKey; }
+    /* Computes the Zobrist key of the current position from scratch */
+    uint64_t computeHashKey() const;
+
+    /* Static evaluation in centipawns from the side to move's point of view: the attached network
+       if there is one, otherwise material and piece-square terms tapered between middlegame and
+       endgame. Either way it reads state the board keeps up to date move by move (checked against
+       evaluateFromScratch in debug builds) */
+    int evaluate() const;
+    /* The same evaluation recomputed by scanning every piece, from white's point of view */
+    int evaluateFromScratch() const;
+    /* Evaluates with the given network from now on (nullptr returns to the piece-square tables); the
+       network must outlive the game and its copies */
+    void setNetwork(const NnueNetwork* network) { board.setNetwork(network); }
+
+    /* Searches for the best move of the side to move within the given budget, keeping what it
+       learns in the given transposition table (which several games may share, one search at a time) */
+    SearchResult search(const SearchLimits& limits, TranspositionTable& table);
 
-     /* Creates a new ChessPiece of the specified type at the given position */
-    ChessPiece* createChessPiece(char type, int row, int col);
+    /* Counts the leaf nodes of the legal move tree to the given depth */
+    unsigned long long perft(int depth);
+    /* Like perft, but prints the node count below each root move */
+    unsigned long long perftDivide(int depth);
+    /* Perft on the temporary-move helpers (no castling, en passant or promotion), kept as a benchmark baseline */
+    unsigned long long perftTemporaryMoves(int depth);
 };
 
 #endif
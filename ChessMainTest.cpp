@@ -1,8 +1,44 @@
 #include <iostream>
+#include <cstdlib>
+#include <new>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+#include <sstream>
+#include <atomic>
+#include <type_traits>
 #include "ChessGame.h"
+#include "TranspositionTable.h"
+#include "OpeningBook.h"
+#include "Tablebase.h"
+#include "Nnue.h"
+#include "Sessions.h"
+#include "Dataset.h"
+#include <sys/stat.h>
+#include <unistd.h>
 
 using std::cout;
 
+// Counts heap allocations so the tests can check that move validation stays off the heap
+static size_t allocationCount = 0;
+
+void* operator new(size_t size) {
+	allocationCount++;
+	if (void* memory = malloc(size)) {
+		return memory;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+	free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+	free(memory);
+}
+
 
 int main() {
 
@@ -143,7 +179,806 @@ int main() {
     cg.printBoard();
     cg.submitMove("G4", "G3");
 	cg.printBoard();
- 
-	
+
+	cout << "========================================\n";
+	cout << "Perft Test (Initial Position)\n";
+	cout << "========================================\n";
+
+	cg.loadState("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq");
+	for (int depth = 1; depth <= 3; depth++) {
+		cout << "Depth " << depth << ": " << cg.perft(depth) << " nodes\n"; // 20, 400, 8902
+	}
+
+	cout << "========================================\n";
+	cout << "Heap Allocation Test (Scholars Mate)\n";
+	cout << "========================================\n";
+
+	cg.loadState("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq");
+	size_t allocationsBefore = allocationCount;
+	cg.submitMove("E2", "E4");
+	cg.submitMove("E7", "E5");
+	cg.submitMove("F1", "C4");
+	cg.submitMove("B8", "C6");
+	cg.submitMove("D1", "H5");
+	cg.submitMove("G8", "F6");
+	cg.submitMove("H5", "F7"); // checkmate
+	cout << "Heap allocations during submitMove: " << allocationCount - allocationsBefore << '\n'; // 0
+
+	cout << "========================================\n";
+	cout << "Heap Allocation Test (Reloading Positions)\n";
+	cout << "========================================\n";
+
+	allocationsBefore = allocationCount;
+	for (int i = 0; i < 1000; i++) {
+		cg.loadState("r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq", false);
+		ChessGame copy(cg);
+	}
+	cout << "Heap allocations during 1000 loads and copies: " << allocationCount - allocationsBefore << '\n'; // 0
+
+	cout << "========================================\n";
+	cout << "FEN Parsing Test (All Fields, Errors)\n";
+	cout << "========================================\n";
+
+	cg.loadState("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", false);
+	cg.submitMove("E2", "E4");
+	cout << cg.toFen() << '\n'; // rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1
+	cg.submitMove("G8", "F6");
+	cg.submitMove("E1", "E2");
+	cout << cg.toFen() << '\n'; // rnbqkb1r/pppppppp/5n2/8/4P3/8/PPPPKPPP/RNBQ1BNR b kq - 2 2
+
+	const char* roundTrip = "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 7 23";
+	cg.parseFen(roundTrip);
+	cout << "Round trip preserves all six fields: " << (cg.toFen() == roundTrip ? "yes" : "no") << '\n';
+
+	const char* badFens[] = {
+		"rnbqkbnr/pppppppp/9/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", // bad digit
+		"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQ1BNR w KQkq - 0 1", // no white king
+		"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR x KQkq - 0 1", // bad side
+		"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkx - 0 1", // bad castling
+		"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq e4 0 1", // bad en passant
+		"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - x 1", // bad clock
+	};
+	for (const char* fen : badFens) {
+		FenResult result = cg.parseFen(fen);
+		cout << fenStatusMessage(result.status) << " at character " << result.position << '\n';
+	}
+	cout << "Game unchanged after errors: " << (cg.toFen() == roundTrip ? "yes" : "no") << '\n';
+
+	cout << "========================================\n";
+	cout << "Make/Unmake Test (Castling, En Passant, Promotion)\n";
+	cout << "========================================\n";
+
+	cg.loadState("r3k2r/1P1p4/8/4P3/8/8/8/R3K2R b KQkq - 0 1", false);
+	const char* specialStart = "r3k2r/1P1p4/8/4P3/8/8/8/R3K2R b KQkq - 0 1";
+	cg.submitMove("D7", "D5");
+	cg.submitMove("E5", "D6"); // en passant
+	cg.submitMove("E8", "G8"); // castling
+	cg.submitMove("B7", "A8"); // promotion with capture
+	cg.submitMove("G8", "G7");
+	cg.submitMove("E1", "C1"); // castling
+	cout << cg.toFen() << '\n'; // Q4r2/6k1/3P4/8/8/8/8/2KR3R b - - 2 4
+	cout << "Incremental key matches full recomputation: "
+	     << (cg.getHashKey() == cg.computeHashKey() ? "yes" : "no") << '\n';
+	for (int i = 0; i < 6; i++) {
+		cg.unmakeMove();
+	}
+	cout << "Unmaking every move restores the position: " << (cg.toFen() == specialStart ? "yes" : "no") << '\n';
+
+	cout << "========================================\n";
+	cout << "Legal Move Generator Test (Pins, Checks, En Passant)\n";
+	cout << "========================================\n";
+
+	const char* legalTestFens[] = {
+		"4k3/8/8/8/4r3/8/4B3/4K3 w - - 0 1",          // bishop pinned on the file
+		"4k3/8/8/8/8/3n4/8/R3K2r w - - 0 1",          // double check: king moves only
+		"8/8/8/KPp4r/8/8/8/7k w - c6 0 1",            // en passant would expose the king along the rank
+		"8/8/8/2k5/3Pp3/8/8/4K3 b - d3 0 1",          // en passant captures the checking pawn
+		"r3k2r/8/8/8/8/8/8/R3K1r1 w Qkq - 0 1",       // in check: no castling
+	};
+	for (const char* fen : legalTestFens) {
+		cg.parseFen(fen);
+		MoveList legal, pseudoLegal;
+		cg.generateLegalMoves(legal);
+		cg.generateMoves(pseudoLegal);
+		// Reference: play each pseudo-legal move and keep those that leave the mover's king safe
+		int expected = 0;
+		for (int i = 0; i < pseudoLegal.size(); i++) {
+			cg.makeMove(pseudoLegal[i]);
+			expected += cg.isKingSafe(!cg.isWhiteToMove());
+			cg.unmakeMove();
+		}
+		cout << legal.size() << " legal moves, make/test reference " << expected << '\n';
+	}
+
+	cout << "========================================\n";
+	cout << "Game Status Test (Single Pass)\n";
+	cout << "========================================\n";
+
+	const char* statusNames[] = {"normal", "check", "checkmate", "stalemate"};
+	const char* statusFens[] = {
+		"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+		"rnbqkbnr/ppp2ppp/8/1B1pp3/4P3/8/PPPP1PPP/RNBQK1NR b KQkq - 1 3",
+		"r1bqkb1r/pppp1Qpp/2n2n2/4p3/2B1P3/8/PPPP1PPP/RNB1K1NR b KQkq - 0 4",
+		"8/8/8/8/8/6p1/5k2/7K w - - 0 1",
+	};
+	for (const char* fen : statusFens) {
+		cg.parseFen(fen);
+		cout << statusNames[cg.computeGameStatus()] << ", " << cg.legalMoveList().size() << " legal moves\n";
+	}
+
+	cout << "========================================\n";
+	cout << "Zobrist Hash Test (Transposition)\n";
+	cout << "========================================\n";
+
+	cg.loadState("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq");
+	cg.submitMove("G1", "F3");
+	cg.submitMove("G8", "F6");
+	cg.submitMove("B1", "C3");
+	uint64_t firstOrderKey = cg.getHashKey();
+	cout << "Incremental key matches full recomputation: "
+	     << (firstOrderKey == cg.computeHashKey() ? "yes" : "no") << '\n';
+
+	cg.loadState("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq");
+	cg.submitMove("B1", "C3");
+	cg.submitMove("G8", "F6");
+	cg.submitMove("G1", "F3");
+	cout << "Both move orders give the same key: "
+	     << (firstOrderKey == cg.getHashKey() ? "yes" : "no") << '\n';
+
+	TranspositionTable tt(1);
+	tt.store(firstOrderKey, Move(12, 28), 35, 6, BOUND_EXACT);
+	TTEntry entry;
+	bool hit = tt.probe(firstOrderKey, entry);
+	cout << "Transposition table hit: " << (hit ? "yes" : "no")
+	     << ", depth " << entry.depth << ", score " << entry.score << '\n'; // yes, depth 6, score 35
+	cout << "Transposition table miss on another key: "
+	     << (tt.probe(firstOrderKey ^ 1, entry) ? "no" : "yes") << '\n';
+
+	cout << "========================================\n";
+	cout << "Search Test (Mate in One)\n";
+	cout << "========================================\n";
+
+	TranspositionTable searchTable(16);
+	cg.loadState("r1bqkb1r/pppp1ppp/2n2n2/4p2Q/2B1P3/8/PPPP1PPP/RNB1K1NR w KQkq");
+	SearchLimits limits;
+	limits.depth = 4;
+	SearchResult result = cg.search(limits, searchTable);
+	cout << "Best move: " << result.bestMove.toString() // h5f7
+	     << (result.score == MATE_SCORE - 1 ? " (mate in 1)" : " (no mate found)") << '\n';
+
+	cout << "========================================\n";
+	cout << "Search Test (Winning Material)\n";
+	cout << "========================================\n";
+
+	// The black queen on D5 is attacked by the knight and undefended
+	cg.loadState("4k3/8/8/3q4/8/4N3/8/4K3 w");
+	limits.depth = 3;
+	result = cg.search(limits, searchTable);
+	cout << "Best move: " << result.bestMove.toString() << '\n'; // e3d5
+	cout << "Board unchanged after search: "
+	     << (cg.getHashKey() == cg.computeHashKey() ? "yes" : "no") << '\n';
+
+	// A search stopped before its first iteration completes still answers with a legal move,
+	// and reports no completed depth
+	cg.loadState("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", false);
+	std::atomic<bool> raised(true);
+	for (int budget = 0; budget < 3; budget++) {
+		SearchLimits cutShort;
+		cutShort.nodes = budget == 2 ? 0 : budget + 1;
+		cutShort.stopSignal = budget == 2 ? &raised : nullptr;
+		SearchResult stopped = cg.search(cutShort, searchTable);
+		bool legal = false;
+		const MoveList& rootMoves = cg.legalMoveList();
+		for (int i = 0; i < rootMoves.size(); i++) {
+			legal |= rootMoves[i] == stopped.bestMove;
+		}
+		cout << (budget == 2 ? "Stopped before starting" : budget == 0 ? "One node" : "Two nodes")
+		     << ": legal move " << (legal ? "yes" : "no") << ", depth " << stopped.depth << '\n';
+	}
+
+	cout << "========================================\n";
+	cout << "Search Test (Lazy SMP, Two Threads)\n";
+	cout << "========================================\n";
+
+	cg.loadState("r1bqkb1r/pppp1ppp/2n2n2/4p2Q/2B1P3/8/PPPP1PPP/RNB1K1NR w KQkq");
+	limits.depth = 4;
+	limits.threads = 2;
+	result = cg.search(limits, searchTable);
+	cout << "Best move: " << result.bestMove.toString() << '\n'; // h5f7
+
+	cout << "========================================\n";
+	cout << "Opening Book Test (Memory-Mapped Polyglot File)\n";
+	cout << "========================================\n";
+
+	// Published Polyglot keys: the initial position, and one with an en passant capture available
+	cg.parseFen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+	cout << "Initial position key: " << (polyglotKey(cg) == 0x463b96181691fc9cULL ? "matches" : "differs") << '\n';
+	cg.parseFen("rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3");
+	cout << "En passant key: " << (polyglotKey(cg) == 0x22a48b5a8e47ff78ULL ? "matches" : "differs") << '\n';
+
+	// A small book written in the Polyglot binary layout
+
+	struct TestEntry { uint64_t key; uint16_t move, weight; };
+	std::vector<TestEntry> bookEntries;
+	cg.parseFen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+	uint64_t startKey = polyglotKey(cg);
+	bookEntries.push_back({startKey, uint16_t(27 | 11 << 6), 20}); // d2d4
+	bookEntries.push_back({startKey, uint16_t(28 | 12 << 6), 10}); // e2e4
+	bookEntries.push_back({startKey, uint16_t(36 | 12 << 6), 5});  // e2e5, not legal
+	cg.parseFen("r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1");
+	bookEntries.push_back({polyglotKey(cg), uint16_t(7 | 4 << 6), 1}); // e1h1, kingside castling
+	cg.parseFen("4k3/P7/8/8/8/8/8/4K3 w - - 0 1");
+	bookEntries.push_back({polyglotKey(cg), uint16_t(56 | 48 << 6 | 2 << 12), 1}); // a7a8b
+	std::stable_sort(bookEntries.begin(), bookEntries.end(),
+		[](const TestEntry& a, const TestEntry& b) { return a.key < b.key; });
+	FILE* bookFile = fopen("book_test.bin", "wb");
+	for (const TestEntry& entry : bookEntries) {
+		unsigned char bytes[16] = {};
+		for (int index = 0; index < 8; index++) {
+			bytes[index] = (unsigned char)(entry.key >> (56 - 8 * index));
+		}
+		bytes[8] = (unsigned char)(entry.move >> 8);
+		bytes[9] = (unsigned char)entry.move;
+		bytes[10] = (unsigned char)(entry.weight >> 8);
+		bytes[11] = (unsigned char)entry.weight;
+		fwrite(bytes, 1, sizeof(bytes), bookFile);
+	}
+	fclose(bookFile);
+
+	OpeningBook book;
+	cout << "Open: " << bookStatusMessage(book.open("book_test.bin")) << ", " << book.size() << " entries\n";
+	BookMove bookMoves[MoveList::CAPACITY];
+	cg.parseFen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+	int bookCount = book.probe(cg, bookMoves, MoveList::CAPACITY);
+	cout << "Initial position:";
+	for (int index = 0; index < bookCount; index++) {
+		cout << ' ' << bookMoves[index].move.toString() << " (" << bookMoves[index].weight << ')';
+	}
+	cout << ", best " << book.bestMove(cg).toString() << '\n'; // d2d4 (20) e2e4 (10), best d2d4
+	cg.parseFen("r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1");
+	cout << "Castling: " << book.bestMove(cg).toString() << '\n'; // e1g1
+	cg.parseFen("4k3/P7/8/8/8/8/8/4K3 w - - 0 1");
+	cout << "Promotion: " << book.bestMove(cg).toString() << '\n'; // a7a8b
+	cg.parseFen("4k3/8/8/8/8/8/8/4K3 w - - 0 1");
+	cout << "Position not in book: " << book.probe(cg, bookMoves, MoveList::CAPACITY) << " moves\n";
+	book.close();
+	remove("book_test.bin");
+	cout << "Missing file: " << bookStatusMessage(book.open("book_test.bin")) << '\n';
+
+	cout << "========================================\n";
+	cout << "Tablebase Test (Generation, Probing)\n";
+	cout << "========================================\n";
+
+	// KPvK needs the tables it promotes into, so those are built first
+	mkdir("tb_test", 0755);
+	std::vector<TbGenerationStats> tbStats;
+	std::string tbError;
+	bool generated = generateTablebase("KvKP", "tb_test", 2, tbStats, tbError);
+	cout << "Generated:" << (generated ? "" : (" failed, " + tbError).c_str());
+	for (const TbGenerationStats& table : tbStats) {
+		cout << ' ' << table.material << " (" << table.longestMate << ")";
+	}
+	cout << '\n'; // KQvK 20, KRvK 32 and KPvK 56: the known longest mates in plies
+
+	Tablebases tablebases;
+	cout << "Tables mapped: " << tablebases.open("tb_test") << '\n';
+	const char* tbFens[] = {
+		"4k3/8/4K3/4P3/8/8/8/8 w - - 0 1", // king in front of its pawn: win
+		"4k3/8/4P3/4K3/8/8/8/8 w - - 0 1", // draw with white to move
+		"7k/8/6K1/8/8/8/8/Q7 w - - 0 1",   // mate in 1
+		"7k/6Q1/6K1/8/8/8/8/8 b - - 0 1",  // checkmated
+		"7k/5Q2/6K1/8/8/8/8/8 b - - 0 1",  // stalemate
+		"K7/8/1k6/8/8/8/8/7q b - - 0 1",   // black wins: probed through the colour-flipped KQvK table
+		"8/8/8/8/8/2k5/8/K6R w - - 0 1",
+	};
+	const char* outcomeNames[] = {"loss", "draw", "win"};
+	for (const char* fen : tbFens) {
+		cg.parseFen(fen);
+		TbResult tbResult;
+		if (tablebases.probe(cg, tbResult)) {
+			cout << outcomeNames[tbResult.outcome + 1] << " in " << tbResult.pliesToMate << " plies\n";
+		} else {
+			cout << "not found\n";
+		}
+	}
+	cg.parseFen("8/8/8/8/8/2k5/8/K6R w - - 0 1");
+	limits = SearchLimits();
+	limits.depth = 2;
+	limits.tablebases = &tablebases;
+	result = cg.search(limits, searchTable);
+	cout << "Search with tablebases: " << result.bestMove.toString()
+	     << (result.score == MATE_SCORE - 27 ? " (mate in 27 plies)" : " (score differs)") << '\n';
+	tablebases.close();
+
+	// Damaged copies of a table are refused when opened rather than read past their end when probed
+	std::vector<char> tbBytes;
+	if (FILE* tbFile = fopen("tb_test/KQvK.ctb", "rb")) {
+		char buffer[4096];
+		while (size_t read = fread(buffer, 1, sizeof(buffer), tbFile)) {
+			tbBytes.insert(tbBytes.end(), buffer, buffer + read);
+		}
+		fclose(tbFile);
+	}
+	mkdir("tb_bad", 0755);
+	const char* damageNames[] = {"truncated", "offset past the end", "offsets out of order", "block count"};
+	for (int damage = 0; damage < 4; damage++) {
+		std::vector<char> bad = tbBytes;
+		uint64_t* badOffsets = reinterpret_cast<uint64_t*>(bad.data() + 40); // after the 40-byte header
+		if (damage == 0) {
+			bad.resize(bad.size() - 16);
+		} else if (damage == 1) {
+			badOffsets[1] = uint64_t(1) << 40;
+		} else if (damage == 2) {
+			badOffsets[1] = badOffsets[2] + 1;
+		} else {
+			reinterpret_cast<uint64_t*>(bad.data() + 16)[0] += 1; // blockCount
+		}
+		FILE* badFile = fopen("tb_bad/KQvK.ctb", "wb");
+		fwrite(bad.data(), 1, bad.size(), badFile);
+		fclose(badFile);
+		cout << "Damaged table (" << damageNames[damage] << "): " << tablebases.open("tb_bad") << " mapped\n";
+		tablebases.close();
+	}
+	remove("tb_bad/KQvK.ctb");
+	rmdir("tb_bad");
+	for (const char* material : {"KQvK", "KRvK", "KBvK", "KNvK", "KPvK"}) {
+		remove(("tb_test/" + std::string(material) + ".ctb").c_str());
+	}
+	rmdir("tb_test");
+
+	cout << "========================================\n";
+	cout << "Evaluation Test (Incremental, Tapered)\n";
+	cout << "========================================\n";
+
+	cg.parseFen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+	cout << "Initial position: " << cg.evaluate() << '\n'; // 0, the position is symmetric
+	cg.playMove("e2e4");
+	cout << "After e2e4, black to move: " << cg.evaluate() << '\n';
+
+	// Every node of a small tree, with castling, en passant and promotions, against a full rescan
+	cg.parseFen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+	unsigned long long evaluatedNodes = 0, mismatches = 0;
+	auto walk = [&](auto&& self, int depth) -> void {
+		evaluatedNodes++;
+		mismatches += cg.evaluate() != (cg.isWhiteToMove() ? 1 : -1) * cg.evaluateFromScratch();
+		if (depth == 0) {
+			return;
+		}
+		MoveList moves;
+		cg.generateLegalMoves(moves);
+		for (Move move : moves) {
+			cg.makeMove(move);
+			self(self, depth - 1);
+			cg.unmakeMove();
+		}
+	};
+	walk(walk, 3);
+	cg.parseFen("8/P5k1/8/8/8/8/5Kp1/8 w - - 0 1");
+	walk(walk, 3);
+	cout << "Incremental matches full evaluation at " << evaluatedNodes << " nodes: "
+	     << (mismatches == 0 ? "yes" : "no") << '\n';
+
+	// The same position seen from the other side scores the same for the side to move
+	cg.parseFen("r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4");
+	int whiteView = cg.evaluate();
+	cg.parseFen("rnbqk2r/pppp1ppp/5n2/2b1p3/4P3/2N2N2/PPPP1PPP/R1BQKB1R b KQkq - 4 4");
+	cout << "Colour-mirrored position scores the same: " << (whiteView == cg.evaluate() ? "yes" : "no") << '\n';
+
+	cout << "========================================\n";
+	cout << "NNUE Test (Incremental Accumulator, SIMD Kernels)\n";
+	cout << "========================================\n";
+
+	NnueNetwork randomNetwork;
+	randomNetwork.randomize(2024);
+	NnueNetwork network;
+	cout << "Missing file: " << nnueStatusMessage(network.load("nnue_missing.bin")) << '\n';
+	FILE* junk = fopen("nnue_test.bin", "wb");
+	fputs("CNN1 not a network", junk);
+	fclose(junk);
+	cout << "Bad header: " << nnueStatusMessage(network.load("nnue_test.bin")) << '\n';
+	randomNetwork.save("nnue_test.bin");
+	cout << "Saved and reloaded: " << nnueStatusMessage(network.load("nnue_test.bin")) << '\n';
+	remove("nnue_test.bin");
+
+	// Every node of two small trees (castling, en passant, promotions, king moves) against a
+	// rebuilt accumulator, and the same scores from each instruction set the processor has
+	const char* nnueFens[] = {
+		"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+		"8/P5k1/8/8/8/8/5Kp1/8 w - - 0 1",
+	};
+	NnueSimd bestSimd = nnueSimd();
+	std::vector<int> scalarScores;
+	unsigned long long nnueNodes = 0, nnueMismatches = 0, simdMismatches = 0;
+	for (NnueSimd simd : {NNUE_SCALAR, NNUE_SSE41, NNUE_AVX2}) {
+		if (!setNnueSimd(simd)) {
+			continue;
+		}
+		size_t visited = 0;
+		auto walkNnue = [&](auto&& self, int depth) -> void {
+			int score = cg.evaluate();
+			if (simd == NNUE_SCALAR) {
+				scalarScores.push_back(score);
+				nnueNodes++;
+				nnueMismatches += score != (cg.isWhiteToMove() ? 1 : -1) * cg.evaluateFromScratch();
+			} else {
+				simdMismatches += score != scalarScores[visited];
+			}
+			visited++;
+			if (depth == 0) {
+				return;
+			}
+			MoveList moves;
+			cg.generateLegalMoves(moves);
+			for (Move move : moves) {
+				cg.makeMove(move);
+				self(self, depth - 1);
+				cg.unmakeMove();
+			}
+		};
+		for (const char* fen : nnueFens) {
+			cg.parseFen(fen);
+			cg.setNetwork(&network);
+			walkNnue(walkNnue, 2);
+		}
+	}
+	setNnueSimd(bestSimd);
+	cout << "Incremental matches rebuilt accumulator at " << nnueNodes << " nodes: "
+	     << (nnueMismatches == 0 ? "yes" : "no") << '\n';
+	cout << "Every supported instruction set agrees with scalar: " << (simdMismatches == 0 ? "yes" : "no") << '\n';
+
+	// The network stays attached through FEN loads and game copies, and the search uses it
+	cg.parseFen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+	ChessGame nnueCopy = cg;
+	nnueCopy.playMove("e2e4");
+	nnueCopy.unmakeMove();
+	cout << "Copy evaluates the same: " << (nnueCopy.evaluate() == cg.evaluate() ? "yes" : "no") << '\n';
+	SearchLimits nnueLimits;
+	nnueLimits.depth = 3;
+	SearchResult nnueResult = cg.search(nnueLimits, searchTable);
+	const MoveList& nnueMoves = cg.legalMoveList();
+	cout << "Search with the network finds a legal move: "
+	     << (std::find(nnueMoves.begin(), nnueMoves.end(), nnueResult.bestMove) != nnueMoves.end() ? "yes" : "no") << '\n';
+	cg.setNetwork(nullptr);
+	cout << "Detached, back to piece-square tables: " << cg.evaluate() << '\n';
+
+	cout << "========================================\n";
+	cout << "SAN Test (Parsing, Writing, Replay)\n";
+	cout << "========================================\n";
+
+	// The Opera Game, with check and annotation suffixes, castling, a capture and mate
+	cg.parseFen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+	const char* operaGame[] = {"e4", "e5", "Nf3", "d6", "d4", "Bg4?", "dxe5", "Bxf3", "Qxf3", "dxe5", "Bc4", "Nf6",
+		"Qb3", "Qe7", "Nc3", "c6", "Bg5", "b5?!", "Nxb5!", "cxb5", "Bxb5+", "Nbd7", "O-O-O", "Rd8",
+		"Rxd7", "Rxd7", "Rd1", "Qe6", "Bxd7+", "Nxd7", "Qb8+!", "Nxb8", "Rd8#"};
+	int sanPlayed = 0;
+	for (const char* san : operaGame) {
+		if (cg.playSan(san) != SAN_OK) {
+			cout << "Rejected " << san << '\n';
+			break;
+		}
+		sanPlayed++;
+	}
+	cout << "Opera Game: " << sanPlayed << " moves, " << (cg.computeGameStatus() == GAME_CHECKMATE ? "checkmate" : "not mate") << '\n';
+
+	// Rejections: ambiguous knights, a move that is not legal, text that is not a move, a promotion without its piece
+	cg.parseFen("rnbqkbnr/1ppppppp/p7/8/4P3/2N5/PPPP1PPP/R1BQKBNR w KQkq - 0 3");
+	Move sanMove;
+	cout << "Ne2: " << sanStatusMessage(cg.parseSan("Ne2", sanMove)) << '\n';
+	cout << "Nge2: " << sanStatusMessage(cg.parseSan("Nge2", sanMove)) << " (" << sanMove.toString() << ")\n";
+	cout << "Ke3: " << sanStatusMessage(cg.parseSan("Ke3", sanMove)) << '\n';
+	cout << "e9: " << sanStatusMessage(cg.parseSan("e9", sanMove)) << '\n';
+	cg.parseFen("8/P5k1/8/8/8/8/5Kp1/8 w - - 0 1");
+	cout << "a8: " << sanStatusMessage(cg.parseSan("a8", sanMove)) << ", a8=N: "
+	     << sanStatusMessage(cg.parseSan("a8=N", sanMove)) << " (" << sanMove.toString() << ")\n";
+
+	// Every move written by toSan reads back as the same move
+	unsigned long long sanMoves = 0, sanMismatches = 0;
+	for (const char* fen : {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+	                        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+	                        "7k/8/8/1N3N2/8/1N3N2/8/K7 w - - 0 1"}) {
+		cg.parseFen(fen);
+		MoveList sanList;
+		cg.generateLegalMoves(sanList);
+		for (Move move : sanList) {
+			Move parsed;
+			sanMismatches += cg.parseSan(cg.toSan(move), parsed) != SAN_OK || parsed != move;
+			sanMoves++;
+		}
+	}
+	cout << "Written and read back: " << sanMoves << " moves, " << sanMismatches << " mismatches\n";
+	cg.parseFen("7k/8/8/1N3N2/8/1N3N2/8/K7 w - - 0 1");
+	cout << "Four knights to d4: " << cg.toSan(Move(makeSquare(4, 1), makeSquare(3, 3))) << ' '
+	     << cg.toSan(Move(makeSquare(2, 5), makeSquare(3, 3))) << '\n';
+
+	cout << "========================================\n";
+	cout << "Move Result Test (Structured Results, Output Sinks)\n";
+	cout << "========================================\n";
+
+	// Reports go to a buffered sink and reach the stream only when it is flushed
+	std::ostringstream sinkText;
+	BufferedSink buffered(sinkText);
+	cg.setOutput(&buffered);
+	cg.loadState("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq");
+	static const char* moveStatusNames[] = {"ok", "out of bounds", "no piece", "wrong turn", "leaves king in check", "illegal"};
+	const char* resultMoves[][2] = {{"E2", "E4"}, {"E2", "E3"}, {"E4", "E5"}, {"D8", "H4"}, {"I1", "A1"},
+		{"F7", "F6"}, {"D1", "H5"}, {"E8", "F7"}, {"G7", "G6"}, {"H5", "G6"}};
+	for (auto& squares : resultMoves) {
+		MoveResult result = cg.submitMove(squares[0], squares[1]);
+		cout << squares[0] << '-' << squares[1] << ": " << moveStatusNames[result.status];
+		if (result.ok()) {
+			cout << " " << result.move.toString() << " piece " << result.piece
+			     << " captured " << (result.capturedPiece ? result.capturedPiece : '-')
+			     << (result.check ? " check" : "") << (result.checkmate ? " checkmate" : "") << (result.stalemate ? " stalemate" : "");
+		}
+		cout << '\n';
+	}
+	cout << "Buffered before flush: " << sinkText.str().size() << " characters\n";
+	buffered.flush();
+	cout << "After flush:\n" << sinkText.str();
+
+	// No sink: the results alone
+	cg.setOutput(nullptr);
+	cg.loadState("7k/8/5K2/6Q1/8/8/8/8 w - - 0 1");
+	MoveResult silent = cg.submitMove("G5", "G7");
+	cout << "Silent Qg7: " << moveStatusNames[silent.status] << (silent.checkmate ? ", checkmate" : "") << '\n';
+	cg.setOutput(&consoleSink());
+
+	cout << "========================================\n";
+	cout << "Session Test (Packed Positions, Sharded Games)\n";
+	cout << "========================================\n";
+
+	// Packing keeps every FEN field and round-trips through unpack
+	PackedPosition packed;
+	ChessGame unpacked;
+	size_t packMismatches = 0;
+	for (const char* fen : {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+	                        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+	                        "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+	                        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 b - - 37 90"}) {
+		cg.parseFen(fen);
+		packMismatches += !cg.pack(packed) || !unpacked.unpack(packed) || unpacked.toFen() != fen ||
+		                  unpacked.getHashKey() != cg.getHashKey();
+	}
+	cout << "Packed position: " << sizeof(PackedPosition) << " bytes, round-trip mismatches: " << packMismatches << '\n';
+	cg.parseFen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+	cg.pack(packed);
+	PackedPosition corrupt = packed;
+	corrupt.pieces[2] = 0xBB; // e1 and f1 become black kings
+	cout << "Unpack extra kings: " << (unpacked.unpack(corrupt) ? "accepted" : "rejected") << '\n';
+
+	// Games are spread over the shards; moves on one game are played in order, and replies counted
+	std::atomic<int> replyCount(0), replyChecks(0);
+	{
+		SessionManager sessions(2, [&](const SessionReply& reply) {
+			replyCount++;
+			replyChecks += reply.result.check;
+		});
+		uint64_t first = sessions.createGame();
+		uint64_t second = sessions.createGame();
+		uint64_t third = sessions.createGame(packed);
+		cout << "Game ids: " << first << ' ' << second << ' ' << third << ", shards: " << sessions.shardCount() << '\n';
+		const char* script[][2] = {{"F2", "F3"}, {"E7", "E5"}, {"G2", "G4"}, {"D8", "H4"}};
+		for (auto& squares : script) {
+			sessions.submitMove(first, squares[0], squares[1]);
+			sessions.submitMove(third, squares[0], squares[1]);
+		}
+		sessions.submitMove(second, "E2", "E5");
+		cout << "Unknown game accepted: " << (sessions.submitMove(99, "E2", "E4") ? "yes" : "no") << '\n';
+		sessions.wait();
+		for (uint64_t id : {first, second, third}) {
+			sessions.getPosition(id, packed);
+			unpacked.unpack(packed);
+			cout << "Game " << id << ": " << unpacked.toFen() << " (" << (unpacked.computeGameStatus() == GAME_CHECKMATE ? "checkmate" : "playing") << ")\n";
+		}
+		SessionStats stats = sessions.stats();
+		cout << "Games: " << stats.games << ", played: " << stats.movesPlayed << ", rejected: " << stats.movesRejected << '\n';
+	}
+	cout << "Replies: " << replyCount << ", with check: " << replyChecks << '\n';
+
+	cout << "========================================\n";
+	cout << "Dataset Test (Binary Records, Index, Streaming)\n";
+	cout << "========================================\n";
+
+	// Five positions, the starting position twice, written with an index
+	const char* datasetFens[] = {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+	                             "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1",
+	                             "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+	                             "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+	                             "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1"};
+	DatasetWriter datasetWriter;
+	datasetWriter.open("dataset_test.cpd", true);
+	for (const char* fen : datasetFens) {
+		cg.parseFen(fen);
+		datasetWriter.add(cg);
+	}
+	cout << "Write: " << datasetStatusMessage(datasetWriter.finish()) << '\n';
+	struct stat datasetInfo;
+	stat("dataset_test.cpd", &datasetInfo);
+	cout << "File size: " << datasetInfo.st_size << " bytes (64 header + 5 x 32 records + 5 x 16 index)\n";
+
+	Dataset dataset;
+	cout << "Open: " << datasetStatusMessage(dataset.open("dataset_test.cpd", false)) << ", records: " << dataset.size()
+	     << ", index: " << (dataset.hasIndex() ? "yes" : "no") << '\n';
+	size_t datasetMismatches = 0;
+	for (uint64_t record = 0; record < dataset.size(); record++) {
+		datasetMismatches += !unpacked.unpack(dataset[record]) || unpacked.toFen() != datasetFens[record];
+	}
+	cout << "Records read back with a different FEN: " << datasetMismatches << '\n';
+	cg.parseFen(datasetFens[0]);
+	uint64_t foundRecords[4];
+	size_t foundCount = dataset.find(cg.getHashKey(), foundRecords, 4);
+	cout << "Starting position found in " << foundCount << " records:";
+	for (size_t i = 0; i < foundCount; i++) {
+		cout << ' ' << foundRecords[i];
+	}
+	cg.parseFen("7k/8/8/8/8/8/8/K7 w - - 0 1");
+	cout << "\nBare kings found in " << dataset.find(cg.getHashKey(), foundRecords, 4) << " records\n";
+	dataset.close();
+
+	// Streaming in chunks of two
+	DatasetReader datasetReader;
+	datasetReader.open("dataset_test.cpd");
+	PackedPosition datasetChunk[2];
+	cout << "Chunks:";
+	while (size_t read = datasetReader.read(datasetChunk, 2)) {
+		cout << ' ' << read;
+	}
+	cout << '\n';
+	datasetReader.close();
+
+	// A file that is not a dataset, and one cut short
+	FILE* badDataset = fopen("dataset_test.cpd", "r+b");
+	fwrite("XXXX", 1, 4, badDataset);
+	fclose(badDataset);
+	cout << "Bad magic: " << datasetStatusMessage(dataset.open("dataset_test.cpd")) << '\n';
+	truncate("dataset_test.cpd", 100);
+	badDataset = fopen("dataset_test.cpd", "r+b");
+	fwrite("CPD1", 1, 4, badDataset);
+	fclose(badDataset);
+	cout << "Truncated: " << datasetStatusMessage(dataset.open("dataset_test.cpd")) << '\n';
+	remove("dataset_test.cpd");
+
+	cout << "========================================\n";
+	cout << "Snapshot Test (Trivially Copyable Positions)\n";
+	cout << "========================================\n";
+
+	cout << "Snapshot: " << sizeof(PositionSnapshot) << " bytes, trivially copyable: "
+	     << (std::is_trivially_copyable<PositionSnapshot>::value ? "yes" : "no") << ", ChessGame: " << sizeof(ChessGame) << " bytes\n";
+	cg.parseFen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+	PositionSnapshot original;
+	cg.snapshot(original);
+
+	// A raw byte copy restores into another game, which can then play on without touching the first
+	std::vector<unsigned char> snapshotBytes(sizeof(PositionSnapshot));
+	memcpy(snapshotBytes.data(), &original, sizeof(original));
+	PositionSnapshot copied;
+	memcpy(&copied, snapshotBytes.data(), sizeof(copied));
+	unpacked.restore(copied);
+	cout << "Restored: " << unpacked.toFen() << '\n';
+	cout << "Same key: " << (unpacked.getHashKey() == cg.getHashKey() ? "yes" : "no")
+	     << ", same evaluation: " << (unpacked.evaluate() == cg.evaluate() ? "yes" : "no")
+	     << ", perft 3: " << unpacked.perft(3) << '\n';
+	unpacked.playMove("e1g1");
+	unpacked.playMove("h3g2");
+	cout << "Fork after O-O hxg2: " << unpacked.toFen() << '\n';
+	cout << "Original untouched: " << cg.toFen() << '\n';
+
+	// A game keeps its own network across a restore: the snapshot's accumulator is taken as it is
+	// when the networks match and recomputed when they do not
+	NnueNetwork snapshotNetwork;
+	snapshotNetwork.randomize(7);
+	cg.setNetwork(&snapshotNetwork);
+	cg.playMove("e5f7");
+	PositionSnapshot withNetwork;
+	cg.snapshot(withNetwork);
+	int networkScore = cg.evaluate();
+	cg.restore(original);
+	cout << "Back to the original: " << (cg.toFen() == "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1" ? "yes" : "no")
+	     << ", network kept: " << (cg.getBoard().network == &snapshotNetwork ? "yes" : "no")
+	     << ", accumulator refreshed: " << (cg.evaluateFromScratch() == (cg.isWhiteToMove() ? cg.evaluate() : -cg.evaluate()) ? "yes" : "no") << '\n';
+	unpacked.restore(withNetwork);
+	cout << "Restored without a network: network " << (unpacked.getBoard().network ? "attached" : "none")
+	     << ", matches from scratch: " << (unpacked.evaluateFromScratch() == (unpacked.isWhiteToMove() ? unpacked.evaluate() : -unpacked.evaluate()) ? "yes" : "no") << '\n';
+	unpacked.setNetwork(&snapshotNetwork);
+	unpacked.restore(withNetwork);
+	cout << "Network snapshot evaluates the same: " << (unpacked.evaluate() == networkScore ? "yes" : "no")
+	     << ", from scratch: " << (unpacked.evaluateFromScratch() == (unpacked.isWhiteToMove() ? networkScore : -networkScore) ? "yes" : "no") << '\n';
+	unpacked.setNetwork(nullptr);
+	cg.setNetwork(nullptr);
+
+	cout << "========================================\n";
+	cout << "Draw Test (Repetition, Fifty-Move Rule)\n";
+	cout << "========================================\n";
+
+	// Knights out and back twice: the starting position comes round a second and a third time
+	cg.parseFen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+	for (int round = 1; round <= 2; round++) {
+		for (const char* move : {"g1f3", "g8f6", "f3g1", "f6g8"}) {
+			cg.playMove(move);
+		}
+		cout << "After round " << round << ": occurrences before " << cg.repetitionCount(3)
+		     << ", repetition " << (cg.isRepetition() ? "yes" : "no")
+		     << ", threefold " << (cg.isThreefoldRepetition() ? "yes" : "no") << '\n';
+	}
+	// A pawn move closes the window: the position after e4 comes back, but nothing from before it
+	for (const char* move : {"e2e4", "g8f6", "g1f3", "f6g8", "f3g1"}) {
+		cg.playMove(move);
+	}
+	cout << "After e4 Nf6 Nf3 Ng8 Ng1: occurrences before " << cg.repetitionCount(3) << '\n';
+	cg.playMove("b8c6");
+	cg.playMove("b1c3");
+	cg.playMove("c6b8");
+	cg.playMove("c3b1");
+	cout << "After Nc6 Nc3 Nb8 Nb1: repetition " << (cg.isRepetition() ? "yes" : "no") << '\n';
+	cg.unmakeMove();
+	cout << "Taken back: repetition " << (cg.isRepetition() ? "yes" : "no") << '\n';
+
+	// The fifty-move rule counts half-moves without a capture or pawn move
+	cg.parseFen("8/8/4k3/8/8/3K4/4R3/8 w - - 99 80");
+	cout << "Clock 99: fifty-move draw " << (cg.isFiftyMoveDraw() ? "yes" : "no");
+	cg.playMove("e2e1");
+	cout << ", after Re1: " << (cg.isFiftyMoveDraw() ? "yes" : "no") << '\n';
+
+	// submitMove reports both draws in its result, and through the sink
+	std::ostringstream drawText;
+	BufferedSink drawSink(drawText);
+	cg.setOutput(&drawSink);
+	cg.parseFen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+	const char* knightMoves[][2] = {{"G1", "F3"}, {"G8", "F6"}, {"F3", "G1"}, {"F6", "G8"}};
+	MoveResult drawResult = {};
+	for (int ply = 0; ply < 8; ply++) {
+		drawResult = cg.submitMove(knightMoves[ply % 4][0], knightMoves[ply % 4][1]);
+		if (ply == 3) {
+			cout << "Second occurrence: threefold " << (drawResult.threefoldRepetition ? "yes" : "no") << '\n';
+		}
+	}
+	cout << "Third occurrence: threefold " << (drawResult.threefoldRepetition ? "yes" : "no")
+	     << ", fifty-move " << (drawResult.fiftyMoveDraw ? "yes" : "no") << '\n';
+	cg.parseFen("8/8/4k3/8/8/3K4/4R3/8 w - - 99 80");
+	drawResult = cg.submitMove("E2", "E1");
+	cout << "Re1 at clock 99: fifty-move " << (drawResult.fiftyMoveDraw ? "yes" : "no")
+	     << ", threefold " << (drawResult.threefoldRepetition ? "yes" : "no") << '\n';
+	// Mate on the hundredth half-move wins rather than draws
+	cg.parseFen("7k/8/6K1/8/8/8/8/R7 w - - 99 80");
+	drawResult = cg.submitMove("A1", "A8");
+	cout << "Ra8# at clock 99: checkmate " << (drawResult.checkmate ? "yes" : "no")
+	     << ", fifty-move " << (drawResult.fiftyMoveDraw ? "yes" : "no") << '\n';
+	cg.setOutput(&consoleSink());
+	drawSink.flush();
+	std::istringstream drawLines(drawText.str());
+	for (std::string line; std::getline(drawLines, line);) {
+		if (line.find("drawn") != std::string::npos) {
+			cout << "Reported: " << line << '\n';
+		}
+	}
+
+	// Down a rook and facing mate, white saves the game by perpetual check
+	cg.parseFen("5r1k/5p1p/8/8/3Q4/q7/5PPP/6K1 w - - 0 1");
+	SearchLimits perpetualLimits;
+	perpetualLimits.depth = 6;
+	SearchResult perpetual = cg.search(perpetualLimits, searchTable);
+	cout << "Perpetual check: " << perpetual.bestMove.toString() << " score " << perpetual.score << '\n';
+
+	cout << "========================================\n";
+	cout << "Undo Stack Test\n";
+	cout << "========================================\n";
+
+	// Far more plies than the undo stack holds, through makeMove alone: the oldest are dropped
+	cg.parseFen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+	uint64_t shuffleStartKey = cg.getHashKey();
+	const char* shuffle[] = {"Nf3", "Nf6", "Ng1", "Ng8"};
+	for (int ply = 0; ply < 4000; ply++) {
+		Move move;
+		cg.parseSan(shuffle[ply % 4], move);
+		cg.makeMove(move);
+	}
+	cout << "After 4000 plies: start position " << (cg.getHashKey() == shuffleStartKey ? "yes" : "no")
+	     << ", threefold " << (cg.isThreefoldRepetition() ? "yes" : "no") << '\n';
+	for (int ply = 0; ply < 4; ply++) {
+		cg.unmakeMove();
+	}
+	cout << "Four plies taken back: start position " << (cg.getHashKey() == shuffleStartKey ? "yes" : "no")
+	     << ", " << cg.toFen() << '\n';
+
 	return 0;
 }
@@ -0,0 +1,397 @@
+#include "ChessGame.h"
+#include "ChessPiece.h"
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+using std::cout;
+
+/* Heap allocations made by the program so far; the replaced global operator new below counts them
+   so each benchmark can report allocations per operation */
+static uint64_t allocationCount = 0;
+
+void* operator new(size_t size) {
+	allocationCount++;
+	if (void* block = malloc(size ? size : 1)) {
+		return block;
+	}
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void* block) noexcept {
+	free(block);
+}
+
+void operator delete[](void* block) noexcept {
+	free(block);
+}
+
+void operator delete(void* block, size_t) noexcept {
+	free(block);
+}
+
+void operator delete[](void* block, size_t) noexcept {
+	free(block);
+}
+
+/* Fixed corpus: opening, middlegame and endgame positions, with castling, en passant and promotions
+   available, plus a checkmate and a stalemate so the game-state checks see both outcomes */
+static const char* corpus[] = {
+	"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+	"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+	"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+	"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+	"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+	"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+	"rnb1kbnr/pppp1ppp/8/4p3/6Pq/5P2/PPPPP2P/RNBQKBNR w KQkq - 1 3",
+	"7k/5Q2/6K1/8/8/8/8/8 b - - 0 1",
+};
+static const int CORPUS_SIZE = int(sizeof(corpus) / sizeof(corpus[0]));
+
+/* One benchmark: the timed work of a round returns how many operations it performed; an optional
+   untimed setup runs before every round for operations that change the position */
+struct Benchmark {
+	std::string name;
+	std::function<uint64_t()> round;
+	std::function<void()> prepare;
+};
+
+/* Timing of one benchmark over its repetitions */
+struct Measurement {
+	std::string name;
+	uint64_t operations;          // per repetition
+	std::vector<double> nsPerOp;  // one entry per repetition
+	double allocationsPerOp;
+	double mean, stddev, minimum, maximum;
+};
+
+// Results are folded in here so the compiler cannot drop the work being timed
+static volatile uint64_t sink = 0;
+
+/* Each repetition runs enough rounds to last about this long */
+static const double REPETITION_NS = 20e6;
+
+/* Runs the rounds of one repetition, returning the time spent in the timed part */
+static double runRepetition(const Benchmark& bench, uint64_t rounds, uint64_t& operations, uint64_t& allocations) {
+	using Clock = std::chrono::steady_clock;
+	operations = 0;
+	allocations = 0;
+	if (!bench.prepare) {
+		uint64_t before = allocationCount;
+		auto start = Clock::now();
+		for (uint64_t round = 0; round < rounds; round++) {
+			operations += bench.round();
+		}
+		double elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+		allocations = allocationCount - before;
+		return elapsed;
+	}
+	// With a setup step each round is timed on its own, which adds the clock's overhead to every round
+	double elapsed = 0;
+	for (uint64_t round = 0; round < rounds; round++) {
+		bench.prepare();
+		uint64_t before = allocationCount;
+		auto start = Clock::now();
+		operations += bench.round();
+		elapsed += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+		allocations += allocationCount - before;
+	}
+	return elapsed;
+}
+
+/* Calibrates the round count on a first run, then times the repetitions */
+static Measurement measure(const Benchmark& bench, int repetitions) {
+	uint64_t operations, allocations;
+	uint64_t rounds = 1;
+	double elapsed = runRepetition(bench, rounds, operations, allocations);
+	while (elapsed < REPETITION_NS / 10) {
+		rounds *= 10;
+		elapsed = runRepetition(bench, rounds, operations, allocations);
+	}
+	rounds = std::max<uint64_t>(1, uint64_t(rounds * REPETITION_NS / elapsed));
+
+	Measurement result;
+	result.name = bench.name;
+	uint64_t totalAllocations = 0, totalOperations = 0;
+	for (int repetition = 0; repetition < repetitions; repetition++) {
+		elapsed = runRepetition(bench, rounds, operations, allocations);
+		result.nsPerOp.push_back(elapsed / operations);
+		totalAllocations += allocations;
+		totalOperations += operations;
+	}
+	result.operations = operations;
+	result.allocationsPerOp = double(totalAllocations) / totalOperations;
+
+	double sum = 0, squares = 0;
+	for (double value : result.nsPerOp) {
+		sum += value;
+	}
+	result.mean = sum / repetitions;
+	for (double value : result.nsPerOp) {
+		squares += (value - result.mean) * (value - result.mean);
+	}
+	result.stddev = repetitions > 1 ? std::sqrt(squares / (repetitions - 1)) : 0;
+	result.minimum = *std::min_element(result.nsPerOp.begin(), result.nsPerOp.end());
+	result.maximum = *std::max_element(result.nsPerOp.begin(), result.nsPerOp.end());
+	return result;
+}
+
+/* A stream buffer that discards everything, so submitMove's messages cost no terminal time */
+class NullBuffer : public std::streambuf {
+protected:
+	int overflow(int c) override { return c; }
+	std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+};
+
+/* The benchmarks over the corpus. Move generation is timed per piece type on every square holding
+   that type, the king-safety and game-state checks for the side to move, FEN loading on every corpus
+   position, four ways of copying each position into another game, and submitMove on the first legal move of each position (the game being copied outside
+   the timed part), once with its console report discarded and once with no output sink */
+static std::vector<Benchmark> makeBenchmarks(std::vector<ChessGame>& games, std::vector<ChessGame>& scratch,
+                                             std::vector<std::string>& moveText) {
+	std::vector<Benchmark> benchmarks;
+
+	static const char pieceTypes[] = {'P', 'N', 'B', 'R', 'Q', 'K'};
+	for (char type : pieceTypes) {
+		benchmarks.push_back({std::string("getLegalMoves/") + pieceName(type), [&games, type]() {
+			uint64_t operations = 0, found = 0;
+			MoveList moves;
+			for (const ChessGame& game : games) {
+				const Board& board = game.getBoard();
+				Bitboard squares = board.pieces[pieceIndex(type)] | board.pieces[pieceIndex(char(tolower(type)))];
+				while (squares) {
+					moves.clear();
+					getLegalMoves(board, popLsb(squares), moves);
+					found += moves.size();
+					operations++;
+				}
+			}
+			sink = sink + found;
+			return operations;
+		}, nullptr});
+	}
+
+	benchmarks.push_back({"isKingSafe", [&games]() {
+		uint64_t safe = 0;
+		for (ChessGame& game : games) {
+			safe += game.isKingSafe(true) + game.isKingSafe(false);
+		}
+		sink = sink + safe;
+		return uint64_t(2 * games.size());
+	}, nullptr});
+
+	benchmarks.push_back({"isCheckMate", [&games]() {
+		uint64_t mates = 0;
+		for (ChessGame& game : games) {
+			mates += game.isCheckMate(game.isWhiteToMove());
+		}
+		sink = sink + mates;
+		return uint64_t(games.size());
+	}, nullptr});
+
+	benchmarks.push_back({"isStaleMate", [&games]() {
+		uint64_t stalemates = 0;
+		for (ChessGame& game : games) {
+			stalemates += game.isStaleMate(game.isWhiteToMove());
+		}
+		sink = sink + stalemates;
+		return uint64_t(games.size());
+	}, nullptr});
+
+	benchmarks.push_back({"loadState", [&scratch]() {
+		uint64_t loaded = 0;
+		for (int index = 0; index < CORPUS_SIZE; index++) {
+			loaded += scratch[0].loadState(corpus[index], false).ok();
+		}
+		sink = sink + loaded;
+		return uint64_t(CORPUS_SIZE);
+	}, nullptr});
+
+	// Forking a position into another game: written out as FEN and loaded back, copying the whole
+	// game, packing to 32 bytes and unpacking, and taking and restoring a snapshot
+	benchmarks.push_back({"clone/loadState", [&games, &scratch]() {
+		for (const ChessGame& game : games) {
+			scratch[0].loadState(game.toFen().c_str(), false);
+		}
+		sink = sink + scratch[0].getHashKey();
+		return uint64_t(games.size());
+	}, nullptr});
+
+	benchmarks.push_back({"clone/copy", [&games, &scratch]() {
+		for (const ChessGame& game : games) {
+			scratch[0] = game;
+		}
+		sink = sink + scratch[0].getHashKey();
+		return uint64_t(games.size());
+	}, nullptr});
+
+	benchmarks.push_back({"clone/pack", [&games, &scratch]() {
+		PackedPosition packed;
+		for (const ChessGame& game : games) {
+			game.pack(packed);
+			scratch[0].unpack(packed);
+		}
+		sink = sink + scratch[0].getHashKey();
+		return uint64_t(games.size());
+	}, nullptr});
+
+	benchmarks.push_back({"clone/snapshot", [&games, &scratch]() {
+		PositionSnapshot position;
+		for (const ChessGame& game : games) {
+			game.snapshot(position);
+			scratch[0].restore(position);
+		}
+		sink = sink + scratch[0].getHashKey();
+		return uint64_t(games.size());
+	}, nullptr});
+
+	// With the console report (into the discarding buffer) and with no output sink at all
+	for (bool silent : {false, true}) {
+		benchmarks.push_back({silent ? "submitMove/silent" : "submitMove", [&scratch, &moveText]() {
+			for (size_t index = 0; index < moveText.size(); index += 2) {
+				sink = sink + scratch[index / 2].submitMove(moveText[index].c_str(), moveText[index + 1].c_str()).ok();
+			}
+			return uint64_t(moveText.size() / 2);
+		}, [&games, &scratch, silent]() {
+			// Only positions with a move to play are submitted; they come first in scratch
+			size_t next = 0;
+			for (ChessGame& game : games) {
+				if (game.legalMoveList().size() > 0) {
+					scratch[next] = game;
+					scratch[next++].setOutput(silent ? nullptr : &consoleSink());
+				}
+			}
+		}});
+	}
+	return benchmarks;
+}
+
+/* Converts a square index to submitMove's notation, e.g. "E2" */
+static std::string squareText(int square) {
+	return std::string(1, char('A' + squareCol(square))) + char('1' + squareRow(square));
+}
+
+/* Writes a string as a JSON string literal (the names used here need no escapes beyond these) */
+static std::string jsonString(const std::string& text) {
+	std::string quoted = "\"";
+	for (char c : text) {
+		if (c == '"' || c == '\\') {
+			quoted += '\\';
+		}
+		quoted += c;
+	}
+	return quoted + '"';
+}
+
+/* Machine-readable results, one object per benchmark with every repetition, so runs can be diffed */
+static void printJson(const std::vector<Measurement>& results, int repetitions) {
+	cout << std::fixed << std::setprecision(2);
+	cout << "{\n  \"corpus_positions\": " << CORPUS_SIZE << ",\n  \"repetitions\": " << repetitions
+	     << ",\n  \"benchmarks\": [\n";
+	for (size_t index = 0; index < results.size(); index++) {
+		const Measurement& result = results[index];
+		cout << "    {\"name\": " << jsonString(result.name)
+		     << ", \"operations_per_repetition\": " << result.operations
+		     << ", \"ns_per_op\": {\"mean\": " << result.mean << ", \"stddev\": " << result.stddev
+		     << ", \"min\": " << result.minimum << ", \"max\": " << result.maximum << ", \"samples\": [";
+		for (size_t sample = 0; sample < result.nsPerOp.size(); sample++) {
+			cout << (sample ? ", " : "") << result.nsPerOp[sample];
+		}
+		cout << "]}, \"allocations_per_op\": " << result.allocationsPerOp << '}'
+		     << (index + 1 < results.size() ? "," : "") << '\n';
+	}
+	cout << "  ]\n}\n";
+}
+
+/* Human-readable table */
+static void printTable(const std::vector<Measurement>& results, int repetitions) {
+	cout << "Microbenchmarks: " << CORPUS_SIZE << " positions, " << repetitions << " repetitions\n\n";
+	cout << std::left << std::setw(24) << "Benchmark" << std::right << std::setw(12) << "Ops/rep"
+	     << std::setw(12) << "ns/op" << std::setw(10) << "stddev" << std::setw(8) << "cv %"
+	     << std::setw(10) << "min" << std::setw(10) << "max" << std::setw(12) << "allocs/op" << '\n';
+	cout << std::fixed;
+	for (const Measurement& result : results) {
+		cout << std::left << std::setw(24) << result.name << std::right << std::setw(12) << result.operations
+		     << std::setprecision(1) << std::setw(12) << result.mean << std::setw(10) << result.stddev
+		     << std::setw(8) << (result.mean > 0 ? 100 * result.stddev / result.mean : 0)
+		     << std::setw(10) << result.minimum << std::setw(10) << result.maximum
+		     << std::setprecision(2) << std::setw(12) << result.allocationsPerOp << '\n';
+	}
+}
+
+/* Usage:
+     Microbench [--json] [--repetitions n] [--filter text]
+                        times move generation per piece type, isKingSafe, isCheckMate, isStaleMate,
+                        loadState, cloning and submitMove over a fixed corpus, reporting ns/op (mean, standard
+                        deviation, min, max across repetitions) and heap allocations/op; --json prints
+                        the results as JSON instead of a table, --filter runs only the benchmarks whose
+                        name contains the text (default: 10 repetitions, all benchmarks) */
+int main(int argc, char** argv) {
+	bool json = false;
+	int repetitions = 10;
+	std::string filter;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--json") == 0) {
+			json = true;
+		} else if (strcmp(argv[i], "--repetitions") == 0 && i + 1 < argc) {
+			repetitions = std::max(1, atoi(argv[++i]));
+		} else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+			filter = argv[++i];
+		} else {
+			std::cerr << "Usage: " << argv[0] << " [--json] [--repetitions n] [--filter text]\n";
+			return 1;
+		}
+	}
+
+	std::vector<ChessGame> games(CORPUS_SIZE);
+	std::vector<std::string> moveText;
+	for (int index = 0; index < CORPUS_SIZE; index++) {
+		games[index].loadState(corpus[index], false);
+		const MoveList& moves = games[index].legalMoveList();
+		if (moves.size() > 0) {
+			moveText.push_back(squareText(moves[0].from()));
+			moveText.push_back(squareText(moves[0].to()));
+		}
+	}
+	std::vector<ChessGame> scratch(CORPUS_SIZE);
+
+	// submitMove reports every move on cout; the report goes nowhere while the benchmarks run
+	NullBuffer nullBuffer;
+	std::vector<Measurement> results;
+	for (const Benchmark& bench : makeBenchmarks(games, scratch, moveText)) {
+		if (bench.name.find(filter) == std::string::npos) {
+			continue;
+		}
+		std::streambuf* console = cout.rdbuf(&nullBuffer);
+		Measurement result = measure(bench, repetitions);
+		cout.rdbuf(console);
+		results.push_back(result);
+		if (!json) {
+			std::cerr << '.' << std::flush; // progress
+		}
+	}
+	if (!json) {
+		std::cerr << '\n';
+	}
+
+	if (json) {
+		printJson(results, repetitions);
+	} else {
+		printTable(results, repetitions);
+	}
+	return 0;
+}
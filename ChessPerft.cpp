@@ -0,0 +1,120 @@
+#include "ChessGame.h"
+
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+using std::cout;
+
+/* A reference position with the known number of leaf nodes at a given depth */
+struct PerftCase {
+	const char* name;
+	const char* fen;
+	int depth;
+	unsigned long long nodes;
+};
+
+/* Standard perft reference positions (chessprogramming.org "Perft Results") */
+static const PerftCase referenceCases[] = {
+	{"Initial position", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 1, 20},
+	{"Initial position", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 2, 400},
+	{"Initial position", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 3, 8902},
+	{"Initial position", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 4, 197281},
+	{"Initial position", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 5, 4865609},
+	{"Kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 1, 48},
+	{"Kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 2, 2039},
+	{"Kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 3, 97862},
+	{"Kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 4, 4085603},
+	{"Position 3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 1, 14},
+	{"Position 3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 2, 191},
+	{"Position 3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 3, 2812},
+	{"Position 3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 4, 43238},
+	{"Position 3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 5, 674624},
+	{"Position 4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 1, 6},
+	{"Position 4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 2, 264},
+	{"Position 4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 3, 9467},
+	{"Position 4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 4, 422333},
+	{"Position 5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 1, 44},
+	{"Position 5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 2, 1486},
+	{"Position 5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 3, 62379},
+	{"Position 6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 1, 46},
+	{"Position 6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 2, 2079},
+	{"Position 6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 3, 89890},
+	{"Position 6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 4, 3894594},
+};
+
+static const char* startFen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+/* Prints node count, elapsed time and nodes per second */
+static void printStats(unsigned long long nodes, double seconds) {
+	cout << "Nodes: " << nodes
+	     << "  Time: " << (long long)(seconds * 1000) << " ms"
+	     << "  NPS: " << (unsigned long long)(seconds > 0 ? nodes / seconds : 0) << '\n';
+}
+
+/* Runs perft (or divide) from a single position and reports throughput */
+static int runPerft(const char* fen, int depth, bool divide) {
+	ChessGame cg;
+	if (!cg.loadState(fen).ok()) {
+		return 1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	unsigned long long nodes = divide ? cg.perftDivide(depth) : cg.perft(depth);
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	printStats(nodes, elapsed.count());
+	return 0;
+}
+
+/* Runs every reference position, checking the counts and reporting throughput */
+static int runSuite() {
+	int failures = 0;
+	unsigned long long totalNodes = 0;
+	double totalSeconds = 0;
+
+	for (const PerftCase& test : referenceCases) {
+		ChessGame cg;
+		cg.loadState(test.fen, false);
+
+		auto start = std::chrono::steady_clock::now();
+		unsigned long long nodes = cg.perft(test.depth);
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+		bool passed = nodes == test.nodes;
+		failures += !passed;
+		totalNodes += nodes;
+		totalSeconds += elapsed.count();
+
+		cout << (passed ? "PASS " : "FAIL ") << test.name << " depth " << test.depth
+		     << ": " << nodes << " (expected " << test.nodes << ")  ";
+		printStats(nodes, elapsed.count());
+	}
+
+	cout << "\nTotal  ";
+	printStats(totalNodes, totalSeconds);
+	cout << failures << " of " << sizeof(referenceCases) / sizeof(referenceCases[0]) << " positions failed\n";
+	return failures == 0 ? 0 : 1;
+}
+
+/* Usage:
+     Perft                        run the reference suite
+     Perft <depth> [fen]          count leaf nodes from a position (default: initial position)
+     Perft divide <depth> [fen]   as above, with the count below each root move */
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		return runSuite();
+	}
+
+	bool divide = strcmp(argv[1], "divide") == 0;
+	int depthArg = divide ? 2 : 1;
+	if (argc <= depthArg) {
+		std::cerr << "Usage: " << argv[0] << " [divide] <depth> [fen]\n";
+		return 1;
+	}
+
+	int depth = atoi(argv[depthArg]);
+	const char* fen = argc > depthArg + 1 ? argv[depthArg + 1] : startFen;
+	return runPerft(fen, depth, divide);
+}
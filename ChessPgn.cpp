@@ -0,0 +1,351 @@
+#include "ChessGame.h"
+#include "WorkQueues.h"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using std::cout;
+using std::cerr;
+
+/* The file is read in blocks of this size, and complete games are handed to the workers in chunks */
+static const size_t BLOCK_SIZE = 4 << 20;
+static const size_t GAMES_PER_CHUNK = 256;
+
+static const char* startFen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+/* A numbered run of complete games, copied out of the input as one block of text */
+struct GameChunk {
+	size_t sequence;
+	size_t firstGame;           // number of the chunk's first game in the file, counting from 1
+	std::string text;
+	std::vector<size_t> starts; // offset of each game in text
+};
+
+/* What replaying a game found */
+enum PgnStatus { PGN_OK, PGN_ILLEGAL_MOVE, PGN_AMBIGUOUS_MOVE, PGN_MALFORMED_MOVE, PGN_BAD_FEN, PGN_WRONG_RESULT };
+static const int PGN_STATUS_COUNT = 6;
+static const char* statusNames[PGN_STATUS_COUNT] = {"ok", "illegal", "ambiguous", "malformed", "bad-fen", "wrong-result"};
+
+/* The replayed games of one chunk: counts, plus the report lines already formatted by the worker */
+struct ResultChunk {
+	std::string report;
+	uint64_t plies = 0;
+	uint64_t games = 0;
+	uint64_t statusCounts[PGN_STATUS_COUNT] = {};
+};
+
+/* Splits the input into games as it is read: a tag line ("[...") that follows move text starts a new
+   game. Only the game being read is kept between blocks, so memory stays bounded however large
+   the file is */
+class GameSplitter {
+private:
+	std::string pending;      // unfinished text, starting with the game being read
+	size_t scanned = 0;       // complete lines of pending already looked at
+	bool inMovetext = false;
+	size_t gameCount = 0;
+	size_t sequence = 0;
+	GameChunk chunk;
+
+	/* Copies pending[begin, end) into the chunk as one game, queueing the chunk when it is full */
+	void finishGame(size_t begin, size_t end, ChunkQueue<GameChunk>& work) {
+		if (chunk.starts.empty()) {
+			chunk.firstGame = gameCount + 1;
+		}
+		chunk.starts.push_back(chunk.text.size());
+		chunk.text.append(pending, begin, end - begin);
+		gameCount++;
+		if (chunk.starts.size() == GAMES_PER_CHUNK) {
+			chunk.sequence = sequence++;
+			work.push(std::move(chunk));
+			chunk = GameChunk();
+		}
+	}
+
+public:
+	/* Adds a block of input, finishing every game whose end it reveals */
+	void add(const char* data, size_t size, ChunkQueue<GameChunk>& work) {
+		pending.append(data, size);
+		size_t gameStart = 0;
+		size_t newline;
+		while ((newline = pending.find('\n', scanned)) != std::string::npos) {
+			char first = pending[scanned];
+			if (first == '[') {
+				if (inMovetext) {
+					finishGame(gameStart, scanned, work);
+					gameStart = scanned;
+				}
+				inMovetext = false;
+			} else if (first != '\n' && first != '\r' && first != ' ' && first != '\t') {
+				inMovetext = true;
+			}
+			scanned = newline + 1;
+		}
+		pending.erase(0, gameStart);
+		scanned -= gameStart;
+	}
+
+	/* Finishes the last game at end of input and returns the number of chunks queued */
+	size_t finish(ChunkQueue<GameChunk>& work) {
+		if (pending.find_first_not_of(" \t\r\n") != std::string::npos) {
+			finishGame(0, pending.size(), work);
+		}
+		if (!chunk.starts.empty()) {
+			chunk.sequence = sequence++;
+			work.push(std::move(chunk));
+		}
+		return sequence;
+	}
+};
+
+/* The value of a tag line such as [White "Carlsen, Magnus"], or an empty view if it is not that tag */
+static std::string_view tagValue(std::string_view line, std::string_view name) {
+	if (line.size() < name.size() + 4 || line.compare(1, name.size(), name) != 0 || line[name.size() + 1] != ' ') {
+		return {};
+	}
+	size_t open = line.find('"', name.size() + 1);
+	size_t close = line.rfind('"');
+	if (open == std::string_view::npos || close <= open) {
+		return {};
+	}
+	return line.substr(open + 1, close - open - 1);
+}
+
+/* Replays one game through the legal move generator. Tags come first: FEN (with or without SetUp)
+   sets the starting position and Result is checked against a final checkmate or stalemate. The move
+   text may hold move numbers, comments ({...} and ;...), variations (skipped), NAGs and the
+   termination marker. Flagged games, or every game when reportAll is set, get a report line:
+   game number, White, Black, Result, plies replayed, status and the offending move */
+static PgnStatus replayGame(ChessGame& cg, std::string_view game, size_t number, bool reportAll, ResultChunk& result) {
+	std::string_view white, black, resultTag, fen;
+	size_t position = 0;
+	while (position < game.size()) {
+		size_t end = game.find('\n', position);
+		if (end == std::string_view::npos) {
+			end = game.size();
+		}
+		std::string_view line = game.substr(position, end - position);
+		if (!line.empty() && line.back() == '\r') {
+			line.remove_suffix(1);
+		}
+		if (!line.empty() && line[0] != '[') {
+			break; // move text starts here
+		}
+		if (!line.empty()) {
+			std::string_view value;
+			if (!(value = tagValue(line, "White")).empty()) white = value;
+			else if (!(value = tagValue(line, "Black")).empty()) black = value;
+			else if (!(value = tagValue(line, "Result")).empty()) resultTag = value;
+			else if (!(value = tagValue(line, "FEN")).empty()) fen = value;
+		}
+		position = end + 1;
+	}
+
+	PgnStatus status = PGN_OK;
+	std::string detail;
+	unsigned plies = 0;
+	if (!cg.parseFen(fen.empty() ? std::string_view(startFen) : fen).ok()) {
+		status = PGN_BAD_FEN;
+		detail = std::string(fen);
+	}
+
+	int variationDepth = 0;
+	while (status == PGN_OK && position < game.size()) {
+		char c = game[position];
+		if (c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '.') {
+			position++;
+		} else if (c == '{') {
+			size_t close = game.find('}', position);
+			position = close == std::string_view::npos ? game.size() : close + 1;
+		} else if (c == ';' || (c == '%' && (position == 0 || game[position - 1] == '\n'))) {
+			size_t close = game.find('\n', position);
+			position = close == std::string_view::npos ? game.size() : close + 1;
+		} else if (c == '(' || c == ')') {
+			variationDepth += c == '(' ? 1 : (variationDepth > 0 ? -1 : 0);
+			position++;
+		} else {
+			size_t end = position;
+			while (end < game.size() && !strchr(" \n\r\t{};()", game[end])) {
+				end++;
+			}
+			std::string_view token = game.substr(position, end - position);
+			position = end;
+			if (variationDepth > 0 || token[0] == '$') {
+				continue;
+			}
+			if (token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*") {
+				break;
+			}
+			// A move number, possibly run together with the move ("12.e4", "12...Nf6")
+			size_t digits = 0;
+			while (digits < token.size() && token[digits] >= '0' && token[digits] <= '9') {
+				digits++;
+			}
+			if (digits > 0 && digits < token.size() && token[digits] == '.') {
+				while (digits < token.size() && token[digits] == '.') {
+					digits++;
+				}
+				token.remove_prefix(digits);
+			} else if (digits == token.size()) {
+				continue;
+			}
+			if (token.empty()) {
+				continue;
+			}
+			SanStatus san = cg.playSan(token);
+			if (san != SAN_OK) {
+				status = san == SAN_ILLEGAL ? PGN_ILLEGAL_MOVE : san == SAN_AMBIGUOUS ? PGN_AMBIGUOUS_MOVE : PGN_MALFORMED_MOVE;
+				detail = std::to_string(cg.getFullmoveNumber()) + (cg.isWhiteToMove() ? ". " : "... ") + std::string(token);
+				break;
+			}
+			plies++;
+		}
+	}
+
+	// A game that ends in checkmate or stalemate has only one correct result
+	if (status == PGN_OK && !resultTag.empty() && resultTag != "*") {
+		GameStatus final = cg.computeGameStatus();
+		const char* expected = final == GAME_CHECKMATE ? (cg.isWhiteToMove() ? "0-1" : "1-0")
+			: final == GAME_STALEMATE ? "1/2-1/2" : nullptr;
+		if (expected && resultTag != expected) {
+			status = PGN_WRONG_RESULT;
+			detail = std::string("final position needs ") + expected;
+		}
+	}
+
+	result.plies += plies;
+	if (status != PGN_OK || reportAll) {
+		result.report += std::to_string(number);
+		((result.report += '\t') += white) += '\t';
+		((result.report += black) += '\t') += resultTag;
+		result.report += '\t' + std::to_string(plies) + '\t' + statusNames[status];
+		if (!detail.empty()) {
+			(result.report += '\t') += detail;
+		}
+		result.report += '\n';
+	}
+	return status;
+}
+
+/* Usage:
+     Pgn <games.pgn> [report|-] [threads] [--all]
+   Replays every game, reading the file in blocks and spreading the games over the worker threads.
+   The report lists the flagged games in input order, one per line (every game with --all):
+   "<game>\t<White>\t<Black>\t<Result>\t<plies>\t<status>[\t<detail>]", where the status is ok,
+   illegal, ambiguous, malformed (a move that is not SAN), bad-fen or wrong-result (the Result tag
+   contradicts a final checkmate or stalemate). A summary goes to standard error */
+int main(int argc, char** argv) {
+	bool reportAll = false;
+	std::vector<const char*> arguments;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--all") == 0) {
+			reportAll = true;
+		} else {
+			arguments.push_back(argv[i]);
+		}
+	}
+	if (arguments.empty()) {
+		cerr << "Usage: " << argv[0] << " <games.pgn> [report|-] [threads] [--all]\n";
+		return 1;
+	}
+
+	FILE* input = strcmp(arguments[0], "-") == 0 ? stdin : fopen(arguments[0], "rb");
+	if (!input) {
+		cerr << "Cannot open " << arguments[0] << '\n';
+		return 1;
+	}
+
+	std::ofstream outputFile;
+	if (arguments.size() > 1 && strcmp(arguments[1], "-") != 0) {
+		outputFile.open(arguments[1]);
+		if (!outputFile) {
+			cerr << "Cannot open " << arguments[1] << " for writing\n";
+			return 1;
+		}
+	}
+	std::ostream& output = outputFile.is_open() ? outputFile : cout;
+
+	int hardwareThreads = int(std::thread::hardware_concurrency());
+	int workerCount = arguments.size() > 2 ? atoi(arguments[2]) : (hardwareThreads > 0 ? hardwareThreads : 1);
+	if (workerCount < 1) {
+		workerCount = 1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	ChunkQueue<GameChunk> work(size_t(workerCount) * 4);
+	ResultQueue<ResultChunk> done(size_t(workerCount) * 4);
+
+	// Reader: splits the blocks into games
+	std::thread reader([&] {
+		std::vector<char> block(BLOCK_SIZE);
+		GameSplitter splitter;
+		size_t read;
+		while ((read = fread(block.data(), 1, block.size(), input)) > 0) {
+			splitter.add(block.data(), read, work);
+		}
+		done.setChunkCount(splitter.finish(work));
+		work.close();
+	});
+
+	// Workers: one ChessGame each, reused for every game
+	std::vector<std::thread> workers;
+	for (int i = 0; i < workerCount; i++) {
+		workers.emplace_back([&] {
+			ChessGame cg;
+			GameChunk chunk;
+			while (work.pop(chunk)) {
+				ResultChunk finished;
+				std::string_view text(chunk.text);
+				for (size_t game = 0; game < chunk.starts.size(); game++) {
+					size_t end = game + 1 < chunk.starts.size() ? chunk.starts[game + 1] : text.size();
+					PgnStatus status = replayGame(cg, text.substr(chunk.starts[game], end - chunk.starts[game]),
+					                              chunk.firstGame + game, reportAll, finished);
+					finished.statusCounts[status]++;
+					finished.games++;
+				}
+				done.put(chunk.sequence, std::move(finished));
+			}
+		});
+	}
+
+	// Writer (this thread): emits the reports strictly in input order
+	ResultChunk total, chunk;
+	for (size_t sequence = 0; done.take(sequence, chunk); sequence++) {
+		output << chunk.report;
+		total.games += chunk.games;
+		total.plies += chunk.plies;
+		for (int status = 0; status < PGN_STATUS_COUNT; status++) {
+			total.statusCounts[status] += chunk.statusCounts[status];
+		}
+	}
+	output.flush();
+
+	reader.join();
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+	if (input != stdin) {
+		fclose(input);
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	double movesPerSecond = elapsed.count() > 0 ? total.plies / elapsed.count() : 0;
+	cerr << "Games: " << total.games << "  Moves: " << total.plies
+	     << "  Time: " << (long long)(elapsed.count() * 1000) << " ms"
+	     << "  Moves/s: " << (unsigned long long)movesPerSecond
+	     << "  Per core: " << (unsigned long long)(movesPerSecond / workerCount)
+	     << " (" << workerCount << " workers)\n";
+	cerr << "Flagged:";
+	for (int status = 1; status < PGN_STATUS_COUNT; status++) {
+		cerr << ' ' << statusNames[status] << ' ' << total.statusCounts[status];
+	}
+	cerr << '\n';
+	return 0;
+}
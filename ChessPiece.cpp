@@ -1,87 +1,71 @@
 #include "ChessPiece.h"
 
-// ChessPiece constructor: initializes piece type, row, and column
-ChessPiece::ChessPiece(char type, int row, int col) : type(type), row(row), col(col) {}
-
-// ChessPiece destructor: does nothing here, but can be extended for derived classes
-ChessPiece::~ChessPiece() {}
-
-// Getter function to retrieve the type of the chess piece (e.g., 'P' for Pawn, 'R' for Rook)
-char ChessPiece::getType() const {
-    return type;
+// Getter function to retrieve the name of the piece type
+const char* pieceName(char type) {
+    switch (toupper(type)) {
+        case 'P': return "Pawn";
+        case 'N': return "Knight";
+        case 'B': return "Bishop";
+        case 'R': return "Rook";
+        case 'Q': return "Queen";
+        case 'K': return "King";
+        default: return nullptr;
+    }
 }
 
-// Determines if the piece is on the white side (upper case indicates white)
-bool ChessPiece::isWhiteSide() const {
-    // Upper white, lower black
-    return isupper(type);
+// Function to get all legal moves of the piece on the square, dispatched on its piece code
+void getLegalMoves(const Board& board, int square, MoveList& legalMoves) {
+    switch (toupper(board.squares[square])) {
+        case 'P': getPawnMoves(board, square, legalMoves); break;
+        case 'N': getKnightMoves(board, square, legalMoves); break;
+        case 'B': getBishopMoves(board, square, legalMoves); break;
+        case 'R': getRookMoves(board, square, legalMoves); break;
+        case 'Q': getQueenMoves(board, square, legalMoves); break;
+        case 'K': getKingMoves(board, square, legalMoves); break;
+        default: break; // Empty square
+    }
 }
 
-// Sets the new position for the piece on the board
-void ChessPiece::setPosition(int newRow, int newCol) {
-    row = newRow; 
-    col = newCol;
+// Returns the pieces of the same colour as the piece on the square
+static Bitboard ownPieces(const Board& board, int square) {
+    return board.colours[isWhitePiece(board.squares[square]) ? WHITE : BLACK];
 }
 
-// Rook class constructor: initializes the ChessPiece base class
-Rook::Rook(char type, int row, int col) : ChessPiece(type, row, col) {}
-
-// Getter function to retrieve the name of the piece
-const char* Rook::getName() const {
-  return "Rook";
+// Appends a move from the given square to every square in the target set
+static void addTargets(int from, Bitboard targets, MoveList& legalMoves) {
+    while (targets) {
+        legalMoves.add(Move(from, popLsb(targets)));
+    }
 }
 
-// Function to get all legal moves of the Rook
-vector<pair<int, int>> Rook::getLegalMoves(ChessPiece* board[8][8]) const {
-    vector<pair<int, int>> legalMoves;
-    const int direction[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}}; // Down, Up, Right, Left
-
-    // Loop through each direction and find the valid moves
-    for (int i = 0; i < 4; i++) {
-        int cur_row = row;
-        int cur_col = col;
-
-        while (true) {
-            cur_row += direction[i][0];  // Row increment
-            cur_col += direction[i][1];  // Column increment
-
-            // Break if we go off the board
-            if (cur_row < 0 || cur_row >= 8 || cur_col < 0 || cur_col >= 8) {
-                break;
-            }
+// Function to get all legal moves of a Rook
+void getRookMoves(const Board& board, int square, MoveList& legalMoves) {
+    // Look up the rook rays for the current occupancy; the first blocker on each ray is included
+    addTargets(square, rookAttacks(square, board.occupied) & ~ownPieces(board, square), legalMoves);
+}
 
-            const ChessPiece* targetPiece = board[cur_row][cur_col];
-            if (targetPiece == nullptr) {
-                // If the target square is empty, the move is valid
-                legalMoves.push_back(pair(cur_row, cur_col));
-            } else {
-                // If the target square has a piece, capture it if it's of the opposite color
-                if (targetPiece->isWhiteSide() != this->isWhiteSide()) {
-                    legalMoves.push_back(pair(cur_row, cur_col));
-                }
-                break; // Stop if a piece is encountered, whether friendly or enemy
-            }
+// Appends a pawn move, expanded into the four promotions when it reaches the last rank
+// (queen first, so callers that take the first match promote to a queen)
+static void addPawnMove(int from, int to, int flags, MoveList& legalMoves) {
+    int row = squareRow(to);
+    if (row == 0 || row == 7) {
+        for (int promotion = PROMOTE_QUEEN; promotion >= PROMOTE_KNIGHT; promotion--) {
+            legalMoves.add(Move(from, to, promotion));
         }
+    } else {
+        legalMoves.add(Move(from, to, flags));
     }
-    return legalMoves;
-}
-
-// Pawn class constructor: initializes the ChessPiece base class
-Pawn::Pawn(char type, int row, int col): ChessPiece(type, row, col){}
-
-// Getter function to retrieve the name of the piece
-const char* Pawn::getName() const {
-  return "Pawn";
 }
 
-// Function to get all legal moves of the Pawn
-vector<pair<int, int>> Pawn::getLegalMoves(ChessPiece* board[8][8]) const {
-    
-    vector<pair<int, int>> legalMoves;
+// Function to get all legal moves of a Pawn (en passant needs the game state and is added by ChessGame)
+void getPawnMoves(const Board& board, int square, MoveList& legalMoves) {
+    bool isWhite = isWhitePiece(board.squares[square]);
+    int row = squareRow(square);
+    int col = squareCol(square);
     int direction;
     
     // Determine the direction of movement based on the color of the pawn
-    if (this->isWhiteSide()){
+    if (isWhite){
       direction = 1; // white moves Up
     }else{
       direction = -1; // black moves down
@@ -89,211 +73,47 @@ vector<pair<int, int>> Pawn::getLegalMoves(ChessPiece* board[8][8]) const {
 
     // Move 1 square forward
     int cur_row = row + direction;
-    if (cur_row >= 0 && cur_row < 8 && board[cur_row][col] == nullptr) {
-      legalMoves.push_back(pair(cur_row, col));
-    }
-
-    // Move 2 squares forward (initial pawn move)
-    // white pawn starts from row 2 and black pawn starts from row 7
-    if ((this->isWhiteSide() && row == 1) || (!this->isWhiteSide() && row == 6 )){
-      int cur_row = row + 2 * direction;
-      if (board[cur_row][col] == nullptr && board[row + direction][col] == nullptr) {
-        legalMoves.push_back(pair(cur_row, col));
-      }
-    }
-
-    // Capture diagonally (left and right)
-    if (col - 1 >= 0) {
-      int diag_row = row + direction;
-      if (board[diag_row][col - 1] != nullptr && board[diag_row][col - 1]->isWhiteSide() != this->isWhiteSide()) {
-        legalMoves.push_back(pair(diag_row, col - 1));
-      }
-    }
-
-    if (col + 1 < 8) {
-      int diag_row = row + direction;
-      if (board[diag_row][col + 1] != nullptr && board[diag_row][col + 1]->isWhiteSide() != this->isWhiteSide()) {
-        legalMoves.push_back(pair(diag_row, col + 1));
-      }
-    }
-    
-    return legalMoves;
-}
-
-// Bishop class constructor: initializes the ChessPiece base class
-Bishop::Bishop(char type, int row, int col): ChessPiece(type, row, col){}
-
-// Getter function to retrieve the name of the piece
-const char* Bishop::getName() const {
-  return "Bishop";
-}
-
-// Function to get all legal moves of the Bishop
-vector<pair<int, int>> Bishop::getLegalMoves(ChessPiece* board[8][8]) const {
-    
-    vector<pair<int, int>> legalMoves;
-
-    // Directions for diagonal movement
-    const int direction[4][2] = {{1, 1}, {1, -1}, {-1, 1}, {-1, -1}};                    
-
-    // Loop through each diagonal direction and find valid moves
-    for (int i = 0 ; i < 4; i++){
-      int cur_row = row;
-      int cur_col = col;
-
-      while(true){
-        cur_row += direction[i][0]; // row increment                                                                    
-        cur_col += direction[i][1]; // column increment                                                                  
-        
-        // Break if we go off the board                                                                                       
-        if (cur_row < 0 || cur_row >= 8 || cur_col < 0 || cur_col >=8 ){
-          break;
-        }
-
-        const ChessPiece* targetPiece  = board[cur_row][cur_col];
-        if (targetPiece == nullptr) {
-          // If the target square is empty, the move is valid
-          legalMoves.push_back(pair(cur_row, cur_col));
-        }else{
-          // If the target square has a piece, capture it if it's of the opposite color                                                                                     
-          if (targetPiece->isWhiteSide() != this->isWhiteSide()){
-            legalMoves.push_back(pair(cur_row, cur_col));
-          }
-          break; // Stop if a piece is encountered
+    if (cur_row >= 0 && cur_row < 8 && !(board.occupied & squareBB(makeSquare(cur_row, col)))) {
+      addPawnMove(square, makeSquare(cur_row, col), NORMAL_MOVE, legalMoves);
+
+      // Move 2 squares forward (initial pawn move)
+      // white pawn starts from row 2 and black pawn starts from row 7
+      if ((isWhite && row == 1) || (!isWhite && row == 6 )){
+        int cur_row = row + 2 * direction;
+        if (!(board.occupied & squareBB(makeSquare(cur_row, col)))) {
+          legalMoves.add(Move(square, makeSquare(cur_row, col), DOUBLE_PAWN_PUSH));
         }
       }
     }
-    return legalMoves;
-}
-                                                                                                                                          
-// Queen class constructor: initializes the ChessPiece base class
-Queen::Queen(char type, int row, int col): ChessPiece(type, row, col){} 
-
-// Getter function to retrieve the name of the piece
-const char* Queen::getName() const {
-  return "Queen";
-}
 
-// Function to get all legal moves of the Queen
-vector<pair<int, int>> Queen::getLegalMoves(ChessPiece* board[8][8]) const {
-    vector<pair<int, int>> legalMoves;
-    const int direction[8][2] = {{1, 1}, {1, -1}, {-1, 1}, {-1, -1}, {1, 0}, {0, 1}, {-1, 0}, {0, -1}};
-
-    // Loop through each direction and find valid moves
-    for (int i = 0 ; i < 8; i++){
-        int cur_row = row;
-        int cur_col = col;
-        
-        while(true){
-          cur_row += direction[i][0]; // row increment
-          cur_col += direction[i][1]; // column increment
-            
-          // Break if we go off the board
-          if (cur_row < 0 || cur_row >= 8 || cur_col < 0 || cur_col >=8 ){
-            break;
-          }
-            
-          const ChessPiece* targetPiece  = board[cur_row][cur_col];
-            
-          if (targetPiece == nullptr) {
-            // If the target square is empty, the move is valid
-            legalMoves.push_back(pair(cur_row, cur_col));
-          
-          }else{ 
-            // If the target square has a piece, capture it if it's of the opposite color
-            if (targetPiece->isWhiteSide() != this->isWhiteSide()){
-                legalMoves.push_back(pair(cur_row, cur_col));
-            }
-            break; // Stop if a piece is encountered
-          }
-        }
+    // Capture diagonally (left and right) using the pawn attack table
+    int colour = isWhite ? WHITE : BLACK;
+    Bitboard captures = pawnAttacks[colour][square] & board.colours[colour ^ 1];
+    while (captures) {
+      addPawnMove(square, popLsb(captures), NORMAL_MOVE, legalMoves);
     }
-    return legalMoves;
 }
 
-
-// Knight class constructor: initializes the ChessPiece base class
-Knight::Knight(char type, int row, int col): ChessPiece(type, row, col){}
-
-// Getter function to retrieve the name of the piece
-const char* Knight::getName() const {
-  return "Knight";
+// Function to get all legal moves of a Bishop
+void getBishopMoves(const Board& board, int square, MoveList& legalMoves) {
+    // Look up the diagonal rays for the current occupancy, dropping our own pieces
+    addTargets(square, bishopAttacks(square, board.occupied) & ~ownPieces(board, square), legalMoves);
 }
 
-// Function to get all legal moves of the Knight
-vector<pair<int, int>> Knight::getLegalMoves(ChessPiece* board[8][8]) const {
-    vector<pair<int, int>> legalMoves;
-    
-    // Directions for L-shaped movement
-    const int direction[8][2] = {
-      {2, 1}, {2, -1}, {-2, 1}, {-2, -1}, // Vertical L-shape
-      {1, 2}, {1, -2}, {-1, 2}, {-1, -2} // Horizontal L-shape
-    };
-
-    // Loop through each direction and find valid moves
-    for (int i = 0 ; i < 8; i++){
-      int cur_row = row + direction[i][0];
-      int cur_col = col + direction[i][1];
-
-      // Break if we go off the board
-      if (cur_row < 0 || cur_row >= 8 || cur_col < 0 || cur_col >=8 ){
-        continue;
-      }
-
-      const ChessPiece* targetPiece  = board[cur_row][cur_col];
-      if (targetPiece == nullptr) {
-        // If the target square is empty, the move is valid
-        legalMoves.push_back(pair(cur_row, cur_col));
-      }else if (targetPiece->isWhiteSide() != this->isWhiteSide()){
-        // If the target square has a piece, capture it if it's of the opposite color
-        legalMoves.push_back(pair(cur_row, cur_col));
-      }
-    }
-
-    return legalMoves;
-  }
-  
-
-// King class constructor: initializes the ChessPiece base class
-King::King(char type, int row, int col): ChessPiece(type, row, col){}
-
-// Getter function to retrieve the name of the piece
-const char* King::getName() const {
-  return "King";
+// Function to get all legal moves of a Queen
+void getQueenMoves(const Board& board, int square, MoveList& legalMoves) {
+    // A queen combines the rook and bishop lookups
+    addTargets(square, queenAttacks(square, board.occupied) & ~ownPieces(board, square), legalMoves);
 }
 
-// Function to get all legal moves of the King
-vector<pair<int, int>> King::getLegalMoves(ChessPiece* board[8][8]) const {
-    vector<pair<int, int>> legalMoves;
-
-    // Directions for King's movement (1 square in any direction)
-    const int direction[8][2] = {
-      {1, 0}, {-1, 0}, // Vertical move
-      {0, 1}, {0, -1}, // Horizontal move
-      {1, 1}, {1, -1}, // Diagonal move
-      {-1, 1}, {-1, -1} // Diagonal move
-    }; 
-
-    // Loop through each direction and find valid moves
-    for (int i = 0 ; i < 8; i++){
-      int cur_row = row + direction[i][0];
-      int cur_col = col + direction[i][1];
-
-      // Break if we go off the board
-      if (cur_row < 0 || cur_row >= 8 || cur_col < 0 || cur_col >=8 ){
-        continue;
-      }
-
-      const ChessPiece* targetPiece  = board[cur_row][cur_col];
-      if (targetPiece == nullptr) {
-        // If the target square is empty, the move is valid
-        legalMoves.push_back(pair(cur_row, cur_col));
-      }else if (targetPiece->isWhiteSide() != this->isWhiteSide()){
-      // If the target square has a piece, capture it if it's of the opposite color
-	    legalMoves.push_back(pair(cur_row, cur_col));
-      }
-    }
-    return legalMoves;
+// Function to get all legal moves of a Knight
+void getKnightMoves(const Board& board, int square, MoveList& legalMoves) {
+    // L-shaped jumps come from the precomputed table, minus squares held by our own pieces
+    addTargets(square, knightAttacks[square] & ~ownPieces(board, square), legalMoves);
 }
 
-
+// Function to get all legal moves of a King (castling needs the game state and is added by ChessGame)
+void getKingMoves(const Board& board, int square, MoveList& legalMoves) {
+    // One step in any direction from the precomputed table, minus squares held by our own pieces
+    addTargets(square, kingAttacks[square] & ~ownPieces(board, square), legalMoves);
+}
@@ -1,103 +1,31 @@
 #ifndef CHESSPIECE_H
 #define CHESSPIECE_H
 
-#include <vector>
 #include <cctype>
+#include "Bitboard.h"
+#include "Move.h"
 
 using namespace std;
 
-// Base class for all chess pieces
-class ChessPiece {
-private:
-  char type; // Type of the piece (e.g., 'K' for King, 'Q' for Queen)
-  
-public:
-  // Pure virtual function to get the name of the piece (must be implemented in derived classes)
-  virtual const char* getName() const = 0;
-  // Function to get the type of the piece
-  char getType() const; 
-  // Function to check if the piece is on the white side
-  bool isWhiteSide() const;
-  // Position of the piece on the board (row and column)
-  int row, col;
-  
-  // Constructor to initialize the piece with a type and position
-  ChessPiece(char type, int row, int col);
+// Pieces are stored by value as their FEN character ('P' white pawn, 'n' black knight, ...),
+// with 0 marking an empty square. Move generation dispatches on that code with a switch
+// instead of a virtual call, so the board needs no piece objects at all.
 
-  // Virtual destructor to ensure proper cleanup of derived classes
-  virtual ~ChessPiece(); 
-  
-  // Function to set the position of the piece on the board
-  void setPosition(int newRow, int newCol);
+// Function to check if the piece is on the white side (upper case indicates white)
+inline bool isWhitePiece(char type) { return isupper(type) != 0; }
 
-  // Pure virtual function to get all legal moves of the piece (must be implemented in derived classes)
-  virtual vector<pair<int, int>> getLegalMoves(ChessPiece* board[8][8]) const = 0; // Pure virtual function
-};
+// Function to get the name of the piece type (e.g. "Knight"), or nullptr for an invalid code
+const char* pieceName(char type);
 
-// Derived class for Rook piece
-class Rook : public ChessPiece {
-public:
-  Rook(char type, int row, int col); // Constructor
+// Function to append all moves of the piece standing on the square to the list
+void getLegalMoves(const Board& board, int square, MoveList& legalMoves);
 
-  const char* getName() const override; // Override to return the name of the piece
+// Per-type generators used by getLegalMoves
+void getPawnMoves(const Board& board, int square, MoveList& legalMoves);
+void getKnightMoves(const Board& board, int square, MoveList& legalMoves);
+void getBishopMoves(const Board& board, int square, MoveList& legalMoves);
+void getRookMoves(const Board& board, int square, MoveList& legalMoves);
+void getQueenMoves(const Board& board, int square, MoveList& legalMoves);
+void getKingMoves(const Board& board, int square, MoveList& legalMoves);
 
-  // Function to get all legal moves for the Rook
-  vector<pair<int, int>> getLegalMoves(ChessPiece* board[8][8]) const override;
-};
-
-// Derived class for Pawn piece
-class Pawn: public ChessPiece {
- public:
-  Pawn(char type, int row, int col); // Constructor
-
-  const char* getName() const override; // Override to return the name of the piece
-
-  // Function to get all legal moves for the Pawn
-  vector<pair<int, int>> getLegalMoves(ChessPiece* board[8][8]) const override;
-};
-
-// Derived class for Bishop piece
-class Bishop: public ChessPiece {
-public:
-  Bishop(char type, int row, int col); // Constructor
-
-  const char* getName() const override; // Override to return the name of the piece
-
-  // Function to get all legal moves for the Bishop
-  vector<pair<int, int>> getLegalMoves(ChessPiece* board[8][8]) const override;
-};
-
-// Derived class for Queen piece
-class Queen: public ChessPiece {
-public:
-  Queen(char type, int row, int col); // Constructor
-
-  const char* getName() const override; // Override to return the name of the piece
-
-  // Function to get all legal moves for the Queen
-  vector<pair<int, int>> getLegalMoves(ChessPiece* board[8][8]) const override;
-};
-
-// Derived class for Knight piece
-class Knight: public ChessPiece {
-public:
-  Knight(char type, int row, int col); // Constructor
-
-  const char* getName() const override; // Override to return the name of the piece
-
-  // Function to get all legal moves for the Knight
-  vector<pair<int, int>> getLegalMoves(ChessPiece* board[8][8]) const override;
-};
-
-// Derived class for King piece
-class King: public ChessPiece {
-public:
-  King(char type, int row, int col);  // Constructor
-
-  const char* getName() const override; // Override to return the name of the piece
-
-  // Function to get all legal moves for the King
-  vector<pair<int, int>> getLegalMoves(ChessPiece* board[8][8]) const override;
-};
-
-#endif // CHESSPIECE_H
\ No newline at end of file
+#endif // CHESSPIECE_H
@@ -0,0 +1,126 @@
+#include "ChessGame.h"
+#include "Sessions.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+using std::cout;
+using std::cerr;
+
+/* Requests are handed to the manager in batches of this many */
+static const size_t BATCH_SIZE = 4096;
+
+/* Small deterministic generator for the scripted games */
+static uint64_t nextRandom(uint64_t& state) {
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return state;
+}
+
+/* One scripted game: the squares of each move, as submitMove takes them */
+struct Script {
+	std::vector<SessionRequest> moves;
+};
+
+/* Plays random legal moves from the starting position, recording them as square pairs. Each move is
+   replayed through submitMove, so the script follows the promotion piece submitMove picks */
+static Script makeScript(ChessGame& cg, int plies, uint64_t& random) {
+	Script script;
+	cg.loadState("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", false);
+	for (int ply = 0; ply < plies; ply++) {
+		const MoveList& moves = cg.legalMoveList();
+		if (moves.size() == 0) {
+			break;
+		}
+		Move move = moves[int(nextRandom(random) % moves.size())];
+		SessionRequest request;
+		request.gameId = 0;
+		request.from[0] = char('A' + squareCol(move.from()));
+		request.from[1] = char('1' + squareRow(move.from()));
+		request.from[2] = 0;
+		request.to[0] = char('A' + squareCol(move.to()));
+		request.to[1] = char('1' + squareRow(move.to()));
+		request.to[2] = 0;
+		if (!cg.submitMove(request.from, request.to).ok()) {
+			break;
+		}
+		script.moves.push_back(request);
+	}
+	return script;
+}
+
+/* Usage:
+     Sessions [games] [plies] [shards] [scripts]
+   Synthetic load: hosts the given number of games (default 100000) and plays up to the given number
+   of plies in each (default 40), one ply across every game at a time, following a set of scripted
+   random games (default 256). Reports memory per game and moves per second */
+int main(int argc, char** argv) {
+	size_t gameCount = argc > 1 ? strtoull(argv[1], nullptr, 10) : 100000;
+	int plies = argc > 2 ? atoi(argv[2]) : 40;
+	int shardCount = argc > 3 ? atoi(argv[3]) : 0;
+	size_t scriptCount = argc > 4 ? strtoull(argv[4], nullptr, 10) : 256;
+	if (gameCount < 1 || plies < 1 || scriptCount < 1) {
+		cerr << "Usage: " << argv[0] << " [games] [plies] [shards] [scripts]\n";
+		return 1;
+	}
+
+	ChessGame cg;
+	cg.setOutput(nullptr);
+	uint64_t random = 0x9E3779B97F4A7C15ull;
+	std::vector<Script> scripts;
+	for (size_t i = 0; i < scriptCount; i++) {
+		scripts.push_back(makeScript(cg, plies, random));
+	}
+
+	SessionManager manager(shardCount);
+	auto start = std::chrono::steady_clock::now();
+	std::vector<uint64_t> ids(gameCount);
+	for (size_t i = 0; i < gameCount; i++) {
+		ids[i] = manager.createGame();
+	}
+	manager.wait();
+	std::chrono::duration<double> createTime = std::chrono::steady_clock::now() - start;
+
+	// Each ply sends one move to every game whose script is that long, then waits for the shards
+	std::vector<SessionRequest> batch;
+	batch.reserve(BATCH_SIZE);
+	size_t sent = 0;
+	start = std::chrono::steady_clock::now();
+	for (int ply = 0; ply < plies; ply++) {
+		for (size_t i = 0; i < gameCount; i++) {
+			const Script& script = scripts[i % scriptCount];
+			if (size_t(ply) >= script.moves.size()) {
+				continue;
+			}
+			batch.push_back(script.moves[ply]);
+			batch.back().gameId = ids[i];
+			if (batch.size() == BATCH_SIZE) {
+				sent += manager.submitMoves(batch.data(), batch.size());
+				batch.clear();
+			}
+		}
+		sent += manager.submitMoves(batch.data(), batch.size());
+		batch.clear();
+		manager.wait();
+	}
+	std::chrono::duration<double> moveTime = std::chrono::steady_clock::now() - start;
+
+	SessionStats stats = manager.stats();
+	double perSecond = moveTime.count() > 0 ? stats.movesPlayed / moveTime.count() : 0;
+	cout << "Games: " << stats.games
+	     << "  Shards: " << manager.shardCount()
+	     << "  Bytes per game: " << double(stats.bytes) / stats.games
+	     << " (a ChessGame is " << sizeof(ChessGame) << ")"
+	     << "  Create time: " << (long long)(createTime.count() * 1000) << " ms\n";
+	cout << "Moves: " << stats.movesPlayed << " of " << sent
+	     << "  Rejected: " << stats.movesRejected
+	     << "  Time: " << (long long)(moveTime.count() * 1000) << " ms"
+	     << "  Moves/s: " << (unsigned long long)perSecond
+	     << "  Per shard: " << (unsigned long long)(perSecond / manager.shardCount()) << '\n';
+	return stats.movesRejected == 0 ? 0 : 1;
+}
@@ -0,0 +1,144 @@
+#include "ChessGame.h"
+#include "Tablebase.h"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <sys/stat.h>
+
+using std::cout;
+using std::cerr;
+
+/* Describes a probe result, e.g. "win, mate in 5 (9 plies)" */
+static std::string describe(const TbResult& result) {
+	if (result.outcome == TB_DRAW) {
+		return "draw";
+	}
+	if (result.outcome == TB_LOSS) {
+		return result.pliesToMate == 0 ? "loss, checkmated"
+			: "loss, mated in " + std::to_string(result.pliesToMate / 2) + " (" + std::to_string(result.pliesToMate) + " plies)";
+	}
+	return "win, mate in " + std::to_string((result.pliesToMate + 1) / 2) + " (" + std::to_string(result.pliesToMate) + " plies)";
+}
+
+/* Builds the requested endings ("KRvK", or a piece count for every ending of that size), reporting
+   each table as it is finished */
+static int generate(const char* directory, int threads, int argc, char** argv) {
+	std::vector<std::string> materials;
+	for (int i = 0; i < argc; i++) {
+		int pieces = atoi(argv[i]);
+		if (pieces > 0) {
+			if (pieces < 3 || pieces > TB_MAX_PIECES) {
+				cerr << "Piece counts run from 3 to " << TB_MAX_PIECES << '\n';
+				return 1;
+			}
+			for (const std::string& material : tbMaterialsWithPieces(pieces)) {
+				materials.push_back(material);
+			}
+		} else {
+			materials.push_back(argv[i]);
+		}
+	}
+	mkdir(directory, 0755);
+
+	cout << std::setw(10) << "Ending" << std::setw(14) << "Positions" << std::setw(13) << "Mate (plies)"
+	     << std::setw(11) << "Time (s)" << std::setw(13) << "Memory (MB)" << std::setw(12) << "File (KB)" << '\n';
+	std::vector<TbGenerationStats> stats;
+	size_t reported = 0, peakBytes = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (const std::string& material : materials) {
+		std::string error;
+		if (!generateTablebase(material, directory, threads, stats, error)) {
+			cerr << error << '\n';
+			return 1;
+		}
+		// Sub-endings built on the way are reported too
+		for (; reported < stats.size(); reported++) {
+			const TbGenerationStats& table = stats[reported];
+			peakBytes = std::max(peakBytes, table.workingBytes);
+			cout << std::setw(10) << table.material << std::setw(14) << table.positions
+			     << std::setw(13) << table.longestMate
+			     << std::setw(11) << std::fixed << std::setprecision(2) << table.seconds
+			     << std::setw(13) << std::setprecision(1) << table.workingBytes / (1024.0 * 1024.0)
+			     << std::setw(12) << std::setprecision(1) << table.fileBytes / 1024.0 << '\n';
+		}
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	cout << "\nGenerated " << stats.size() << " tables in " << std::setprecision(2) << seconds << " s ("
+	     << (seconds > 0 ? stats.size() / seconds : 0) << " tables/second) on " << threads
+	     << " threads, peak memory " << std::setprecision(1) << peakBytes / (1024.0 * 1024.0) << " MB\n";
+	return 0;
+}
+
+/* Looks a position up and scores each of its moves from the tables */
+static int probe(const char* directory, const char* fen) {
+	Tablebases tablebases;
+	if (tablebases.open(directory) == 0) {
+		cerr << "No tables in " << directory << '\n';
+		return 1;
+	}
+	ChessGame cg;
+	FenResult parsed = cg.parseFen(fen);
+	if (!parsed.ok()) {
+		cerr << "Invalid FEN: " << fenStatusMessage(parsed.status) << " at character " << parsed.position << '\n';
+		return 1;
+	}
+	TbResult result;
+	if (!tablebases.probe(cg, result)) {
+		cerr << "Position not covered by the tables\n";
+		return 1;
+	}
+	cout << "Position: " << describe(result) << '\n';
+
+	// Best move: the quickest win, else a draw, else the slowest loss
+	Move best = Move();
+	int bestRank = -1000;
+	for (Move move : cg.legalMoveList()) {
+		ChessGame child = cg;
+		child.makeMove(move);
+		TbResult reply;
+		if (!tablebases.probe(child, reply)) {
+			continue;
+		}
+		int rank = reply.outcome == TB_LOSS ? 500 - reply.pliesToMate
+			: reply.outcome == TB_DRAW ? 0 : -500 + reply.pliesToMate;
+		if (rank > bestRank) {
+			bestRank = rank;
+			best = move;
+		}
+	}
+	if (best != Move()) {
+		cout << "Best move: " << best.toString() << '\n';
+	}
+	return 0;
+}
+
+/* Usage:
+     Tb generate <directory> <threads> <ending|pieces>...
+                        builds the tables for each ending ("KQvKR") or every ending with the given number
+                        of pieces (3-5), with the endings they convert into, and reports time and memory
+     Tb probe <directory> "<fen>"
+                        win/draw/loss and distance to mate of a position, with the best move */
+int main(int argc, char** argv) {
+	if (argc >= 5 && strcmp(argv[1], "generate") == 0) {
+		int threads = atoi(argv[3]);
+		if (threads < 1) {
+			int hardwareThreads = int(std::thread::hardware_concurrency());
+			threads = hardwareThreads > 0 ? hardwareThreads : 1;
+		}
+		return generate(argv[2], threads, argc - 4, argv + 4);
+	}
+
+	if (argc >= 4 && strcmp(argv[1], "probe") == 0) {
+		return probe(argv[2], argv[3]);
+	}
+
+	cerr << "Usage: " << argv[0] << " generate <directory> <threads> <ending|pieces>...\n"
+	     << "       " << argv[0] << " probe <directory> \"<fen>\"\n";
+	return 1;
+}
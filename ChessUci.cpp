@@ -0,0 +1,282 @@
+#include "ChessGame.h"
+#include "TranspositionTable.h"
+#include "OpeningBook.h"
+#include "Nnue.h"
+#include "Tablebase.h"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+
+using std::cout;
+
+static const char* startFen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+/* Time kept in reserve when budgeting from the clock, for process and pipe overhead */
+static const int64_t MOVE_OVERHEAD_MS = 30;
+
+/* Lines come from both the command loop and the search thread, so writes are serialised and
+   flushed one at a time (GUIs read the engine through a pipe) */
+static std::mutex outputMutex;
+
+static void send(const std::string& line) {
+	std::lock_guard<std::mutex> lock(outputMutex);
+	cout << line << '\n' << std::flush;
+}
+
+/* UCI score: centipawns, or moves to mate (negative when being mated) */
+static std::string formatScore(int score) {
+	if (score >= MATE_SCORE - MAX_PLY) {
+		return "mate " + std::to_string((MATE_SCORE - score + 1) / 2);
+	}
+	if (score <= -(MATE_SCORE - MAX_PLY)) {
+		return "mate " + std::to_string(-(MATE_SCORE + score) / 2);
+	}
+	return "cp " + std::to_string(score);
+}
+
+/* The engine behind the protocol: commands are read on the main thread while a search runs on a
+   background thread, which reports progress and the best move itself */
+class UciEngine {
+private:
+	ChessGame game;
+	TranspositionTable table;
+	OpeningBook book;
+	Tablebases tablebases;
+	NnueNetwork network; // evaluates once EvalFile is set
+	int threads = 1;
+	std::thread searchThread;
+	std::atomic<bool> stopFlag{false};
+	std::atomic<bool> infinite{false}; // "go infinite": bestmove waits for "stop"
+
+	/* Stops a running search and waits for its bestmove to be sent */
+	void stopSearch() {
+		stopFlag.store(true);
+		if (searchThread.joinable()) {
+			searchThread.join();
+		}
+	}
+
+public:
+	UciEngine() : table(16) {
+		game.parseFen(startFen);
+	}
+
+	~UciEngine() {
+		stopSearch();
+	}
+
+	void uci() {
+		send("id name Cpp-Chess-Engine");
+		send("id author DannyCheng711");
+		send("option name Hash type spin default 16 min 1 max 4096");
+		send("option name Threads type spin default 1 min 1 max 256");
+		send("option name Book type string default <empty>");
+		send("option name TablebasePath type string default <empty>");
+		send("option name EvalFile type string default <empty>");
+		send("uciok");
+	}
+
+	/* setoption name <id> [value <x>] */
+	void setOption(std::istringstream& args) {
+		std::string token, name, value;
+		args >> token; // "name"
+		while (args >> token && token != "value") {
+			name += (name.empty() ? "" : " ") + token;
+		}
+		std::getline(args >> std::ws, value); // paths may contain spaces
+
+		if (name == "Hash") {
+			stopSearch(); // the table cannot be reallocated under a running search
+			table.resize(size_t(std::max(1, atoi(value.c_str()))));
+		} else if (name == "Threads") {
+			threads = std::max(1, atoi(value.c_str()));
+		} else if (name == "Book") {
+			stopSearch();
+			if (value.empty() || value == "<empty>") {
+				book.close();
+			} else {
+				BookStatus status = book.open(value.c_str());
+				if (status != BOOK_OK) {
+					send("info string " + value + ": " + bookStatusMessage(status));
+				}
+			}
+		} else if (name == "TablebasePath") {
+			stopSearch();
+			if (value.empty() || value == "<empty>") {
+				tablebases.close();
+			} else {
+				send("info string " + std::to_string(tablebases.open(value)) + " tablebases found in " + value);
+			}
+		} else if (name == "EvalFile") {
+			stopSearch(); // the search threads read the network
+			if (value.empty() || value == "<empty>") {
+				game.setNetwork(nullptr);
+			} else {
+				NnueStatus status = network.load(value);
+				if (status == NNUE_OK) {
+					game.setNetwork(&network);
+					send(std::string("info string network loaded, ") + nnueSimdName(nnueSimd()) + " kernels");
+				} else {
+					send("info string " + value + ": " + nnueStatusMessage(status));
+				}
+			}
+		} else {
+			send("info string unknown option " + name);
+		}
+	}
+
+	void newGame() {
+		stopSearch();
+		table.clear();
+	}
+
+	/* position [startpos | fen <fields>] [moves <m1> <m2> ...] */
+	void position(std::istringstream& args) {
+		stopSearch();
+
+		std::string token, fen;
+		args >> token;
+		if (token == "startpos") {
+			fen = startFen;
+			args >> token; // "moves", if any
+		} else if (token == "fen") {
+			while (args >> token && token != "moves") {
+				fen += (fen.empty() ? "" : " ") + token;
+			}
+		}
+
+		FenResult result = game.parseFen(fen);
+		if (!result.ok()) {
+			send(std::string("info string invalid position: ") + fenStatusMessage(result.status));
+			return;
+		}
+		while (args >> token) {
+			if (!game.playMove(token)) {
+				send("info string illegal move " + token);
+				return;
+			}
+		}
+	}
+
+	/* go [depth d] [nodes n] [movetime ms] [wtime ms] [btime ms] [winc ms] [binc ms] [movestogo n] [infinite] */
+	void go(std::istringstream& args) {
+		stopSearch();
+
+		SearchLimits limits;
+		int64_t time[2] = {0, 0}, increment[2] = {0, 0};
+		int movesToGo = 0;
+		bool isInfinite = false;
+		std::string token;
+		while (args >> token) {
+			if (token == "depth") args >> limits.depth;
+			else if (token == "nodes") args >> limits.nodes;
+			else if (token == "movetime") args >> limits.moveTimeMs;
+			else if (token == "wtime") args >> time[WHITE];
+			else if (token == "btime") args >> time[BLACK];
+			else if (token == "winc") args >> increment[WHITE];
+			else if (token == "binc") args >> increment[BLACK];
+			else if (token == "movestogo") args >> movesToGo;
+			else if (token == "infinite") isInfinite = true;
+		}
+
+		// A book move is played at once, without searching
+		if (book.isOpen() && !isInfinite) {
+			Move bookMove = book.bestMove(game);
+			if (bookMove != Move()) {
+				send("info string book move");
+				send("bestmove " + bookMove.toString());
+				return;
+			}
+		}
+
+		// Clock budget: an even share of the remaining time plus most of the increment
+		int us = game.isWhiteToMove() ? WHITE : BLACK;
+		if (!limits.moveTimeMs && time[us] > 0) {
+			int64_t available = std::max<int64_t>(1, time[us] - MOVE_OVERHEAD_MS);
+			int64_t budget = available / (movesToGo > 0 ? movesToGo + 1 : 30) + increment[us] * 3 / 4;
+			limits.moveTimeMs = std::max<int64_t>(1, std::min(budget, available));
+		}
+		limits.threads = threads;
+		limits.stopSignal = &stopFlag;
+		limits.tablebases = tablebases.size() ? &tablebases : nullptr;
+		limits.onIteration = [this](const SearchResult& result) {
+			std::string line = "info depth " + std::to_string(result.depth)
+				+ " score " + formatScore(result.score)
+				+ " nodes " + std::to_string(result.nodes)
+				+ " nps " + std::to_string(result.nodesPerSecond)
+				+ " time " + std::to_string(result.timeMs)
+				+ " hashfull " + std::to_string(table.hashfull())
+				+ " pv";
+			for (Move move : result.pv) {
+				line += ' ' + move.toString();
+			}
+			send(line);
+		};
+
+		stopFlag.store(false);
+		infinite.store(isInfinite);
+		ChessGame root = game;
+		searchThread = std::thread([this, root, limits] {
+			SearchResult result = parallelSearch(root, limits, table);
+			// In infinite mode the best move is only announced once the GUI says "stop"
+			while (infinite.load() && !stopFlag.load()) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+			send("bestmove " + (result.bestMove == Move() ? std::string("0000") : result.bestMove.toString()));
+		});
+	}
+
+	void stop() {
+		stopSearch();
+	}
+
+	/* Waits for the current search to finish on its own (end of input) */
+	void finish() {
+		infinite.store(false);
+		if (searchThread.joinable()) {
+			searchThread.join();
+		}
+	}
+};
+
+/* Usage:
+     Uci        speaks the UCI protocol on stdin/stdout (uci, isready, setoption, ucinewgame,
+                position, go, stop, quit) */
+int main() {
+	UciEngine engine;
+	std::string line;
+	while (std::getline(std::cin, line)) {
+		std::istringstream args(line);
+		std::string command;
+		args >> command;
+
+		if (command == "uci") {
+			engine.uci();
+		} else if (command == "isready") {
+			send("readyok");
+		} else if (command == "setoption") {
+			engine.setOption(args);
+		} else if (command == "ucinewgame") {
+			engine.newGame();
+		} else if (command == "position") {
+			engine.position(args);
+		} else if (command == "go") {
+			engine.go(args);
+		} else if (command == "stop") {
+			engine.stop();
+		} else if (command == "quit") {
+			engine.stop();
+			return 0;
+		} else if (!command.empty()) {
+			send("info string unknown command " + command);
+		}
+	}
+	engine.finish();
+	return 0;
+}
@@ -0,0 +1,240 @@
+#include "Dataset.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char DATASET_MAGIC[4] = {'C', 'P', 'D', '1'};
+
+// Records are buffered and written this many at a time
+static const size_t WRITE_BLOCK = 4096;
+
+static_assert(sizeof(PackedPosition) == 32, "dataset records are 32 bytes");
+static_assert(sizeof(DatasetHeader) == 64, "the dataset header is 64 bytes");
+
+const char* datasetStatusMessage(DatasetStatus status) {
+    switch (status) {
+        case DATASET_OK: return "ok";
+        case DATASET_OPEN_FAILED: return "cannot open dataset file";
+        case DATASET_BAD_HEADER: return "not a dataset file";
+        case DATASET_BAD_SIZE: return "dataset file is shorter than its header says";
+        case DATASET_MAP_FAILED: return "cannot map dataset file";
+        case DATASET_WRITE_FAILED: return "cannot write dataset file";
+    }
+    return "unknown status";
+}
+
+/* Checks the magic, record size and reserved bytes of a header */
+static bool checkHeader(const DatasetHeader& header) {
+    static const uint8_t zeros[sizeof(header.reserved)] = {};
+    return memcmp(header.magic, DATASET_MAGIC, sizeof(header.magic)) == 0
+        && header.recordSize == sizeof(PackedPosition)
+        && memcmp(header.reserved, zeros, sizeof(zeros)) == 0
+        && (header.indexOffset == 0 || header.indexCount == header.recordCount);
+}
+
+/* Constructor */
+DatasetWriter::DatasetWriter() : file(nullptr), recordCount(0), buildIndex(false), failed(false) {}
+
+/* Destructor */
+DatasetWriter::~DatasetWriter() {
+    if (file) {
+        fclose(file);
+    }
+}
+
+/* Creates the file with a blank header, which finish() overwrites */
+DatasetStatus DatasetWriter::open(const char* path, bool withIndex) {
+    if (file) {
+        fclose(file);
+    }
+    recordCount = 0;
+    buildIndex = withIndex;
+    failed = false;
+    buffer.clear();
+    index.clear();
+    file = fopen(path, "wb");
+    if (!file) {
+        return DATASET_OPEN_FAILED;
+    }
+    DatasetHeader blank = {};
+    failed = fwrite(&blank, sizeof(blank), 1, file) != 1;
+    return failed ? DATASET_WRITE_FAILED : DATASET_OK;
+}
+
+void DatasetWriter::flushRecords() {
+    if (!buffer.empty() && fwrite(buffer.data(), sizeof(PackedPosition), buffer.size(), file) != buffer.size()) {
+        failed = true;
+    }
+    buffer.clear();
+}
+
+/* Packs the position into the buffer, noting its key for the index */
+bool DatasetWriter::add(const ChessGame& game) {
+    PackedPosition record;
+    if (!file || !game.pack(record)) {
+        return false;
+    }
+    buffer.push_back(record);
+    if (buildIndex) {
+        index.push_back({game.getHashKey(), recordCount});
+    }
+    recordCount++;
+    if (buffer.size() == WRITE_BLOCK) {
+        flushRecords();
+    }
+    return true;
+}
+
+/* Writes the remaining records and the key-sorted index, then goes back for the header */
+DatasetStatus DatasetWriter::finish() {
+    if (!file) {
+        return DATASET_WRITE_FAILED;
+    }
+    flushRecords();
+    DatasetHeader header = {};
+    memcpy(header.magic, DATASET_MAGIC, sizeof(header.magic));
+    header.recordSize = sizeof(PackedPosition);
+    header.recordCount = recordCount;
+    if (buildIndex) {
+        // Stable order within a key keeps the records of one position in file order
+        stable_sort(index.begin(), index.end(),
+                    [](const DatasetIndexEntry& a, const DatasetIndexEntry& b) { return a.key < b.key; });
+        header.indexOffset = sizeof(DatasetHeader) + recordCount * sizeof(PackedPosition);
+        header.indexCount = index.size();
+        if (!index.empty() && fwrite(index.data(), sizeof(DatasetIndexEntry), index.size(), file) != index.size()) {
+            failed = true;
+        }
+    }
+    if (fseek(file, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, file) != 1) {
+        failed = true;
+    }
+    failed = fclose(file) != 0 || failed;
+    file = nullptr;
+    index.clear();
+    index.shrink_to_fit();
+    return failed ? DATASET_WRITE_FAILED : DATASET_OK;
+}
+
+/* Constructor */
+Dataset::Dataset() : mapping(nullptr), mappingSize(0), header(nullptr), records(nullptr), index(nullptr) {}
+
+/* Destructor */
+Dataset::~Dataset() {
+    close();
+}
+
+/* Maps the whole file read-only and checks that the records and index it announces are there */
+DatasetStatus Dataset::open(const char* path, bool sequential) {
+    close();
+    int descriptor = ::open(path, O_RDONLY);
+    if (descriptor < 0) {
+        return DATASET_OPEN_FAILED;
+    }
+    struct stat info;
+    if (fstat(descriptor, &info) != 0 || size_t(info.st_size) < sizeof(DatasetHeader)) {
+        ::close(descriptor);
+        return DATASET_BAD_HEADER;
+    }
+    void* mapped = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_SHARED, descriptor, 0);
+    ::close(descriptor);
+    if (mapped == MAP_FAILED) {
+        return DATASET_MAP_FAILED;
+    }
+    mapping = static_cast<const unsigned char*>(mapped);
+    mappingSize = size_t(info.st_size);
+
+    const DatasetHeader* fileHeader = reinterpret_cast<const DatasetHeader*>(mapping);
+    if (!checkHeader(*fileHeader)) {
+        close();
+        return DATASET_BAD_HEADER;
+    }
+    uint64_t recordsEnd = sizeof(DatasetHeader) + fileHeader->recordCount * sizeof(PackedPosition);
+    if (fileHeader->recordCount > mappingSize / sizeof(PackedPosition) || recordsEnd > mappingSize ||
+        (fileHeader->indexOffset && (fileHeader->indexOffset != recordsEnd ||
+         fileHeader->indexCount > (mappingSize - recordsEnd) / sizeof(DatasetIndexEntry)))) {
+        close();
+        return DATASET_BAD_SIZE;
+    }
+    madvise(mapped, mappingSize, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+    header = fileHeader;
+    records = reinterpret_cast<const PackedPosition*>(mapping + sizeof(DatasetHeader));
+    if (header->indexOffset) {
+        index = reinterpret_cast<const DatasetIndexEntry*>(mapping + header->indexOffset);
+    }
+    return DATASET_OK;
+}
+
+void Dataset::close() {
+    if (mapping) {
+        munmap(const_cast<unsigned char*>(mapping), mappingSize);
+    }
+    mapping = nullptr;
+    mappingSize = 0;
+    header = nullptr;
+    records = nullptr;
+    index = nullptr;
+}
+
+/* Binary-searches the index for the run of entries with the key */
+size_t Dataset::find(uint64_t key, uint64_t* found, size_t capacity) const {
+    if (!index) {
+        return 0;
+    }
+    const DatasetIndexEntry* end = index + header->indexCount;
+    const DatasetIndexEntry* first = lower_bound(index, end, key,
+        [](const DatasetIndexEntry& entry, uint64_t value) { return entry.key < value; });
+    size_t count = 0;
+    for (const DatasetIndexEntry* entry = first; entry != end && entry->key == key; entry++, count++) {
+        if (count < capacity) {
+            found[count] = entry->record;
+        }
+    }
+    return count;
+}
+
+/* Constructor */
+DatasetReader::DatasetReader() : file(nullptr), remaining(0), recordCount(0) {}
+
+/* Destructor */
+DatasetReader::~DatasetReader() {
+    close();
+}
+
+/* Reads and checks the header; the records follow it directly */
+DatasetStatus DatasetReader::open(const char* path) {
+    close();
+    file = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+    if (!file) {
+        return DATASET_OPEN_FAILED;
+    }
+    DatasetHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || !checkHeader(header)) {
+        close();
+        return DATASET_BAD_HEADER;
+    }
+    recordCount = remaining = header.recordCount;
+    return DATASET_OK;
+}
+
+void DatasetReader::close() {
+    if (file && file != stdin) {
+        fclose(file);
+    }
+    file = nullptr;
+    remaining = recordCount = 0;
+}
+
+/* Stops at the end of the records, before any index; a file cut short ends the stream early */
+size_t DatasetReader::read(PackedPosition* chunk, size_t capacity) {
+    if (!file) {
+        return 0;
+    }
+    size_t wanted = size_t(min<uint64_t>(capacity, remaining));
+    size_t count = wanted ? fread(chunk, sizeof(PackedPosition), wanted, file) : 0;
+    remaining = count == wanted ? remaining - count : 0;
+    return count;
+}
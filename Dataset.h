@@ -0,0 +1,129 @@
+#ifndef DATASET_H
+#define DATASET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include "ChessGame.h"
+
+using namespace std;
+
+// Dataset file: a 64-byte header, then recordCount PackedPosition records of 32 bytes, then an
+// optional index. Everything is little-endian, as the records are the in-memory PackedPosition
+struct DatasetHeader {
+  char magic[4];         // "CPD1"
+  uint32_t recordSize;   // sizeof(PackedPosition)
+  uint64_t recordCount;
+  uint64_t indexOffset;  // byte offset of the index, 0 when there is none
+  uint64_t indexCount;   // index entries, one per record
+  uint8_t reserved[32];  // always 0
+};
+
+// Index entry: the Zobrist key of a record's position and the record's number. The entries are
+// sorted by key, so every record holding a position can be found by binary search
+struct DatasetIndexEntry {
+  uint64_t key;
+  uint64_t record;
+};
+
+// Outcome of opening or writing a dataset file
+enum DatasetStatus {
+  DATASET_OK,
+  DATASET_OPEN_FAILED,
+  DATASET_BAD_HEADER,
+  DATASET_BAD_SIZE,
+  DATASET_MAP_FAILED,
+  DATASET_WRITE_FAILED
+};
+
+// Returns a human-readable description of a dataset status
+const char* datasetStatusMessage(DatasetStatus status);
+
+// Writes a dataset file. Records are buffered and written in large blocks; the header, which
+// holds the record count, and the index are written by finish()
+class DatasetWriter {
+private:
+  FILE* file;
+  uint64_t recordCount;
+  bool buildIndex;
+  bool failed;
+  vector<PackedPosition> buffer;
+  vector<DatasetIndexEntry> index;
+
+  // Writes out the buffered records
+  void flushRecords();
+
+public:
+  DatasetWriter();
+  // Closes the file without finishing it if finish() was not called
+  ~DatasetWriter();
+  DatasetWriter(const DatasetWriter&) = delete;
+  DatasetWriter& operator=(const DatasetWriter&) = delete;
+
+  // Creates the file, optionally collecting an index of position keys
+  DatasetStatus open(const char* path, bool withIndex);
+  // Appends the game's position; returns false if it cannot be packed (more than 32 pieces)
+  bool add(const ChessGame& game);
+  uint64_t size() const { return recordCount; }
+  // Writes the index and the header and closes the file
+  DatasetStatus finish();
+};
+
+// Read-only dataset file. The file is memory-mapped, so records are read in place (and pages shared
+// between processes scanning the same file); scans can use the records directly as an array
+class Dataset {
+private:
+  const unsigned char* mapping; // nullptr when closed
+  size_t mappingSize;
+  const DatasetHeader* header;
+  const PackedPosition* records;
+  const DatasetIndexEntry* index;
+
+public:
+  Dataset();
+  ~Dataset();
+  Dataset(const Dataset&) = delete;
+  Dataset& operator=(const Dataset&) = delete;
+
+  // Maps the file, closing any dataset already open. sequential hints the kernel to read ahead
+  // for front-to-back scans; leave it off for lookups through the index
+  DatasetStatus open(const char* path, bool sequential = true);
+  // Unmaps the file
+  void close();
+  bool isOpen() const { return mapping != nullptr; }
+  uint64_t size() const { return header ? header->recordCount : 0; }
+  bool hasIndex() const { return index != nullptr; }
+
+  // The records, size() of them
+  const PackedPosition* data() const { return records; }
+  const PackedPosition& operator[](uint64_t record) const { return records[record]; }
+
+  // Stores the numbers of up to capacity records whose position has the given Zobrist key, in
+  // record order; returns the number of matching records (which may exceed capacity), 0 without an index
+  size_t find(uint64_t key, uint64_t* found, size_t capacity) const;
+};
+
+// Reads a dataset file front to back in chunks with ordinary reads, for pipes and other streams
+// that cannot be mapped, or to keep memory use flat on very large files
+class DatasetReader {
+private:
+  FILE* file;
+  uint64_t remaining;
+  uint64_t recordCount;
+
+public:
+  DatasetReader();
+  ~DatasetReader();
+  DatasetReader(const DatasetReader&) = delete;
+  DatasetReader& operator=(const DatasetReader&) = delete;
+
+  // Opens the file and checks its header; "-" reads standard input
+  DatasetStatus open(const char* path);
+  void close();
+  uint64_t size() const { return recordCount; }
+  // Reads the next records, up to capacity; returns how many were read, 0 at the end
+  size_t read(PackedPosition* chunk, size_t capacity);
+};
+
+#endif // DATASET_H
@@ -0,0 +1,128 @@
+#include "Evaluation.h"
+#include "Bitboard.h"
+
+int pieceSquareMg[12][64];
+int pieceSquareEg[12][64];
+int phaseWeight[12];
+
+// Piece values by PieceIndex (pawn, knight, bishop, rook, queen, king)
+static const int valueMg[6] = {100, 320, 330, 500, 900, 0};
+static const int valueEg[6] = {130, 300, 320, 520, 930, 0};
+static const int phaseOfPiece[6] = {0, 1, 1, 2, 4, 0};
+
+// Piece-square bonuses from white's point of view, written as the board is seen: rank 8 first
+static const int pawnMg[64] = {
+      0,   0,   0,   0,   0,   0,   0,   0,
+     50,  50,  50,  50,  50,  50,  50,  50,
+     10,  10,  20,  30,  30,  20,  10,  10,
+      5,   5,  10,  25,  25,  10,   5,   5,
+      0,   0,   0,  20,  20,   0,   0,   0,
+      5,  -5, -10,   0,   0, -10,  -5,   5,
+      5,  10,  10, -20, -20,  10,  10,   5,
+      0,   0,   0,   0,   0,   0,   0,   0,
+};
+
+// In the endgame passed pawns matter more than central control, so the bonus follows the rank
+static const int pawnEg[64] = {
+      0,   0,   0,   0,   0,   0,   0,   0,
+     80,  80,  80,  80,  80,  80,  80,  80,
+     50,  50,  50,  50,  50,  50,  50,  50,
+     30,  30,  30,  30,  30,  30,  30,  30,
+     15,  15,  15,  15,  15,  15,  15,  15,
+      5,   5,   5,   5,   5,   5,   5,   5,
+      0,   0,   0,   0,   0,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,
+};
+
+static const int knightTable[64] = {
+    -50, -40, -30, -30, -30, -30, -40, -50,
+    -40, -20,   0,   0,   0,   0, -20, -40,
+    -30,   0,  10,  15,  15,  10,   0, -30,
+    -30,   5,  15,  20,  20,  15,   5, -30,
+    -30,   0,  15,  20,  20,  15,   0, -30,
+    -30,   5,  10,  15,  15,  10,   5, -30,
+    -40, -20,   0,   5,   5,   0, -20, -40,
+    -50, -40, -30, -30, -30, -30, -40, -50,
+};
+
+static const int bishopTable[64] = {
+    -20, -10, -10, -10, -10, -10, -10, -20,
+    -10,   0,   0,   0,   0,   0,   0, -10,
+    -10,   0,   5,  10,  10,   5,   0, -10,
+    -10,   5,   5,  10,  10,   5,   5, -10,
+    -10,   0,  10,  10,  10,  10,   0, -10,
+    -10,  10,  10,  10,  10,  10,  10, -10,
+    -10,   5,   0,   0,   0,   0,   5, -10,
+    -20, -10, -10, -10, -10, -10, -10, -20,
+};
+
+static const int rookTable[64] = {
+      0,   0,   0,   0,   0,   0,   0,   0,
+      5,  10,  10,  10,  10,  10,  10,   5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+      0,   0,   0,   5,   5,   0,   0,   0,
+};
+
+static const int queenTable[64] = {
+    -20, -10, -10,  -5,  -5, -10, -10, -20,
+    -10,   0,   0,   0,   0,   0,   0, -10,
+    -10,   0,   5,   5,   5,   5,   0, -10,
+     -5,   0,   5,   5,   5,   5,   0,  -5,
+      0,   0,   5,   5,   5,   5,   0,  -5,
+    -10,   5,   5,   5,   5,   5,   0, -10,
+    -10,   0,   5,   0,   0,   0,   0, -10,
+    -20, -10, -10,  -5,  -5, -10, -10, -20,
+};
+
+// The king hides behind its pawns while queens are on, and heads for the centre in the endgame
+static const int kingMg[64] = {
+    -30, -40, -40, -50, -50, -40, -40, -30,
+    -30, -40, -40, -50, -50, -40, -40, -30,
+    -30, -40, -40, -50, -50, -40, -40, -30,
+    -30, -40, -40, -50, -50, -40, -40, -30,
+    -20, -30, -30, -40, -40, -30, -30, -20,
+    -10, -20, -20, -20, -20, -20, -20, -10,
+     20,  20,   0,   0,   0,   0,  20,  20,
+     20,  30,  10,   0,   0,  10,  30,  20,
+};
+
+static const int kingEg[64] = {
+    -50, -40, -30, -20, -20, -30, -40, -50,
+    -30, -20, -10,   0,   0, -10, -20, -30,
+    -30, -10,  20,  30,  30,  20, -10, -30,
+    -30, -10,  30,  40,  40,  30, -10, -30,
+    -30, -10,  30,  40,  40,  30, -10, -30,
+    -30, -10,  20,  30,  30,  20, -10, -30,
+    -30, -30,   0,   0,   0,   0, -30, -30,
+    -50, -30, -30, -30, -30, -30, -30, -50,
+};
+
+static const int* const tablesMg[6] = {pawnMg, knightTable, bishopTable, rookTable, queenTable, kingMg};
+static const int* const tablesEg[6] = {pawnEg, knightTable, bishopTable, rookTable, queenTable, kingEg};
+
+// Combines values and bonuses into the signed per-colour tables
+static bool buildTables() {
+    for (int type = PAWN; type <= KING; type++) {
+        for (int square = 0; square < 64; square++) {
+            // The tables list rank 8 first, so a white piece reads them flipped; black reads its own view directly
+            int whiteEntry = square ^ 56;
+            int blackEntry = square;
+            pieceSquareMg[type][square] = valueMg[type] + tablesMg[type][whiteEntry];
+            pieceSquareEg[type][square] = valueEg[type] + tablesEg[type][whiteEntry];
+            pieceSquareMg[type + 6][square] = -(valueMg[type] + tablesMg[type][blackEntry]);
+            pieceSquareEg[type + 6][square] = -(valueEg[type] + tablesEg[type][blackEntry]);
+        }
+        phaseWeight[type] = phaseWeight[type + 6] = phaseOfPiece[type];
+    }
+    return true;
+}
+
+// Builds the tables once; the function-local static makes this thread safe
+void initEvaluation() {
+    static const bool initialised = buildTables();
+    (void)initialised;
+}
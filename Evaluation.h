@@ -0,0 +1,28 @@
+#ifndef EVALUATION_H
+#define EVALUATION_H
+
+using namespace std;
+
+// Game phase of the full starting material: knights and bishops count 1, rooks 2, queens 4
+const int MAX_PHASE = 24;
+
+// Material plus piece-square bonus of a piece on a square, for the middlegame and the endgame.
+// Indexed by pieceIndex() and square; white pieces score positive and black pieces negative, so
+// a position's score is the plain sum over its pieces
+extern int pieceSquareMg[12][64];
+extern int pieceSquareEg[12][64];
+// Contribution of each piece to the game phase, indexed by pieceIndex()
+extern int phaseWeight[12];
+
+// Fills the tables; safe to call more than once and from several threads
+void initEvaluation();
+
+// Blends middlegame and endgame scores by the game phase (MAX_PHASE or more is a pure middlegame)
+inline int taperedScore(int mg, int eg, int phase) {
+  if (phase > MAX_PHASE) {
+    phase = MAX_PHASE;
+  }
+  return (mg * phase + eg * (MAX_PHASE - phase)) / MAX_PHASE;
+}
+
+#endif // EVALUATION_H
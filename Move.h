@@ -0,0 +1,76 @@
+#ifndef MOVE_H
+#define MOVE_H
+
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+// Kind of move stored in the flag bits; ordinary moves and captures are NORMAL_MOVE
+enum MoveFlag {
+  NORMAL_MOVE = 0,
+  DOUBLE_PAWN_PUSH = 1,
+  CASTLING = 2,       // stored as the king's move, e.g. e1g1
+  EN_PASSANT = 3,
+  PROMOTE_KNIGHT = 4, // promotions run knight, bishop, rook, queen to match PieceIndex order
+  PROMOTE_BISHOP = 5,
+  PROMOTE_ROOK = 6,
+  PROMOTE_QUEEN = 7
+};
+
+// A move packed into 16 bits: bits 0-5 start square, bits 6-11 end square,
+// bits 12-15 flags (a MoveFlag). The default constructor leaves it uninitialised, so move lists
+// cost nothing to create; Move() (value-initialised, all zero) is the null move
+struct Move {
+  uint16_t data;
+
+  Move() = default;
+  Move(int from, int to, int flags = 0) : data(uint16_t(from | (to << 6) | (flags << 12))) {}
+
+  int from() const { return data & 0x3F; }
+  int to() const { return (data >> 6) & 0x3F; }
+  int flags() const { return data >> 12; }
+  bool isPromotion() const { return flags() >= PROMOTE_KNIGHT; }
+  // PieceIndex of the promoted piece (KNIGHT to QUEEN); only meaningful for promotions
+  int promotionIndex() const { return flags() - PROMOTE_KNIGHT + 1; }
+
+  // Coordinate notation in lower case, e.g. "e2e4", or "e7e8q" for a promotion
+  string toString() const {
+    string text = "a1a1";
+    text[0] = char('a' + (from() & 7));
+    text[1] = char('1' + (from() >> 3));
+    text[2] = char('a' + (to() & 7));
+    text[3] = char('1' + (to() >> 3));
+    if (isPromotion()) {
+      text += "nbrq"[flags() - PROMOTE_KNIGHT];
+    }
+    return text;
+  }
+
+  bool operator==(const Move& other) const { return data == other.data; }
+  bool operator!=(const Move& other) const { return data != other.data; }
+};
+
+// Fixed-capacity move list that lives on the stack; no legal position has more than 218 moves
+struct MoveList {
+  static const int CAPACITY = 256;
+
+  Move moves[CAPACITY];
+  int count;
+
+  MoveList() : count(0) {}
+
+  void add(Move move) { moves[count++] = move; }
+  void clear() { count = 0; }
+  int size() const { return count; }
+
+  Move& operator[](int index) { return moves[index]; }
+  const Move& operator[](int index) const { return moves[index]; }
+
+  Move* begin() { return moves; }
+  Move* end() { return moves + count; }
+  const Move* begin() const { return moves; }
+  const Move* end() const { return moves + count; }
+};
+
+#endif // MOVE_H
@@ -0,0 +1,432 @@
+#include "Nnue.h"
+#include "Bitboard.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define NNUE_X86 1
+#include <immintrin.h>
+#endif
+
+/* The few operations the network spends its time in, one implementation per instruction set.
+   Lengths are multiples of 32 and all arithmetic is exact (inputs are clipped to 0..127, so the
+   8-bit multiply-adds cannot saturate), so every set gives bit-identical results */
+struct NnueKernels {
+    // accumulator += row, accumulator -= row, accumulator += added - removed (NNUE_HALF_DIMENSIONS values)
+    void (*add)(int16_t* accumulator, const int16_t* row);
+    void (*subtract)(int16_t* accumulator, const int16_t* row);
+    void (*addSubtract)(int16_t* accumulator, const int16_t* added, const int16_t* removed);
+    // output = clamp(input, 0, 127)
+    void (*clip)(const int16_t* input, uint8_t* output, int count);
+    // output[o] = biases[o] + sum over i of input[i] * weights[o * inputCount + i]
+    void (*affine)(const uint8_t* input, int inputCount, const int8_t* weights, const int32_t* biases,
+                   int32_t* output, int outputCount);
+};
+
+static void addScalar(int16_t* accumulator, const int16_t* row) {
+    for (int i = 0; i < NNUE_HALF_DIMENSIONS; i++) {
+        accumulator[i] = int16_t(accumulator[i] + row[i]);
+    }
+}
+
+static void subtractScalar(int16_t* accumulator, const int16_t* row) {
+    for (int i = 0; i < NNUE_HALF_DIMENSIONS; i++) {
+        accumulator[i] = int16_t(accumulator[i] - row[i]);
+    }
+}
+
+static void addSubtractScalar(int16_t* accumulator, const int16_t* added, const int16_t* removed) {
+    for (int i = 0; i < NNUE_HALF_DIMENSIONS; i++) {
+        accumulator[i] = int16_t(accumulator[i] + added[i] - removed[i]);
+    }
+}
+
+static void clipScalar(const int16_t* input, uint8_t* output, int count) {
+    for (int i = 0; i < count; i++) {
+        output[i] = uint8_t(min(max(int(input[i]), 0), 127));
+    }
+}
+
+static void affineScalar(const uint8_t* input, int inputCount, const int8_t* weights, const int32_t* biases,
+                         int32_t* output, int outputCount) {
+    for (int o = 0; o < outputCount; o++) {
+        const int8_t* row = weights + size_t(o) * inputCount;
+        int32_t sum = biases[o];
+        for (int i = 0; i < inputCount; i++) {
+            sum += int32_t(input[i]) * row[i];
+        }
+        output[o] = sum;
+    }
+}
+
+#ifdef NNUE_X86
+/* SSE4.1: 8 accumulator values or 16 weights per instruction */
+__attribute__((target("sse4.1")))
+static void addSse41(int16_t* accumulator, const int16_t* row) {
+    for (int i = 0; i < NNUE_HALF_DIMENSIONS; i += 8) {
+        __m128i* target = (__m128i*)(accumulator + i);
+        _mm_store_si128(target, _mm_add_epi16(_mm_load_si128(target), _mm_loadu_si128((const __m128i*)(row + i))));
+    }
+}
+
+__attribute__((target("sse4.1")))
+static void subtractSse41(int16_t* accumulator, const int16_t* row) {
+    for (int i = 0; i < NNUE_HALF_DIMENSIONS; i += 8) {
+        __m128i* target = (__m128i*)(accumulator + i);
+        _mm_store_si128(target, _mm_sub_epi16(_mm_load_si128(target), _mm_loadu_si128((const __m128i*)(row + i))));
+    }
+}
+
+__attribute__((target("sse4.1")))
+static void addSubtractSse41(int16_t* accumulator, const int16_t* added, const int16_t* removed) {
+    for (int i = 0; i < NNUE_HALF_DIMENSIONS; i += 8) {
+        __m128i* target = (__m128i*)(accumulator + i);
+        __m128i delta = _mm_sub_epi16(_mm_loadu_si128((const __m128i*)(added + i)), _mm_loadu_si128((const __m128i*)(removed + i)));
+        _mm_store_si128(target, _mm_add_epi16(_mm_load_si128(target), delta));
+    }
+}
+
+__attribute__((target("sse4.1")))
+static void clipSse41(const int16_t* input, uint8_t* output, int count) {
+    const __m128i zero = _mm_setzero_si128();
+    for (int i = 0; i < count; i += 16) {
+        // Saturating pack to -128..127, then the negatives to zero
+        __m128i packed = _mm_packs_epi16(_mm_loadu_si128((const __m128i*)(input + i)), _mm_loadu_si128((const __m128i*)(input + i + 8)));
+        _mm_storeu_si128((__m128i*)(output + i), _mm_max_epi8(packed, zero));
+    }
+}
+
+__attribute__((target("sse4.1")))
+static void affineSse41(const uint8_t* input, int inputCount, const int8_t* weights, const int32_t* biases,
+                        int32_t* output, int outputCount) {
+    const __m128i ones = _mm_set1_epi16(1);
+    for (int o = 0; o < outputCount; o++) {
+        const int8_t* row = weights + size_t(o) * inputCount;
+        __m128i sum = _mm_setzero_si128();
+        for (int i = 0; i < inputCount; i += 16) {
+            // Unsigned inputs times signed weights, summed in pairs to 16 bits and then in pairs to 32
+            __m128i products = _mm_maddubs_epi16(_mm_loadu_si128((const __m128i*)(input + i)), _mm_loadu_si128((const __m128i*)(row + i)));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(products, ones));
+        }
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+        output[o] = biases[o] + _mm_cvtsi128_si32(sum);
+    }
+}
+
+/* AVX2: twice the width of SSE4.1 */
+__attribute__((target("avx2")))
+static void addAvx2(int16_t* accumulator, const int16_t* row) {
+    for (int i = 0; i < NNUE_HALF_DIMENSIONS; i += 16) {
+        __m256i* target = (__m256i*)(accumulator + i);
+        _mm256_store_si256(target, _mm256_add_epi16(_mm256_load_si256(target), _mm256_loadu_si256((const __m256i*)(row + i))));
+    }
+}
+
+__attribute__((target("avx2")))
+static void subtractAvx2(int16_t* accumulator, const int16_t* row) {
+    for (int i = 0; i < NNUE_HALF_DIMENSIONS; i += 16) {
+        __m256i* target = (__m256i*)(accumulator + i);
+        _mm256_store_si256(target, _mm256_sub_epi16(_mm256_load_si256(target), _mm256_loadu_si256((const __m256i*)(row + i))));
+    }
+}
+
+__attribute__((target("avx2")))
+static void addSubtractAvx2(int16_t* accumulator, const int16_t* added, const int16_t* removed) {
+    for (int i = 0; i < NNUE_HALF_DIMENSIONS; i += 16) {
+        __m256i* target = (__m256i*)(accumulator + i);
+        __m256i delta = _mm256_sub_epi16(_mm256_loadu_si256((const __m256i*)(added + i)), _mm256_loadu_si256((const __m256i*)(removed + i)));
+        _mm256_store_si256(target, _mm256_add_epi16(_mm256_load_si256(target), delta));
+    }
+}
+
+__attribute__((target("avx2")))
+static void clipAvx2(const int16_t* input, uint8_t* output, int count) {
+    const __m256i zero = _mm256_setzero_si256();
+    for (int i = 0; i < count; i += 32) {
+        __m256i packed = _mm256_packs_epi16(_mm256_loadu_si256((const __m256i*)(input + i)), _mm256_loadu_si256((const __m256i*)(input + i + 16)));
+        // The pack works within 128-bit lanes; put the four 64-bit quarters back in order
+        packed = _mm256_permute4x64_epi64(_mm256_max_epi8(packed, zero), 0xD8);
+        _mm256_storeu_si256((__m256i*)(output + i), packed);
+    }
+}
+
+__attribute__((target("avx2")))
+static void affineAvx2(const uint8_t* input, int inputCount, const int8_t* weights, const int32_t* biases,
+                       int32_t* output, int outputCount) {
+    const __m256i ones = _mm256_set1_epi16(1);
+    for (int o = 0; o < outputCount; o++) {
+        const int8_t* row = weights + size_t(o) * inputCount;
+        __m256i sum = _mm256_setzero_si256();
+        for (int i = 0; i < inputCount; i += 32) {
+            __m256i products = _mm256_maddubs_epi16(_mm256_loadu_si256((const __m256i*)(input + i)), _mm256_loadu_si256((const __m256i*)(row + i)));
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(products, ones));
+        }
+        __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+        output[o] = biases[o] + _mm_cvtsi128_si32(half);
+    }
+}
+#endif
+
+// Indexed by NnueSimd; the entries a build cannot run fall back to scalar and are never selected
+static const NnueKernels kernelTable[3] = {
+    {addScalar, subtractScalar, addSubtractScalar, clipScalar, affineScalar},
+#ifdef NNUE_X86
+    {addSse41, subtractSse41, addSubtractSse41, clipSse41, affineSse41},
+    {addAvx2, subtractAvx2, addSubtractAvx2, clipAvx2, affineAvx2},
+#else
+    {addScalar, subtractScalar, addSubtractScalar, clipScalar, affineScalar},
+    {addScalar, subtractScalar, addSubtractScalar, clipScalar, affineScalar},
+#endif
+};
+
+// Scalar until the static initialiser below has looked at the processor
+static NnueSimd activeSimd = NNUE_SCALAR;
+static const NnueKernels* kernels = &kernelTable[NNUE_SCALAR];
+
+const char* nnueSimdName(NnueSimd simd) {
+    switch (simd) {
+    case NNUE_SCALAR: return "scalar";
+    case NNUE_SSE41: return "sse4.1";
+    case NNUE_AVX2: return "avx2";
+    }
+    return "unknown";
+}
+
+bool nnueSimdSupported(NnueSimd simd) {
+    if (simd == NNUE_SCALAR) {
+        return true;
+    }
+#ifdef NNUE_X86
+    __builtin_cpu_init(); // needed when called from a static initialiser
+    return simd == NNUE_AVX2 ? __builtin_cpu_supports("avx2") : __builtin_cpu_supports("sse4.1");
+#else
+    return false;
+#endif
+}
+
+NnueSimd nnueSimd() {
+    return activeSimd;
+}
+
+bool setNnueSimd(NnueSimd simd) {
+    if (!nnueSimdSupported(simd)) {
+        return false;
+    }
+    activeSimd = simd;
+    kernels = &kernelTable[simd];
+    return true;
+}
+
+/* Picks the widest instruction set the processor has */
+static bool selectBestSimd() {
+    return setNnueSimd(NNUE_AVX2) || setNnueSimd(NNUE_SSE41) || setNnueSimd(NNUE_SCALAR);
+}
+
+static const bool simdSelected = selectBestSimd();
+
+const char* nnueStatusMessage(NnueStatus status) {
+    switch (status) {
+    case NNUE_OK: return "ok";
+    case NNUE_OPEN_FAILED: return "cannot open weights file";
+    case NNUE_BAD_HEADER: return "not a weights file for this network shape";
+    case NNUE_BAD_SIZE: return "weights file has the wrong size";
+    }
+    return "unknown status";
+}
+
+static const char NNUE_MAGIC[4] = {'C', 'N', 'N', '1'};
+
+/* Input index of a non-king piece seen from one side: that side's king square and the piece's square,
+   both flipped vertically for black so each side sees itself moving up the board, and the piece kind
+   (own pieces 0-4, the opponent's 5-9) */
+static int featureIndex(int perspective, int kingSquare, int index, int square) {
+    int flip = perspective == WHITE ? 0 : 56;
+    int kind = index % 6 + (index / 6 == perspective ? 0 : 5);
+    return ((kingSquare ^ flip) * 10 + kind) * 64 + (square ^ flip);
+}
+
+NnueNetwork::NnueNetwork() : outputBias(0) {
+    (void)simdSelected;
+}
+
+/* Reads one array, returning false if the file runs short */
+template <typename T>
+static bool readArray(ifstream& file, vector<T>& values, size_t count) {
+    values.resize(count);
+    return bool(file.read((char*)values.data(), streamsize(count * sizeof(T))));
+}
+
+/* Reads the header and arrays into a scratch network so a bad file leaves this one untouched */
+NnueStatus NnueNetwork::load(const string& path) {
+    ifstream file(path, ios::binary);
+    if (!file) {
+        return NNUE_OPEN_FAILED;
+    }
+    char magic[4];
+    uint32_t shape[4];
+    if (!file.read(magic, 4) || !file.read((char*)shape, sizeof(shape)) || memcmp(magic, NNUE_MAGIC, 4) != 0
+        || shape[0] != uint32_t(NNUE_INPUTS) || shape[1] != uint32_t(NNUE_HALF_DIMENSIONS)
+        || shape[2] != uint32_t(NNUE_HIDDEN1) || shape[3] != uint32_t(NNUE_HIDDEN2)) {
+        return NNUE_BAD_HEADER;
+    }
+
+    NnueNetwork loaded;
+    vector<int32_t> bias;
+    bool complete = readArray(file, loaded.featureWeights, size_t(NNUE_INPUTS) * NNUE_HALF_DIMENSIONS)
+        && readArray(file, loaded.featureBiases, NNUE_HALF_DIMENSIONS)
+        && readArray(file, loaded.hidden1Weights, size_t(NNUE_HIDDEN1) * 2 * NNUE_HALF_DIMENSIONS)
+        && readArray(file, loaded.hidden1Biases, NNUE_HIDDEN1)
+        && readArray(file, loaded.hidden2Weights, size_t(NNUE_HIDDEN2) * NNUE_HIDDEN1)
+        && readArray(file, loaded.hidden2Biases, NNUE_HIDDEN2)
+        && readArray(file, loaded.outputWeights, NNUE_HIDDEN2)
+        && readArray(file, bias, 1);
+    if (!complete || file.peek() != ifstream::traits_type::eof()) {
+        return NNUE_BAD_SIZE;
+    }
+    loaded.outputBias = bias[0];
+    *this = move(loaded);
+    return NNUE_OK;
+}
+
+/* Writes one array */
+template <typename T>
+static void writeArray(ofstream& file, const vector<T>& values) {
+    file.write((const char*)values.data(), streamsize(values.size() * sizeof(T)));
+}
+
+bool NnueNetwork::save(const string& path) const {
+    ofstream file(path, ios::binary | ios::trunc);
+    if (!file || !isLoaded()) {
+        return false;
+    }
+    uint32_t shape[4] = {uint32_t(NNUE_INPUTS), uint32_t(NNUE_HALF_DIMENSIONS), uint32_t(NNUE_HIDDEN1), uint32_t(NNUE_HIDDEN2)};
+    file.write(NNUE_MAGIC, 4);
+    file.write((const char*)shape, sizeof(shape));
+    writeArray(file, featureWeights);
+    writeArray(file, featureBiases);
+    writeArray(file, hidden1Weights);
+    writeArray(file, hidden1Biases);
+    writeArray(file, hidden2Weights);
+    writeArray(file, hidden2Biases);
+    writeArray(file, outputWeights);
+    file.write((const char*)&outputBias, sizeof(outputBias));
+    return bool(file);
+}
+
+/* Weights are drawn uniformly from ranges that keep most activations inside the clipping window */
+void NnueNetwork::randomize(uint64_t seed) {
+    uint64_t state = seed ? seed : 1;
+    auto next = [&state](int low, int high) {
+        // xorshift64*
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return low + int(((state * 0x2545F4914F6CDD1DULL) >> 33) % uint64_t(high - low + 1));
+    };
+
+    featureWeights.resize(size_t(NNUE_INPUTS) * NNUE_HALF_DIMENSIONS);
+    for (int16_t& weight : featureWeights) weight = int16_t(next(-16, 16));
+    featureBiases.resize(NNUE_HALF_DIMENSIONS);
+    for (int16_t& bias : featureBiases) bias = int16_t(next(0, 64));
+    hidden1Weights.resize(size_t(NNUE_HIDDEN1) * 2 * NNUE_HALF_DIMENSIONS);
+    for (int8_t& weight : hidden1Weights) weight = int8_t(next(-8, 8));
+    hidden1Biases.resize(NNUE_HIDDEN1);
+    for (int32_t& bias : hidden1Biases) bias = next(-512, 512);
+    hidden2Weights.resize(size_t(NNUE_HIDDEN2) * NNUE_HIDDEN1);
+    for (int8_t& weight : hidden2Weights) weight = int8_t(next(-32, 32));
+    hidden2Biases.resize(NNUE_HIDDEN2);
+    for (int32_t& bias : hidden2Biases) bias = next(-512, 512);
+    outputWeights.resize(NNUE_HIDDEN2);
+    for (int8_t& weight : outputWeights) weight = int8_t(next(-32, 32));
+    outputBias = 0;
+}
+
+/* Starts from the biases and adds the row of every non-king piece */
+void NnueNetwork::refresh(const Board& board, int perspective, NnueAccumulator& accumulator) const {
+    int16_t* values = accumulator.values[perspective];
+    memcpy(values, featureBiases.data(), sizeof(accumulator.values[perspective]));
+    Bitboard king = board.pieces[KING + 6 * perspective];
+    if (!king) {
+        return;
+    }
+    int kingSquare = lsb(king);
+    Bitboard pieces = board.occupied & ~board.pieces[KING] & ~board.pieces[KING + 6];
+    while (pieces) {
+        int square = popLsb(pieces);
+        kernels->add(values, featureRow(featureIndex(perspective, kingSquare, pieceIndex(board.squares[square]), square)));
+    }
+}
+
+void NnueNetwork::addPiece(const Board& board, int index, int square, NnueAccumulator& accumulator) const {
+    if (index % 6 == KING) {
+        refresh(board, index / 6, accumulator);
+        return;
+    }
+    for (int perspective = WHITE; perspective <= BLACK; perspective++) {
+        Bitboard king = board.pieces[KING + 6 * perspective];
+        if (king) {
+            kernels->add(accumulator.values[perspective], featureRow(featureIndex(perspective, lsb(king), index, square)));
+        }
+    }
+}
+
+void NnueNetwork::removePiece(const Board& board, int index, int square, NnueAccumulator& accumulator) const {
+    if (index % 6 == KING) {
+        return; // that side's half waits for its king to come back
+    }
+    for (int perspective = WHITE; perspective <= BLACK; perspective++) {
+        Bitboard king = board.pieces[KING + 6 * perspective];
+        if (king) {
+            kernels->subtract(accumulator.values[perspective], featureRow(featureIndex(perspective, lsb(king), index, square)));
+        }
+    }
+}
+
+/* A king move changes every input of its own side, so that half is rebuilt; any other move is one
+   row in and one row out per side */
+void NnueNetwork::movePiece(const Board& board, int index, int from, int to, NnueAccumulator& accumulator) const {
+    if (index % 6 == KING) {
+        refresh(board, index / 6, accumulator);
+        return;
+    }
+    for (int perspective = WHITE; perspective <= BLACK; perspective++) {
+        Bitboard king = board.pieces[KING + 6 * perspective];
+        if (king) {
+            int kingSquare = lsb(king);
+            kernels->addSubtract(accumulator.values[perspective], featureRow(featureIndex(perspective, kingSquare, index, to)),
+                                 featureRow(featureIndex(perspective, kingSquare, index, from)));
+        }
+    }
+}
+
+/* Clips a dense layer's outputs back to 0..127 for the next layer */
+static void clipDense(const int32_t* input, uint8_t* output, int count) {
+    for (int i = 0; i < count; i++) {
+        output[i] = uint8_t(min(max(input[i] >> NNUE_WEIGHT_SCALE_BITS, 0), 127));
+    }
+}
+
+int NnueNetwork::evaluate(const NnueAccumulator& accumulator, int sideToMove) const {
+    alignas(32) uint8_t input[2 * NNUE_HALF_DIMENSIONS];
+    kernels->clip(accumulator.values[sideToMove], input, NNUE_HALF_DIMENSIONS);
+    kernels->clip(accumulator.values[sideToMove ^ 1], input + NNUE_HALF_DIMENSIONS, NNUE_HALF_DIMENSIONS);
+
+    int32_t hidden1[NNUE_HIDDEN1];
+    alignas(32) uint8_t hidden1Clipped[NNUE_HIDDEN1];
+    kernels->affine(input, 2 * NNUE_HALF_DIMENSIONS, hidden1Weights.data(), hidden1Biases.data(), hidden1, NNUE_HIDDEN1);
+    clipDense(hidden1, hidden1Clipped, NNUE_HIDDEN1);
+
+    int32_t hidden2[NNUE_HIDDEN2];
+    alignas(32) uint8_t hidden2Clipped[NNUE_HIDDEN2];
+    kernels->affine(hidden1Clipped, NNUE_HIDDEN1, hidden2Weights.data(), hidden2Biases.data(), hidden2, NNUE_HIDDEN2);
+    clipDense(hidden2, hidden2Clipped, NNUE_HIDDEN2);
+
+    int32_t output;
+    kernels->affine(hidden2Clipped, NNUE_HIDDEN2, outputWeights.data(), &outputBias, &output, 1);
+    return min(max(output / NNUE_OUTPUT_SCALE, -NNUE_SCORE_LIMIT), NNUE_SCORE_LIMIT);
+}
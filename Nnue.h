@@ -0,0 +1,91 @@
+#ifndef NNUE_H
+#define NNUE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+struct Board;
+
+// HalfKP network shape: for each side, one input per (own king square, non-king piece of either
+// colour, square); the feature transformer sums the active inputs into NNUE_HALF_DIMENSIONS values
+// per side, and three dense layers turn the two halves (side to move first) into a score
+const int NNUE_INPUTS = 64 * 10 * 64;
+const int NNUE_HALF_DIMENSIONS = 256;
+const int NNUE_HIDDEN1 = 32;
+const int NNUE_HIDDEN2 = 32;
+// Dense layer outputs are shifted right by this many bits before clipping to 0..127
+const int NNUE_WEIGHT_SCALE_BITS = 6;
+// The output neuron divided by this gives centipawns
+const int NNUE_OUTPUT_SCALE = 16;
+// Evaluations are clamped to +-this, well clear of mate scores
+const int NNUE_SCORE_LIMIT = 10000;
+
+// Feature transformer output of both sides (indexed by WHITE/BLACK), kept by the Board and
+// updated piece by piece; a side's half is only meaningful while its king is on the board
+struct NnueAccumulator {
+  alignas(32) int16_t values[2][NNUE_HALF_DIMENSIONS];
+};
+
+// Instruction sets the kernels come in; the best one the processor supports is picked at startup
+enum NnueSimd { NNUE_SCALAR, NNUE_SSE41, NNUE_AVX2 };
+
+// Returns the name of an instruction set ("scalar", "sse4.1", "avx2")
+const char* nnueSimdName(NnueSimd simd);
+// Returns true if this processor (and build) can run the kernels of the given instruction set
+bool nnueSimdSupported(NnueSimd simd);
+// The instruction set the kernels currently use
+NnueSimd nnueSimd();
+// Switches every network to the kernels of the given instruction set; returns false, changing
+// nothing, if it is not supported. Not to be called while a search is running
+bool setNnueSimd(NnueSimd simd);
+
+// Outcome of loading a weights file
+enum NnueStatus { NNUE_OK, NNUE_OPEN_FAILED, NNUE_BAD_HEADER, NNUE_BAD_SIZE };
+
+// Returns a human-readable description of a load status
+const char* nnueStatusMessage(NnueStatus status);
+
+// Quantised network weights. The file is "CNN1", the four layer sizes as 32-bit integers and then
+// each array below in order, little-endian: int16 feature weights and biases, then int8 weights and
+// int32 biases for each dense layer
+class NnueNetwork {
+private:
+  vector<int16_t> featureWeights; // NNUE_INPUTS rows of NNUE_HALF_DIMENSIONS
+  vector<int16_t> featureBiases;
+  vector<int8_t> hidden1Weights;  // NNUE_HIDDEN1 rows of 2 * NNUE_HALF_DIMENSIONS
+  vector<int32_t> hidden1Biases;
+  vector<int8_t> hidden2Weights;  // NNUE_HIDDEN2 rows of NNUE_HIDDEN1
+  vector<int32_t> hidden2Biases;
+  vector<int8_t> outputWeights;   // NNUE_HIDDEN2
+  int32_t outputBias;
+
+  /* Weight row of one feature */
+  const int16_t* featureRow(int feature) const { return &featureWeights[size_t(feature) * NNUE_HALF_DIMENSIONS]; }
+
+public:
+  NnueNetwork();
+
+  // Reads a weights file, leaving the network unchanged on failure
+  NnueStatus load(const string& path);
+  // Writes the weights in the format load reads; returns false if the file cannot be written
+  bool save(const string& path) const;
+  // Fills the network with small pseudo-random weights from a seed, for tests and benchmarks
+  void randomize(uint64_t seed);
+  bool isLoaded() const { return !featureWeights.empty(); }
+
+  // Recomputes one side's half of the accumulator from every piece on the board
+  void refresh(const Board& board, int perspective, NnueAccumulator& accumulator) const;
+  // Incremental updates for a piece (pieceIndex() 0-11) appearing, disappearing or moving. A king
+  // is not a feature: its own side's half is refreshed instead, so call these after the board changes
+  void addPiece(const Board& board, int index, int square, NnueAccumulator& accumulator) const;
+  void removePiece(const Board& board, int index, int square, NnueAccumulator& accumulator) const;
+  void movePiece(const Board& board, int index, int from, int to, NnueAccumulator& accumulator) const;
+
+  // Runs the dense layers on the accumulator; centipawns from the given side's point of view
+  int evaluate(const NnueAccumulator& accumulator, int sideToMove) const;
+};
+
+#endif // NNUE_H
@@ -0,0 +1,59 @@
+#ifndef OPENINGBOOK_H
+#define OPENINGBOOK_H
+
+#include <cstddef>
+#include <cstdint>
+#include "Move.h"
+
+using namespace std;
+
+class ChessGame;
+
+// Polyglot random keys: 768 piece-square keys (64 per piece kind, black pawn first), 4 castling
+// rights, 8 en passant files and one for white to move
+const int POLYGLOT_KEY_COUNT = 781;
+
+// Polyglot key of the position, the key Polyglot .bin books are sorted by
+uint64_t polyglotKey(const ChessGame& game);
+
+// Outcome of opening a book file
+enum BookStatus { BOOK_OK, BOOK_OPEN_FAILED, BOOK_BAD_SIZE, BOOK_MAP_FAILED };
+
+// Returns a human-readable description of a book status
+const char* bookStatusMessage(BookStatus status);
+
+// A book move decoded to the engine's move format, with its Polyglot weight
+struct BookMove {
+  Move move;
+  uint16_t weight;
+};
+
+// Read-only Polyglot .bin book. The file is memory-mapped rather than read, so processes using the
+// same book share its pages in the page cache, and lookups binary-search the key-sorted 16-byte
+// entries in place.
+class OpeningBook {
+private:
+  const unsigned char* entries; // mapped file, nullptr when closed
+  size_t entryCount;
+
+public:
+  OpeningBook();
+  ~OpeningBook();
+  OpeningBook(const OpeningBook&) = delete;
+  OpeningBook& operator=(const OpeningBook&) = delete;
+
+  // Maps the book file, closing any book already open
+  BookStatus open(const char* path);
+  // Unmaps the book
+  void close();
+  bool isOpen() const { return entries != nullptr; }
+  size_t size() const { return entryCount; }
+
+  // Stores up to capacity legal book moves for the position, in file order (heaviest first for
+  // books written by Polyglot); returns the number stored
+  int probe(const ChessGame& game, BookMove* moves, int capacity) const;
+  // Returns the heaviest legal book move for the position, or Move() if there is none
+  Move bestMove(const ChessGame& game) const;
+};
+
+#endif // OPENINGBOOK_H
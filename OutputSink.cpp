@@ -0,0 +1,44 @@
+#include "OutputSink.h"
+
+#include <iostream>
+
+void ConsoleSink::message(string_view line) {
+    (cout << line).put('\n');
+}
+
+void ConsoleSink::error(string_view line) {
+    (cerr << line).put('\n');
+}
+
+ConsoleSink& consoleSink() {
+    static ConsoleSink sink;
+    return sink;
+}
+
+BufferedSink::BufferedSink(ostream& stream, size_t capacity) : stream(stream), capacity(capacity) {
+    buffer.reserve(capacity);
+}
+
+BufferedSink::~BufferedSink() {
+    flush();
+}
+
+void BufferedSink::message(string_view line) {
+    buffer.append(line);
+    buffer += '\n';
+    if (buffer.size() >= capacity) {
+        stream.write(buffer.data(), streamsize(buffer.size()));
+        buffer.clear();
+    }
+}
+
+/* Errors share the buffer so they stay in order with the messages around them */
+void BufferedSink::error(string_view line) {
+    message(line);
+}
+
+void BufferedSink::flush() {
+    stream.write(buffer.data(), streamsize(buffer.size()));
+    buffer.clear();
+    stream.flush();
+}
@@ -0,0 +1,53 @@
+#ifndef OUTPUTSINK_H
+#define OUTPUTSINK_H
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+// Destination of the lines ChessGame prints for people (move reports, load messages). Lines arrive
+// without their newline, and nothing is flushed on the caller's behalf
+class OutputSink {
+public:
+  virtual ~OutputSink() = default;
+  // A line of ordinary output
+  virtual void message(string_view line) = 0;
+  // A line about bad input
+  virtual void error(string_view line) = 0;
+};
+
+// Messages to cout and errors to cerr, one line at a time, left to the streams' own buffering; the
+// sink every game starts with
+class ConsoleSink : public OutputSink {
+public:
+  void message(string_view line) override;
+  void error(string_view line) override;
+};
+
+// The process-wide console sink
+ConsoleSink& consoleSink();
+
+// Collects messages and errors, in order, in one buffer that is written to a stream in a single call
+// whenever it grows past its capacity, on flush() and when the sink is destroyed
+class BufferedSink : public OutputSink {
+private:
+  ostream& stream;
+  string buffer;
+  size_t capacity;
+
+public:
+  explicit BufferedSink(ostream& stream, size_t capacity = 64 * 1024);
+  ~BufferedSink();
+  BufferedSink(const BufferedSink&) = delete;
+  BufferedSink& operator=(const BufferedSink&) = delete;
+
+  void message(string_view line) override;
+  void error(string_view line) override;
+  // Writes out and empties the buffer, then flushes the stream
+  void flush();
+};
+
+#endif // OUTPUTSINK_H
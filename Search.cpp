@@ -0,0 +1,427 @@
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include "Search.h"
+#include "ChessGame.h"
+#include "TranspositionTable.h"
+#include "Tablebase.h"
+
+// Larger than any reachable score, used as the initial search window
+static const int INFINITE_SCORE = MATE_SCORE + 1;
+// Scores beyond this bound encode a forced mate
+static const int MATE_BOUND = MATE_SCORE - MAX_PLY;
+
+// Material values indexed by PieceIndex (pawn, knight, bishop, rook, queen, king)
+static const int pieceValues[6] = {100, 320, 330, 500, 900, 0};
+
+// Depth-skipping pattern for helper threads: helper i skips the depths where
+// ((depth + skipPhase[i]) / skipSize[i]) is odd, so helpers are spread over different iterations
+static const int SKIP_PATTERNS = 20;
+static const int skipSize[SKIP_PATTERNS] = {1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4};
+static const int skipPhase[SKIP_PATTERNS] = {0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7};
+
+// Mate scores are stored relative to the node rather than the root so they stay valid
+// when the same position is reached at a different ply
+static int scoreToTable(int score, int ply) {
+    return score >= MATE_BOUND ? score + ply : score <= -MATE_BOUND ? score - ply : score;
+}
+
+static int scoreFromTable(int score, int ply) {
+    return score >= MATE_BOUND ? score - ply : score <= -MATE_BOUND ? score + ply : score;
+}
+
+// Tablebase results as scores at the given ply; mates too long for the mate range become plain wins
+static int tablebaseScore(const TbResult& result, int ply) {
+    if (result.outcome == TB_DRAW) {
+        return 0;
+    }
+    int score = max(MATE_SCORE - ply - result.pliesToMate, MATE_BOUND - 1);
+    return result.outcome == TB_WIN ? score : -score;
+}
+
+/* Constructor */
+Searcher::Searcher(ChessGame& game, TranspositionTable& table, atomic<bool>& stopFlag, int threadIndex)
+    : game(game), table(table), stopFlag(stopFlag), threadIndex(threadIndex), nodes(0) {
+}
+
+/* Checks the node and time budget, raising the stop flag when it is spent */
+bool Searcher::shouldStop() {
+    if (stopFlag.load(memory_order_relaxed)) {
+        return true;
+    }
+    // The caller's signal is only read: raising it is the caller's business
+    if (limits.stopSignal && limits.stopSignal->load(memory_order_relaxed)) {
+        stopFlag.store(true, memory_order_relaxed);
+        return true;
+    }
+    if (limits.nodes && nodes >= limits.nodes) {
+        stopFlag.store(true, memory_order_relaxed);
+        return true;
+    }
+    // Reading the clock is comparatively slow, so only do it every 1024 nodes
+    if (limits.moveTimeMs && (nodes & 1023) == 0) {
+        auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - startTime);
+        if (elapsed.count() >= limits.moveTimeMs) {
+            stopFlag.store(true, memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Static evaluation from the side to move's point of view, kept up to date by every move */
+int Searcher::evaluate() const {
+    return game.evaluate();
+}
+
+/* Generates the legal moves of the side to move */
+void Searcher::generateMoves(MoveList& moves, bool capturesOnly) const {
+    int side = game.whiteToMove ? WHITE : BLACK;
+    game.generateLegalMoves(moves);
+
+    if (capturesOnly) {
+        // Keep only the moves that win material: captures and queen promotions
+        int kept = 0;
+        for (int i = 0; i < moves.size(); i++) {
+            if ((game.board.colours[side ^ 1] & squareBB(moves[i].to()))
+                || moves[i].flags() == EN_PASSANT || moves[i].flags() == PROMOTE_QUEEN) {
+                moves[kept++] = moves[i];
+            }
+        }
+        moves.count = kept;
+    }
+}
+
+/* Orders moves: hash move, then captures (most valuable victim, least valuable attacker), then killers */
+void Searcher::orderMoves(MoveList& moves, Move hashMove, int ply) const {
+    int scores[MoveList::CAPACITY];
+    for (int i = 0; i < moves.size(); i++) {
+        Move move = moves[i];
+        char victim = move.flags() == EN_PASSANT ? 'p' : game.board.squares[move.to()];
+        if (move == hashMove) {
+            scores[i] = 1000000;
+        } else if (victim != 0) {
+            int attacker = pieceIndex(game.board.squares[move.from()]) % 6;
+            scores[i] = 100000 + 10 * pieceValues[pieceIndex(victim) % 6] - pieceValues[attacker] / 10;
+        } else if (move == killers[ply][0]) {
+            scores[i] = 90000;
+        } else if (move == killers[ply][1]) {
+            scores[i] = 80000;
+        } else {
+            scores[i] = 0;
+        }
+    }
+
+    // Insertion sort, descending: move lists are short and often nearly ordered
+    for (int i = 1; i < moves.size(); i++) {
+        Move move = moves[i];
+        int score = scores[i];
+        int j = i - 1;
+        while (j >= 0 && scores[j] < score) {
+            moves[j + 1] = moves[j];
+            scores[j + 1] = scores[j];
+            j--;
+        }
+        moves[j + 1] = move;
+        scores[j + 1] = score;
+    }
+}
+
+/* Plays a legal move on the game's undo stack, which also hands the turn over */
+void Searcher::makeMove(Move move) {
+    game.makeMove(move);
+}
+
+/* Takes back the move played by makeMove */
+void Searcher::unmakeMove() {
+    game.unmakeMove();
+}
+
+/* Principal-variation search: the first move gets the full window, later moves a null
+   window that is only widened again when they unexpectedly beat alpha */
+int Searcher::alphaBeta(int depth, int alpha, int beta, int ply, bool isPvNode) {
+    pvLength[ply] = ply;
+    if (depth <= 0) {
+        return quiescence(alpha, beta, ply);
+    }
+
+    nodes++;
+    if (ply > 0 && shouldStop()) {
+        return 0;
+    }
+    if (ply >= MAX_PLY) {
+        return evaluate();
+    }
+    // A position seen before in the game or on the way here can be repeated by force, so it is
+    // scored as a draw at once instead of being searched again
+    if (ply > 0 && game.isRepetition()) {
+        return 0;
+    }
+
+    // Endings in the tablebases are decided without searching
+    TbResult ending;
+    if (ply > 0 && limits.tablebases && popCount(game.board.occupied) <= limits.tablebases->maxPieces()
+        && limits.tablebases->probe(game, ending)) {
+        return tablebaseScore(ending, ply);
+    }
+
+    // Reuse earlier results for this position; PV nodes only take the move, to keep the PV intact
+    Move hashMove = Move();
+    TTEntry entry;
+    if (table.probe(game.hashKey, entry)) {
+        hashMove = entry.bestMove;
+        int score = scoreFromTable(entry.score, ply);
+        if (!isPvNode && entry.depth >= depth) {
+            if (entry.bound == BOUND_EXACT
+                || (entry.bound == BOUND_LOWER && score >= beta)
+                || (entry.bound == BOUND_UPPER && score <= alpha)) {
+                return score;
+            }
+        }
+    }
+
+    bool inCheck = !game.isKingSafe(game.whiteToMove);
+    // Fifty-move rule, unless the move that reached it delivered mate
+    if (ply > 0 && game.isFiftyMoveDraw() && (!inCheck || game.hasLegalMove(game.whiteToMove))) {
+        return 0;
+    }
+    if (inCheck) {
+        depth++; // Look one ply further when in check so forced sequences are not cut short
+    }
+
+    MoveList moves;
+    generateMoves(moves, false);
+    orderMoves(moves, hashMove, ply);
+
+    int originalAlpha = alpha;
+    int bestScore = -INFINITE_SCORE;
+    Move bestMove = Move();
+    int legalMoves = 0;
+
+    for (int i = 0; i < moves.size(); i++) {
+        Move move = moves[i];
+        bool isCapture = game.board.squares[move.to()] != 0 || move.flags() == EN_PASSANT;
+        makeMove(move);
+        legalMoves++;
+
+        int score;
+        if (legalMoves == 1) {
+            score = -alphaBeta(depth - 1, -beta, -alpha, ply + 1, isPvNode);
+        } else {
+            score = -alphaBeta(depth - 1, -alpha - 1, -alpha, ply + 1, false);
+            if (score > alpha && score < beta) {
+                score = -alphaBeta(depth - 1, -beta, -alpha, ply + 1, true);
+            }
+        }
+        unmakeMove();
+
+        if (stopFlag.load(memory_order_relaxed)) {
+            return 0;
+        }
+
+        if (score > bestScore) {
+            bestScore = score;
+            bestMove = move;
+            if (score > alpha) {
+                alpha = score;
+                // Extend the principal variation with the child's line
+                pvTable[ply][ply] = move;
+                for (int next = ply + 1; next < pvLength[ply + 1]; next++) {
+                    pvTable[ply][next] = pvTable[ply + 1][next];
+                }
+                pvLength[ply] = pvLength[ply + 1];
+
+                if (alpha >= beta) {
+                    // Remember quiet moves that refute a line; they often refute its siblings too
+                    if (!isCapture && move != killers[ply][0]) {
+                        killers[ply][1] = killers[ply][0];
+                        killers[ply][0] = move;
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    if (legalMoves == 0) {
+        // Checkmate (scored by distance from the root) or stalemate
+        return inCheck ? -MATE_SCORE + ply : 0;
+    }
+
+    Bound bound = bestScore >= beta ? BOUND_LOWER : bestScore > originalAlpha ? BOUND_EXACT : BOUND_UPPER;
+    table.store(game.hashKey, bestMove, scoreToTable(bestScore, ply), depth, bound);
+    return bestScore;
+}
+
+/* Searches captures only, so the static evaluation is never taken in the middle of an exchange */
+int Searcher::quiescence(int alpha, int beta, int ply) {
+    pvLength[ply] = ply;
+    nodes++;
+    if (shouldStop()) {
+        return 0;
+    }
+
+    int standPat = evaluate();
+    if (ply >= MAX_PLY || standPat >= beta) {
+        return standPat;
+    }
+    if (standPat > alpha) {
+        alpha = standPat;
+    }
+
+    MoveList moves;
+    generateMoves(moves, true);
+    orderMoves(moves, Move(), ply);
+
+    for (int i = 0; i < moves.size(); i++) {
+        makeMove(moves[i]);
+        int score = -quiescence(-beta, -alpha, ply + 1);
+        unmakeMove();
+
+        if (stopFlag.load(memory_order_relaxed)) {
+            return 0;
+        }
+        if (score > alpha) {
+            alpha = score;
+            if (alpha >= beta) {
+                break;
+            }
+        }
+    }
+    return alpha;
+}
+
+/* Iterative deepening: search depth 1, 2, 3, ... keeping the last completed iteration */
+SearchResult Searcher::run(const SearchLimits& searchLimits) {
+    limits = searchLimits;
+    nodes = 0;
+    startTime = chrono::steady_clock::now();
+    memset(killers, 0, sizeof(killers));
+    if (threadIndex == 0) {
+        table.newSearch(); // Helpers share the main thread's generation
+    }
+
+    int maxDepth = limits.depth > 0 && limits.depth < MAX_PLY ? limits.depth : MAX_PLY;
+    SearchResult result;
+
+    // Until an iteration completes the answer is the table's move, or else the first legal move,
+    // so a search stopped before finishing depth 1 still returns a move that can be played
+    MoveList rootMoves;
+    game.generateLegalMoves(rootMoves);
+    TTEntry entry;
+    bool tableMoveLegal = false;
+    if (table.probe(game.hashKey, entry)) {
+        for (int i = 0; i < rootMoves.size(); i++) {
+            tableMoveLegal |= rootMoves[i] == entry.bestMove;
+        }
+    }
+    if (tableMoveLegal) {
+        result.bestMove = entry.bestMove;
+    } else if (rootMoves.size() > 0) {
+        result.bestMove = rootMoves[0];
+    }
+
+    for (int depth = 1; depth <= maxDepth; depth++) {
+        // Helper threads skip some iterations (never the first) to diversify the shared table
+        if (threadIndex > 0 && depth > 1) {
+            int pattern = (threadIndex - 1) % SKIP_PATTERNS;
+            if (((depth + skipPhase[pattern]) / skipSize[pattern]) % 2) {
+                continue;
+            }
+        }
+
+        int score = alphaBeta(depth, -INFINITE_SCORE, INFINITE_SCORE, 0, true);
+
+        // An interrupted iteration is discarded, except that a first iteration cut short still
+        // beats the fallback move once it has a fully searched root move; its score is not kept
+        if (stopFlag.load(memory_order_relaxed)) {
+            if (depth == 1 && pvLength[0] > 0) {
+                result.bestMove = pvTable[0][0];
+                result.pv.assign(pvTable[0], pvTable[0] + pvLength[0]);
+            }
+            break;
+        }
+
+        result.score = score;
+        result.depth = depth;
+        if (pvLength[0] > 0) {
+            result.bestMove = pvTable[0][0];
+            result.pv.assign(pvTable[0], pvTable[0] + pvLength[0]);
+        }
+        if (threadIndex == 0 && limits.onIteration) {
+            result.nodes = nodes;
+            result.timeMs = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - startTime).count();
+            result.nodesPerSecond = result.timeMs > 0 ? nodes * 1000 / result.timeMs : nodes * 1000;
+            limits.onIteration(result);
+        }
+
+        if (stopFlag.load(memory_order_relaxed)) {
+            break;
+        }
+        // A forced mate found within this depth will not change with deeper search
+        if (score >= MATE_BOUND || score <= -MATE_BOUND) {
+            if (MATE_SCORE - (score > 0 ? score : -score) <= depth) {
+                break;
+            }
+        }
+    }
+
+    result.nodes = nodes;
+    result.timeMs = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - startTime).count();
+    result.nodesPerSecond = result.timeMs > 0 ? nodes * 1000 / result.timeMs : nodes * 1000;
+    return result;
+}
+
+/* Lazy SMP: every thread runs iterative deepening on its own copy of the root position and
+   they cooperate only through the shared transposition table */
+SearchResult parallelSearch(const ChessGame& game, const SearchLimits& limits, TranspositionTable& table) {
+    int threadCount = limits.threads > 1 ? limits.threads : 1;
+    // The threads share a flag of their own, raised when the main thread finishes or sees the
+    // caller's stop signal; the caller's flag is never written, so it still means "stop requested"
+    atomic<bool> stop(false);
+
+    vector<unique_ptr<ChessGame>> games;
+    vector<unique_ptr<Searcher>> searchers;
+    for (int i = 0; i < threadCount; i++) {
+        games.emplace_back(new ChessGame(game));
+        searchers.emplace_back(new Searcher(*games[i], table, stop, i));
+    }
+
+    // Helpers have no budget of their own: they run until the main thread raises the stop flag,
+    // but keep every other setting (depth, tablebases, the caller's stop signal). The node budget
+    // is split so the total over all threads stays close to the requested count.
+    SearchLimits mainLimits = limits;
+    if (mainLimits.nodes) {
+        mainLimits.nodes = mainLimits.nodes / threadCount + 1;
+    }
+    SearchLimits helperLimits = limits;
+    helperLimits.nodes = 0;
+    helperLimits.moveTimeMs = 0;
+
+    vector<SearchResult> results(threadCount);
+    vector<thread> helpers;
+    for (int i = 1; i < threadCount; i++) {
+        helpers.emplace_back([&, i] { results[i] = searchers[i]->run(helperLimits); });
+    }
+
+    results[0] = searchers[0]->run(mainLimits);
+    stop.store(true, memory_order_relaxed);
+    for (thread& helper : helpers) {
+        helper.join();
+    }
+
+    // Take the deepest completed iteration, preferring the main thread on ties
+    SearchResult best = results[0];
+    uint64_t totalNodes = 0;
+    for (int i = 0; i < threadCount; i++) {
+        totalNodes += results[i].nodes;
+        if (results[i].depth > best.depth && results[i].bestMove != Move()) {
+            best = results[i];
+        }
+    }
+    best.nodes = totalNodes;
+    best.timeMs = results[0].timeMs;
+    best.nodesPerSecond = best.timeMs > 0 ? totalNodes * 1000 / best.timeMs : totalNodes * 1000;
+    return best;
+}
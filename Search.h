@@ -0,0 +1,95 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "Move.h"
+
+using namespace std;
+
+class ChessGame;
+class TranspositionTable;
+struct SearchResult;
+class Tablebases;
+
+// Score for delivering mate at the root; mate in n plies scores MATE_SCORE - n
+const int MATE_SCORE = 32000;
+// Deepest ply the search will reach
+const int MAX_PLY = 64;
+
+// Budget for a search; zero means "no limit" for each field
+struct SearchLimits {
+  int depth = 0;             // maximum iteration depth (capped at MAX_PLY)
+  uint64_t nodes = 0;        // stop after this many nodes
+  int64_t moveTimeMs = 0;    // stop after this many milliseconds
+  int threads = 1;           // worker threads (Lazy SMP when more than one)
+  atomic<bool>* stopSignal = nullptr; // optional flag another thread can raise to end the search; never written by it
+  const Tablebases* tablebases = nullptr; // optional endgame tables, probed below the root
+  // Optional progress report, called by the main search thread after each completed iteration
+  function<void(const SearchResult&)> onIteration;
+};
+
+// Outcome of a search: best move, score from the side to move's view and principal variation
+struct SearchResult {
+  Move bestMove = Move();
+  int score = 0;
+  int depth = 0;             // last fully completed iteration
+  uint64_t nodes = 0;
+  int64_t timeMs = 0;
+  uint64_t nodesPerSecond = 0;
+  vector<Move> pv;
+};
+
+// Principal-variation alpha-beta search with iterative deepening and quiescence search.
+// It plays moves on the given game with makeMove/unmakeMove and restores the position
+// before returning.
+class Searcher {
+private:
+  ChessGame& game;
+  TranspositionTable& table;
+  atomic<bool>& stopFlag;    // raised externally or when the budget runs out
+  int threadIndex;           // 0 for the main thread, helpers skip some depths
+
+  SearchLimits limits;
+  chrono::steady_clock::time_point startTime;
+  uint64_t nodes;
+
+  Move pvTable[MAX_PLY + 1][MAX_PLY + 1];
+  int pvLength[MAX_PLY + 1];
+  Move killers[MAX_PLY + 1][2];
+
+  /* Checks the node and time budget, raising the stop flag when it is spent */
+  bool shouldStop();
+  /* Searches the current position to the given depth within the (alpha, beta) window */
+  int alphaBeta(int depth, int alpha, int beta, int ply, bool isPvNode);
+  /* Extends the search along captures until the position is quiet */
+  int quiescence(int alpha, int beta, int ply);
+  /* Orders moves: hash move, then captures (most valuable victim first), then killers */
+  void orderMoves(MoveList& moves, Move hashMove, int ply) const;
+  /* Generates the legal moves of the side to move (captures only if requested) */
+  void generateMoves(MoveList& moves, bool capturesOnly) const;
+  /* Plays a legal move */
+  void makeMove(Move move);
+  /* Takes back a move played by makeMove */
+  void unmakeMove();
+  /* Static evaluation from the point of view of the side to move */
+  int evaluate() const;
+
+public:
+  Searcher(ChessGame& game, TranspositionTable& table, atomic<bool>& stopFlag, int threadIndex = 0);
+
+  /* Runs iterative deepening until a limit is reached or the stop flag is raised */
+  SearchResult run(const SearchLimits& limits);
+  /* Nodes visited so far by the current run */
+  uint64_t nodeCount() const { return nodes; }
+};
+
+// Lazy SMP: searches the same root on limits.threads threads, each with its own copy of the
+// game, sharing one transposition table. Helper threads skip some depths so they spread
+// over different iterations; the main thread owns the budget and stops the helpers.
+SearchResult parallelSearch(const ChessGame& game, const SearchLimits& limits, TranspositionTable& table);
+
+#endif // SEARCH_H
@@ -0,0 +1,183 @@
+#include <algorithm>
+#include <cstring>
+#include "Sessions.h"
+
+/* Starts one worker per shard */
+SessionManager::SessionManager(int shardCount, SessionReplyHandler handler) : onReply(handler), nextShard(0) {
+    if (shardCount <= 0) {
+        shardCount = max(1, int(thread::hardware_concurrency()));
+    }
+    ChessGame start;
+    start.setOutput(nullptr);
+    start.loadState("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", false);
+    start.pack(startPosition);
+
+    for (int i = 0; i < shardCount; i++) {
+        shards.emplace_back(new Shard());
+    }
+    for (auto& shard : shards) {
+        Shard* owned = shard.get();
+        shard->worker = thread([this, owned] { run(*owned); });
+    }
+}
+
+/* Lets every worker drain its queue, then joins it */
+SessionManager::~SessionManager() {
+    for (auto& shard : shards) {
+        lock_guard<mutex> guard(shard->lock);
+        shard->stopping = true;
+        shard->wakeWorker.notify_one();
+    }
+    for (auto& shard : shards) {
+        shard->worker.join();
+    }
+}
+
+/* Takes everything queued in one go, then plays the moves without holding the lock. The game
+   last played on stays unpacked, so a run of moves on one game only unpacks it once */
+void SessionManager::run(Shard& shard) {
+    // One full ChessGame per shard; it is large (move history, cached moves), which is why the
+    // hosted games are kept packed instead
+    unique_ptr<ChessGame> game(new ChessGame());
+    game->setOutput(nullptr);
+    const uint64_t NO_SLOT = UINT64_MAX;
+    uint64_t loadedSlot = NO_SLOT;
+    uint64_t count = shards.size();
+    vector<SessionRequest> moves;
+
+    unique_lock<mutex> lock(shard.lock);
+    while (true) {
+        shard.wakeWorker.wait(lock, [&] { return shard.stopping || shard.processed != shard.submitted; });
+        if (shard.processed == shard.submitted) {
+            return; // Stopping, with nothing left to do
+        }
+        uint64_t taken = shard.pendingGames.size() + shard.pendingMoves.size();
+        shard.games.insert(shard.games.end(), shard.pendingGames.begin(), shard.pendingGames.end());
+        // The pending list can be as long as a burst of new games, so its memory is handed back
+        shard.pendingGames.clear();
+        shard.pendingGames.shrink_to_fit();
+        moves.swap(shard.pendingMoves);
+        lock.unlock();
+
+        uint64_t played = 0, rejected = 0;
+        for (const SessionRequest& request : moves) {
+            uint64_t slot = request.gameId / count;
+            SessionReply reply;
+            reply.gameId = request.gameId;
+            if (slot != loadedSlot && !game->unpack(shard.games[slot])) {
+                loadedSlot = NO_SLOT;
+                reply.result = {MOVE_ILLEGAL, Move(), 0, 0, false, false, false, false, false};
+            } else {
+                loadedSlot = slot;
+                reply.result = game->submitMove(request.from, request.to);
+                if (reply.result.ok()) {
+                    game->pack(shard.games[slot]);
+                }
+            }
+            if (reply.result.ok()) {
+                played++;
+            } else {
+                rejected++;
+            }
+            if (onReply) {
+                onReply(reply);
+            }
+        }
+        moves.clear();
+
+        lock.lock();
+        shard.processed += taken;
+        shard.movesPlayed += played;
+        shard.movesRejected += rejected;
+        if (shard.processed == shard.submitted) {
+            shard.idle.notify_all();
+        }
+    }
+}
+
+/* Creates a game in the starting position */
+uint64_t SessionManager::createGame() {
+    return createGame(startPosition);
+}
+
+/* Queues a new game on the next shard in turn; its slot is fixed now, under the shard's lock, so
+   ids match the order in which the worker appends the games */
+uint64_t SessionManager::createGame(const PackedPosition& position) {
+    uint64_t index = nextShard++ % shards.size();
+    Shard& shard = *shards[index];
+    lock_guard<mutex> guard(shard.lock);
+    uint64_t slot = shard.gameCount++;
+    shard.pendingGames.push_back(position);
+    if (shard.submitted++ == shard.processed) {
+        shard.wakeWorker.notify_one();
+    }
+    return slot * shards.size() + index;
+}
+
+/* Queues one move on the shard that holds the game */
+bool SessionManager::submitMove(uint64_t gameId, const char* from, const char* to) {
+    SessionRequest request;
+    request.gameId = gameId;
+    strncpy(request.from, from, 2);
+    request.from[2] = 0;
+    strncpy(request.to, to, 2);
+    request.to[2] = 0;
+    return submitMoves(&request, 1) == 1;
+}
+
+/* Visits the shards in turn, queueing the requests that belong to each under one lock */
+size_t SessionManager::submitMoves(const SessionRequest* requests, size_t count) {
+    size_t accepted = 0;
+    uint64_t shardTotal = shards.size();
+    for (uint64_t index = 0; index < shardTotal; index++) {
+        Shard& shard = *shards[index];
+        lock_guard<mutex> guard(shard.lock);
+        uint64_t before = shard.submitted;
+        for (size_t i = 0; i < count; i++) {
+            uint64_t gameId = requests[i].gameId;
+            if (gameId % shardTotal == index && gameId / shardTotal < shard.gameCount) {
+                shard.pendingMoves.push_back(requests[i]);
+                shard.submitted++;
+            }
+        }
+        accepted += shard.submitted - before;
+        if (before == shard.processed && shard.submitted != before) {
+            shard.wakeWorker.notify_one();
+        }
+    }
+    return accepted;
+}
+
+/* Waits for each shard in turn to catch up with what was queued */
+void SessionManager::wait() {
+    for (auto& shard : shards) {
+        unique_lock<mutex> lock(shard->lock);
+        shard->idle.wait(lock, [&] { return shard->processed == shard->submitted; });
+    }
+}
+
+/* Copies a packed game while its shard is idle, when the worker is not writing to it */
+bool SessionManager::getPosition(uint64_t gameId, PackedPosition& position) {
+    Shard& shard = *shards[gameId % shards.size()];
+    uint64_t slot = gameId / shards.size();
+    unique_lock<mutex> lock(shard.lock);
+    if (slot >= shard.gameCount) {
+        return false;
+    }
+    shard.idle.wait(lock, [&] { return shard.processed == shard.submitted; });
+    position = shard.games[slot];
+    return true;
+}
+
+/* Adds up the shards' counters */
+SessionStats SessionManager::stats() {
+    SessionStats total = {0, 0, 0, 0};
+    for (auto& shard : shards) {
+        lock_guard<mutex> guard(shard->lock);
+        total.games += shard->gameCount;
+        total.movesPlayed += shard->movesPlayed;
+        total.movesRejected += shard->movesRejected;
+        total.bytes += (shard->games.capacity() + shard->pendingGames.capacity()) * sizeof(PackedPosition);
+    }
+    return total;
+}
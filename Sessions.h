@@ -0,0 +1,106 @@
+#ifndef SESSIONS_H
+#define SESSIONS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "ChessGame.h"
+
+using namespace std;
+
+// A move for one hosted game, in the squares submitMove takes (e.g. "E2", "E4")
+struct SessionRequest {
+  uint64_t gameId;
+  char from[3];
+  char to[3];
+};
+
+// What happened to a request
+struct SessionReply {
+  uint64_t gameId;
+  MoveResult result;
+};
+
+// Called on the shard's thread for every processed request, so it may run on several threads at once
+typedef function<void(const SessionReply&)> SessionReplyHandler;
+
+// Totals over every shard
+struct SessionStats {
+  uint64_t games;
+  uint64_t movesPlayed;
+  uint64_t movesRejected;
+  uint64_t bytes;         // memory holding the games, including unused vector capacity
+};
+
+// Hosts many games in one process. Each game is kept as a 32-byte PackedPosition (no move history)
+// in one of several shards, and each shard is owned by its own worker thread: requests are routed
+// by game id to the shard's queue, which is the only thing its lock protects, and the worker
+// unpacks a game into its one ChessGame, plays the move and packs it back
+class SessionManager {
+private:
+  // One partition of the games with its worker; game id = slot * shard count + shard index
+  struct Shard {
+    // Written by the worker only, except that new games are appended under the lock
+    vector<PackedPosition> games;
+
+    mutex lock;
+    condition_variable wakeWorker, idle;
+    // Requests not yet taken by the worker; new games go in first, so a game always exists
+    // before any of its moves are played
+    vector<PackedPosition> pendingGames;
+    vector<SessionRequest> pendingMoves;
+    uint64_t gameCount = 0;      // games created, including pending ones
+    uint64_t submitted = 0;      // requests (games and moves) handed to the shard
+    uint64_t processed = 0;      // requests the worker has finished
+    uint64_t movesPlayed = 0;
+    uint64_t movesRejected = 0;
+    bool stopping = false;
+    thread worker;
+  };
+
+  vector<unique_ptr<Shard>> shards;
+  SessionReplyHandler onReply;
+  PackedPosition startPosition;
+  atomic<uint64_t> nextShard;
+
+  // Worker loop of one shard
+  void run(Shard& shard);
+
+public:
+  // Starts the shard threads; shardCount 0 means one per hardware thread. The handler is optional
+  explicit SessionManager(int shardCount = 0, SessionReplyHandler handler = nullptr);
+  // Finishes the queued requests and stops the threads
+  ~SessionManager();
+  SessionManager(const SessionManager&) = delete;
+  SessionManager& operator=(const SessionManager&) = delete;
+
+  int shardCount() const { return int(shards.size()); }
+
+  // Creates a game in the starting position, or in a packed one, and returns its id. Games are
+  // spread over the shards in turn. The packed position is not checked here: moves on a game whose
+  // record does not unpack are rejected as MOVE_ILLEGAL
+  uint64_t createGame();
+  uint64_t createGame(const PackedPosition& position);
+
+  // Queues a move; returns false, queueing nothing, for an id createGame has not returned.
+  // Moves on the same game are played in the order they were queued
+  bool submitMove(uint64_t gameId, const char* from, const char* to);
+  // Queues many moves, taking each shard's lock once; returns the number accepted
+  size_t submitMoves(const SessionRequest* requests, size_t count);
+
+  // Blocks until every request queued so far has been processed
+  void wait();
+  // Copies a game's position once the moves queued for its shard so far have been played;
+  // returns false for an unknown id
+  bool getPosition(uint64_t gameId, PackedPosition& position);
+  // Totals over the shards
+  SessionStats stats();
+};
+
+#endif // SESSIONS_H
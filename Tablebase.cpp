@@ -0,0 +1,935 @@
+#include "Tablebase.h"
+#include "ChessGame.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <set>
+#include <thread>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Entry values: 0 is a draw and 1 + plies a decided position (odd plies win for the side to move,
+// even plies lose). The two markers below never reach a probe of a legal position
+static const uint8_t VALUE_DRAW = 0;
+static const uint8_t VALUE_UNKNOWN = 254; // undecided during generation, a draw once it ends
+static const uint8_t VALUE_INVALID = 255; // illegal position or duplicate index
+static const int MAX_PLIES = 252;
+
+static const uint32_t BLOCK_SIZE = 2048;
+
+// Fixed-size file header, followed by blockCount + 1 block offsets and the block data.
+// Blocks are (value, run length - 1) byte pairs; invalid entries take any neighbouring value
+struct TbFileHeader {
+    char magic[4];
+    uint32_t blockSize;
+    uint64_t sideSize;
+    uint64_t blockCount;
+    char material[16];
+};
+
+static const char FILE_MAGIC[4] = {'C', 'T', 'B', '1'};
+
+// Pieces of a position in no particular order
+struct TbPieces {
+    int count;
+    char piece[TB_MAX_PIECES];
+    int square[TB_MAX_PIECES];
+};
+
+// Shape of one table. Slots are the white king, the black king, then the other white and black
+// pieces in the order of the material name; an index is the king slot followed by 6 bits per piece
+struct TbLayout {
+    string material;
+    int count;
+    char slot[TB_MAX_PIECES];
+    bool hasPawns;
+    uint64_t sideSize;
+};
+
+// A table held in memory while generating
+struct TbData {
+    TbLayout layout;
+    vector<uint8_t> values; // white to move, then black to move
+};
+typedef map<string, TbData> TbCache;
+
+// Squares the white king is mapped to in pawnless tables: the a1-d1-d4 triangle
+static const int triangleSquares[10] = {0, 1, 2, 3, 9, 10, 11, 18, 19, 27};
+static const int8_t triangleIndex[64] = {
+     0,  1,  2,  3, -1, -1, -1, -1,
+    -1,  4,  5,  6, -1, -1, -1, -1,
+    -1, -1,  7,  8, -1, -1, -1, -1,
+    -1, -1, -1,  9, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1,
+};
+
+/* Rank of a non-king piece in material names: queen, rook, bishop, knight, pawn */
+static int pieceStrength(char piece) {
+    switch (toupper(piece)) {
+        case 'Q': return 0;
+        case 'R': return 1;
+        case 'B': return 2;
+        case 'N': return 3;
+        default: return 4;
+    }
+}
+
+/* Orders one side's pieces (upper case, kings excluded) as in material names */
+static void sortPieces(string& pieces) {
+    stable_sort(pieces.begin(), pieces.end(), [](char a, char b) { return pieceStrength(a) < pieceStrength(b); });
+}
+
+/* Checks whether side a has less material than side b: fewer pieces, then weaker pieces first */
+static bool weakerSide(const string& a, const string& b) {
+    if (a.size() != b.size()) {
+        return a.size() < b.size();
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (pieceStrength(a[i]) != pieceStrength(b[i])) {
+            return pieceStrength(a[i]) > pieceStrength(b[i]);
+        }
+    }
+    return false;
+}
+
+string tbCanonicalMaterial(const string& material) {
+    size_t separator = material.find('v');
+    if (separator == string::npos || separator == 0 || separator + 1 >= material.size()
+        || material[0] != 'K' || material[separator + 1] != 'K') {
+        return "";
+    }
+    string white = material.substr(1, separator - 1);
+    string black = material.substr(separator + 2);
+    for (char piece : white + black) {
+        if (piece == 0 || !strchr("QRBNP", piece)) {
+            return "";
+        }
+    }
+    int count = 2 + int(white.size() + black.size());
+    if (count < 3 || count > TB_MAX_PIECES) {
+        return "";
+    }
+    sortPieces(white);
+    sortPieces(black);
+    if (weakerSide(white, black)) {
+        swap(white, black);
+    }
+    return "K" + white + "vK" + black;
+}
+
+/* Appends every multiset of size pieces drawn from QRBNP, in material order */
+static void pieceCombinations(int size, int first, string& current, vector<string>& combinations) {
+    if (size == 0) {
+        combinations.push_back(current);
+        return;
+    }
+    for (int kind = first; kind < 5; kind++) {
+        current.push_back("QRBNP"[kind]);
+        pieceCombinations(size - 1, kind, current, combinations);
+        current.pop_back();
+    }
+}
+
+vector<string> tbMaterialsWithPieces(int pieces) {
+    vector<string> materials;
+    set<string> seen;
+    for (int whiteCount = 0; whiteCount <= pieces - 2; whiteCount++) {
+        vector<string> whiteSets, blackSets;
+        string current;
+        pieceCombinations(whiteCount, 0, current, whiteSets);
+        pieceCombinations(pieces - 2 - whiteCount, 0, current, blackSets);
+        for (const string& white : whiteSets) {
+            for (const string& black : blackSets) {
+                string material = tbCanonicalMaterial("K" + white + "vK" + black);
+                if (!material.empty() && seen.insert(material).second) {
+                    materials.push_back(material);
+                }
+            }
+        }
+    }
+    return materials;
+}
+
+/* Builds the slot layout of a canonical material name */
+static void parseLayout(const string& material, TbLayout& layout) {
+    size_t separator = material.find('v');
+    layout.material = material;
+    layout.count = 0;
+    layout.slot[layout.count++] = 'K';
+    layout.slot[layout.count++] = 'k';
+    for (size_t i = 1; i < separator; i++) {
+        layout.slot[layout.count++] = material[i];
+    }
+    for (size_t i = separator + 2; i < material.size(); i++) {
+        layout.slot[layout.count++] = char(tolower(material[i]));
+    }
+    layout.hasPawns = material.find('P') != string::npos;
+    layout.sideSize = uint64_t(layout.hasPawns ? 32 : 10) << (6 * (layout.count - 1));
+}
+
+/* Applies a board symmetry: bit 0 mirrors the files, bit 1 the ranks, bit 2 swaps files and ranks */
+static int transformSquare(int square, int symmetry) {
+    if (symmetry & 1) {
+        square ^= 7;
+    }
+    if (symmetry & 2) {
+        square ^= 56;
+    }
+    if (symmetry & 4) {
+        square = (squareCol(square) << 3) | squareRow(square);
+    }
+    return square;
+}
+
+static uint64_t encodeWith(int count, bool hasPawns, const int* squares, int symmetry) {
+    int king = transformSquare(squares[0], symmetry);
+    uint64_t index = hasPawns ? uint64_t(squareRow(king) * 4 + squareCol(king)) : uint64_t(triangleIndex[king]);
+    for (int i = 1; i < count; i++) {
+        index = (index << 6) | uint64_t(transformSquare(squares[i], symmetry));
+    }
+    return index;
+}
+
+/* Index of a position given its squares in slot order. The white king is moved to files a-d (and,
+   without pawns, to the a1-d1-d4 triangle) so every symmetric copy of a position gets the same index;
+   with the king on the diagonal the smaller of the two reflections is taken */
+static uint64_t encode(int count, bool hasPawns, const int* squares) {
+    int king = squares[0];
+    int symmetry = squareCol(king) > 3 ? 1 : 0;
+    if (!hasPawns) {
+        if (squareRow(king) > 3) {
+            symmetry |= 2;
+        }
+        int mapped = transformSquare(king, symmetry);
+        if (squareRow(mapped) > squareCol(mapped)) {
+            symmetry |= 4;
+        } else if (squareRow(mapped) == squareCol(mapped)) {
+            return min(encodeWith(count, hasPawns, squares, symmetry),
+                       encodeWith(count, hasPawns, squares, symmetry | 4));
+        }
+    }
+    return encodeWith(count, hasPawns, squares, symmetry);
+}
+
+/* Squares in slot order for an index */
+static void decode(const TbLayout& layout, uint64_t index, int* squares) {
+    for (int i = layout.count - 1; i > 0; i--) {
+        squares[i] = int(index & 63);
+        index >>= 6;
+    }
+    squares[0] = layout.hasPawns ? int(index / 4) * 8 + int(index % 4) : triangleSquares[index];
+}
+
+/* Names the table holding a position and orders its squares into that table's slots. When black
+   has the stronger material the board is mirrored top to bottom with the colours (and side to move)
+   swapped, so each ending is stored once */
+static string canonicalise(const TbPieces& position, int& side, int* slotSquares) {
+    int kings[2] = {-1, -1};
+    string pieces[2];
+    int squares[2][TB_MAX_PIECES];
+    for (int i = 0; i < position.count; i++) {
+        int colour = isupper(position.piece[i]) ? WHITE : BLACK;
+        char piece = char(toupper(position.piece[i]));
+        if (piece == 'K') {
+            kings[colour] = position.square[i];
+        } else {
+            // Insert in material order
+            int at = int(pieces[colour].size());
+            while (at > 0 && pieceStrength(pieces[colour][at - 1]) > pieceStrength(piece)) {
+                squares[colour][at] = squares[colour][at - 1];
+                at--;
+            }
+            pieces[colour].insert(pieces[colour].begin() + at, piece);
+            squares[colour][at] = position.square[i];
+        }
+    }
+
+    int flip = weakerSide(pieces[WHITE], pieces[BLACK]) ? 56 : 0;
+    int white = flip ? BLACK : WHITE;
+    if (flip) {
+        side ^= 1;
+    }
+    int count = 0;
+    slotSquares[count++] = kings[white] ^ flip;
+    slotSquares[count++] = kings[white ^ 1] ^ flip;
+    for (int colour : {white, white ^ 1}) {
+        for (size_t i = 0; i < pieces[colour].size(); i++) {
+            slotSquares[count++] = squares[colour][i] ^ flip;
+        }
+    }
+    return "K" + pieces[white] + "vK" + pieces[white ^ 1];
+}
+
+/* Squares attacked by a piece (a pawn's captures only) */
+static Bitboard attacksFrom(char piece, int square, Bitboard occupied) {
+    switch (piece) {
+        case 'K': case 'k': return kingAttacks[square];
+        case 'N': case 'n': return knightAttacks[square];
+        case 'B': case 'b': return bishopAttacks(square, occupied);
+        case 'R': case 'r': return rookAttacks(square, occupied);
+        case 'Q': case 'q': return queenAttacks(square, occupied);
+        case 'P': return pawnAttacks[WHITE][square];
+        default: return pawnAttacks[BLACK][square];
+    }
+}
+
+static int pieceColour(char piece) {
+    return isupper(piece) ? WHITE : BLACK;
+}
+
+static bool isAttacked(const TbPieces& position, int square, int byColour, Bitboard occupied) {
+    for (int i = 0; i < position.count; i++) {
+        if (pieceColour(position.piece[i]) == byColour
+            && (attacksFrom(position.piece[i], position.square[i], occupied) & squareBB(square))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int kingSquareOf(const TbPieces& position, int colour) {
+    char king = colour == WHITE ? 'K' : 'k';
+    for (int i = 0; i < position.count; i++) {
+        if (position.piece[i] == king) {
+            return position.square[i];
+        }
+    }
+    return -1;
+}
+
+/* Value of a position reached by a capture or promotion, from the generated sub-tables */
+static uint8_t subTableValue(const TbCache& cache, const TbPieces& position, int side) {
+    if (position.count == 2) {
+        return VALUE_DRAW;
+    }
+    int squares[TB_MAX_PIECES];
+    string material = canonicalise(position, side, squares);
+    const TbData& table = cache.at(material);
+    return table.values[side * table.layout.sideSize + encode(table.layout.count, table.layout.hasPawns, squares)];
+}
+
+static bool isWinValue(uint8_t value) {
+    return value != VALUE_DRAW && value <= MAX_PLIES + 1 && ((value - 1) & 1);
+}
+
+/* Runs work(begin, end) over [0, count) split evenly between threads */
+template <typename Work>
+static void parallelFor(uint64_t count, int threads, Work work) {
+    vector<thread> workers;
+    uint64_t chunk = (count + threads - 1) / threads;
+    for (int t = 0; t < threads; t++) {
+        uint64_t begin = min(count, t * chunk), end = min(count, begin + chunk);
+        workers.emplace_back([=] { work(begin, end); });
+    }
+    for (thread& worker : workers) {
+        worker.join();
+    }
+}
+
+// Retrograde analysis of one table. Every position first counts its moves that stay in the table
+// and scores its captures and promotions from the sub-tables. Then, one distance at a time, each
+// decided position visits its predecessors: a loss makes them wins one ply longer, a win takes one
+// off their count of undecided moves, and a predecessor whose count reaches zero is lost.
+class TbGenerator {
+private:
+    const TbLayout& layout;
+    const TbCache& cache;
+    uint64_t entryCount;
+    unique_ptr<atomic<uint8_t>[]> values;
+    unique_ptr<atomic<uint8_t>[]> remaining;  // undecided in-table moves, +128 if a draw can be forced by conversion
+    unique_ptr<uint8_t[]> conversionLoss;     // longest loss forced through a capture or promotion, plies
+    atomic<int> longest;
+    atomic<bool> overflow;
+
+    void raiseLongest(int plies) {
+        int current = longest.load(memory_order_relaxed);
+        while (plies > current && !longest.compare_exchange_weak(current, plies)) {
+        }
+    }
+
+    /* Stores each distinct index only once, so moves to symmetric copies of a position count as one */
+    static int addUnique(uint64_t* indices, int count, uint64_t index) {
+        for (int i = 0; i < count; i++) {
+            if (indices[i] == index) {
+                return count;
+            }
+        }
+        indices[count] = index;
+        return count + 1;
+    }
+
+    void initialise(uint64_t entry) {
+        int side = entry >= layout.sideSize ? BLACK : WHITE;
+        uint64_t index = entry - side * layout.sideSize;
+        values[entry].store(VALUE_INVALID, memory_order_relaxed);
+        remaining[entry].store(0, memory_order_relaxed);
+        conversionLoss[entry] = 0;
+
+        TbPieces position;
+        position.count = layout.count;
+        memcpy(position.piece, layout.slot, sizeof(position.piece));
+        decode(layout, index, position.square);
+        Bitboard occupied = 0;
+        for (int i = 0; i < position.count; i++) {
+            int square = position.square[i];
+            bool isPawn = toupper(position.piece[i]) == 'P';
+            if ((occupied & squareBB(square)) || (isPawn && (squareRow(square) == 0 || squareRow(square) == 7))) {
+                return;
+            }
+            occupied |= squareBB(square);
+        }
+        if (encode(position.count, layout.hasPawns, position.square) != index
+            || isAttacked(position, kingSquareOf(position, side ^ 1), side, occupied)) {
+            return;
+        }
+
+        uint64_t quietChildren[MoveList::CAPACITY];
+        int quietCount = 0;
+        bool hasMove = false, conversionDraw = false;
+        int conversionWin = INT_MAX, longestConversionLoss = 0;
+        Bitboard own = 0;
+        for (int i = 0; i < position.count; i++) {
+            if (pieceColour(position.piece[i]) == side) {
+                own |= squareBB(position.square[i]);
+            }
+        }
+        for (int i = 0; i < position.count; i++) {
+            char piece = position.piece[i];
+            if (pieceColour(piece) != side) {
+                continue;
+            }
+            int from = position.square[i];
+            Bitboard targets;
+            bool isPawn = toupper(piece) == 'P';
+            if (isPawn) {
+                int forward = side == WHITE ? 8 : -8;
+                targets = pawnAttacks[side][from] & occupied & ~own;
+                if (!(occupied & squareBB(from + forward))) {
+                    targets |= squareBB(from + forward);
+                    if (squareRow(from) == (side == WHITE ? 1 : 6) && !(occupied & squareBB(from + 2 * forward))) {
+                        targets |= squareBB(from + 2 * forward);
+                    }
+                }
+            } else {
+                targets = attacksFrom(piece, from, occupied) & ~own;
+            }
+
+            while (targets) {
+                int to = popLsb(targets);
+                TbPieces child = position;
+                child.square[i] = to;
+                bool isCapture = false;
+                for (int j = 0; j < child.count; j++) {
+                    if (j != i && child.square[j] == to) {
+                        child.piece[j] = child.piece[child.count - 1];
+                        child.square[j] = child.square[child.count - 1];
+                        child.count--;
+                        isCapture = true;
+                        break;
+                    }
+                }
+                Bitboard childOccupied = (occupied & ~squareBB(from)) | squareBB(to);
+                if (isAttacked(child, kingSquareOf(child, side), side ^ 1, childOccupied)) {
+                    continue;
+                }
+                hasMove = true;
+
+                bool isPromotion = isPawn && (squareRow(to) == 0 || squareRow(to) == 7);
+                if (!isCapture && !isPromotion) {
+                    uint64_t childEntry = (side ^ 1) * layout.sideSize + encode(child.count, layout.hasPawns, child.square);
+                    quietCount = addUnique(quietChildren, quietCount, childEntry);
+                    continue;
+                }
+
+                // Captures and promotions leave the table: score them from the sub-table
+                int moverIndex = -1;
+                for (int j = 0; j < child.count; j++) {
+                    if (child.square[j] == to) {
+                        moverIndex = j;
+                    }
+                }
+                const char* promotions = isPromotion ? (side == WHITE ? "QRBN" : "qrbn") : nullptr;
+                for (int p = 0; p < (isPromotion ? 4 : 1); p++) {
+                    if (isPromotion) {
+                        child.piece[moverIndex] = promotions[p];
+                    }
+                    uint8_t value = subTableValue(cache, child, side ^ 1);
+                    if (value == VALUE_DRAW) {
+                        conversionDraw = true;
+                    } else if (isWinValue(value)) {
+                        longestConversionLoss = max(longestConversionLoss, int(value)); // plies + 1
+                    } else {
+                        conversionWin = min(conversionWin, int(value));
+                    }
+                }
+            }
+        }
+
+        if (!hasMove) {
+            bool inCheck = isAttacked(position, kingSquareOf(position, side), side ^ 1, occupied);
+            values[entry].store(inCheck ? 1 : VALUE_DRAW, memory_order_relaxed);
+            return;
+        }
+        conversionLoss[entry] = uint8_t(longestConversionLoss);
+        remaining[entry].store(uint8_t(quietCount + (conversionDraw ? 128 : 0)), memory_order_relaxed);
+        if (conversionWin != INT_MAX) {
+            values[entry].store(uint8_t(conversionWin + 1), memory_order_relaxed);
+            raiseLongest(conversionWin);
+        } else if (quietCount == 0) {
+            values[entry].store(conversionDraw ? VALUE_DRAW : uint8_t(longestConversionLoss + 1), memory_order_relaxed);
+            if (!conversionDraw) {
+                raiseLongest(longestConversionLoss);
+            }
+        } else {
+            values[entry].store(VALUE_UNKNOWN, memory_order_relaxed);
+        }
+    }
+
+    /* Visits the predecessors of a position decided in the given number of plies */
+    void propagate(uint64_t entry, int plies) {
+        int side = entry >= layout.sideSize ? BLACK : WHITE;
+        int mover = side ^ 1;
+        int squares[TB_MAX_PIECES];
+        decode(layout, entry - side * layout.sideSize, squares);
+        Bitboard occupied = 0;
+        for (int i = 0; i < layout.count; i++) {
+            occupied |= squareBB(squares[i]);
+        }
+
+        uint64_t predecessors[MoveList::CAPACITY];
+        int count = 0;
+        for (int i = 0; i < layout.count; i++) {
+            char piece = layout.slot[i];
+            if (pieceColour(piece) != mover) {
+                continue;
+            }
+            int to = squares[i];
+            Bitboard origins;
+            if (toupper(piece) == 'P') {
+                int backward = mover == WHITE ? -8 : 8;
+                int row = squareRow(to);
+                origins = 0;
+                if ((mover == WHITE ? row >= 2 : row <= 5) && !(occupied & squareBB(to + backward))) {
+                    origins |= squareBB(to + backward);
+                    if (row == (mover == WHITE ? 3 : 4) && !(occupied & squareBB(to + 2 * backward))) {
+                        origins |= squareBB(to + 2 * backward);
+                    }
+                }
+            } else {
+                origins = attacksFrom(piece, to, occupied) & ~occupied;
+            }
+            while (origins) {
+                squares[i] = popLsb(origins);
+                count = addUnique(predecessors, count, mover * layout.sideSize + encode(layout.count, layout.hasPawns, squares));
+            }
+            squares[i] = to;
+        }
+
+        for (int p = 0; p < count; p++) {
+            uint64_t predecessor = predecessors[p];
+            uint8_t current = values[predecessor].load(memory_order_relaxed);
+            if (current == VALUE_INVALID) {
+                continue;
+            }
+            if (plies + 1 > MAX_PLIES) {
+                overflow.store(true);
+                continue;
+            }
+            if ((plies & 1) == 0) {
+                // A move into a lost position wins; keep the shortest win
+                uint8_t win = uint8_t(plies + 2);
+                while (current == VALUE_UNKNOWN || (isWinValue(current) && current > win)) {
+                    if (values[predecessor].compare_exchange_weak(current, win)) {
+                        raiseLongest(plies + 1);
+                        break;
+                    }
+                }
+            } else if (remaining[predecessor].fetch_sub(1) == 1) {
+                // Every move now loses; the longest of them sets the distance
+                int loss = max(plies + 1, int(conversionLoss[predecessor]));
+                uint8_t expected = VALUE_UNKNOWN;
+                if (values[predecessor].compare_exchange_strong(expected, uint8_t(loss + 1))) {
+                    raiseLongest(loss);
+                }
+            }
+        }
+    }
+
+public:
+    TbGenerator(const TbLayout& layout, const TbCache& cache)
+        : layout(layout), cache(cache), entryCount(2 * layout.sideSize),
+          values(new atomic<uint8_t>[entryCount]), remaining(new atomic<uint8_t>[entryCount]),
+          conversionLoss(new uint8_t[entryCount]), longest(0), overflow(false) {
+    }
+
+    size_t workingBytes() const { return size_t(entryCount) * 3; }
+    int longestMate() const { return longest.load(); }
+
+    /* Fills values with the finished table; false if a distance does not fit the format */
+    bool run(int threads, vector<uint8_t>& result) {
+        parallelFor(entryCount, threads, [this](uint64_t begin, uint64_t end) {
+            for (uint64_t entry = begin; entry < end; entry++) {
+                initialise(entry);
+            }
+        });
+        for (int plies = 0; plies <= longest.load() && plies <= MAX_PLIES; plies++) {
+            uint8_t target = uint8_t(plies + 1);
+            parallelFor(entryCount, threads, [this, plies, target](uint64_t begin, uint64_t end) {
+                for (uint64_t entry = begin; entry < end; entry++) {
+                    if (values[entry].load(memory_order_relaxed) == target) {
+                        propagate(entry, plies);
+                    }
+                }
+            });
+        }
+
+        result.resize(entryCount);
+        for (uint64_t entry = 0; entry < entryCount; entry++) {
+            uint8_t value = values[entry].load(memory_order_relaxed);
+            result[entry] = value == VALUE_UNKNOWN ? VALUE_DRAW : value;
+        }
+        return !overflow.load();
+    }
+};
+
+/* Run-length codes one block; invalid entries join whichever run they fall in */
+static void compressBlock(const uint8_t* values, size_t count, vector<unsigned char>& out) {
+    int runValue = -1, runLength = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint8_t value = values[i];
+        if (value != VALUE_INVALID && runValue >= 0 && value != runValue) {
+            out.push_back(uint8_t(runValue));
+            out.push_back(uint8_t(runLength - 1));
+            runValue = -1;
+            runLength = 0;
+        }
+        if (value != VALUE_INVALID && runValue < 0) {
+            runValue = value;
+        }
+        if (++runLength == 256) {
+            out.push_back(uint8_t(runValue < 0 ? VALUE_DRAW : runValue));
+            out.push_back(255);
+            runValue = -1;
+            runLength = 0;
+        }
+    }
+    if (runLength > 0) {
+        out.push_back(uint8_t(runValue < 0 ? VALUE_DRAW : runValue));
+        out.push_back(uint8_t(runLength - 1));
+    }
+}
+
+/* Writes a table as a header, the block offsets and the compressed blocks; returns the file size, 0 on failure */
+static size_t writeTable(const string& path, const TbLayout& layout, const vector<uint8_t>& values) {
+    uint64_t blockCount = (values.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    vector<uint64_t> offsets;
+    vector<unsigned char> data;
+    for (uint64_t block = 0; block < blockCount; block++) {
+        offsets.push_back(data.size());
+        size_t begin = block * BLOCK_SIZE;
+        compressBlock(values.data() + begin, min<size_t>(BLOCK_SIZE, values.size() - begin), data);
+    }
+    offsets.push_back(data.size());
+
+    TbFileHeader header = {};
+    memcpy(header.magic, FILE_MAGIC, sizeof(header.magic));
+    header.blockSize = BLOCK_SIZE;
+    header.sideSize = layout.sideSize;
+    header.blockCount = blockCount;
+    strncpy(header.material, layout.material.c_str(), sizeof(header.material) - 1);
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) {
+        return 0;
+    }
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1
+        && fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), file) == offsets.size()
+        && fwrite(data.data(), 1, data.size(), file) == data.size();
+    written = fclose(file) == 0 && written;
+    return written ? sizeof(header) + offsets.size() * sizeof(uint64_t) + data.size() : 0;
+}
+
+/* Checks a mapped or loaded file and returns its header, or nullptr if it is not a table. Beyond
+   the header itself, the material must be an ending whose index size the file agrees with, the
+   blocks must cover exactly that index, and the block offsets must rise from block to block and stay
+   inside the file, so a probe never reads past the mapping. Fills in the layout of the material */
+static const TbFileHeader* checkHeader(const unsigned char* bytes, size_t size, TbLayout& layout) {
+    if (size < sizeof(TbFileHeader)) {
+        return nullptr;
+    }
+    const TbFileHeader* header = reinterpret_cast<const TbFileHeader*>(bytes);
+    if (memcmp(header->magic, FILE_MAGIC, sizeof(header->magic)) != 0 || header->blockSize == 0
+        || header->material[sizeof(header->material) - 1] != 0
+        || tbCanonicalMaterial(header->material).empty()
+        || tbCanonicalMaterial(header->material) != header->material) {
+        return nullptr;
+    }
+    parseLayout(header->material, layout);
+    // Compared as a count of words, so (blockCount + 1) * 8 is never computed for a bad count
+    size_t tableBytes = size - sizeof(TbFileHeader);
+    if (header->sideSize != layout.sideSize
+        || header->blockCount != (2 * layout.sideSize + header->blockSize - 1) / header->blockSize
+        || header->blockCount >= tableBytes / sizeof(uint64_t)) {
+        return nullptr;
+    }
+    const uint64_t* offsets = reinterpret_cast<const uint64_t*>(bytes + sizeof(TbFileHeader));
+    uint64_t dataSize = tableBytes - (header->blockCount + 1) * sizeof(uint64_t);
+    for (uint64_t block = 0; block <= header->blockCount; block++) {
+        if (offsets[block] > dataSize || (block > 0 && offsets[block] < offsets[block - 1])) {
+            return nullptr;
+        }
+    }
+    return header;
+}
+
+/* Reads a previously written table back into memory */
+static bool readTable(const string& path, const string& material, TbData& table) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    vector<unsigned char> bytes;
+    unsigned char buffer[65536];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        bytes.insert(bytes.end(), buffer, buffer + read);
+    }
+    fclose(file);
+
+    const TbFileHeader* header = checkHeader(bytes.data(), bytes.size(), table.layout);
+    if (!header || material != header->material) {
+        return false;
+    }
+    const unsigned char* data = bytes.data() + sizeof(TbFileHeader) + (header->blockCount + 1) * sizeof(uint64_t);
+    table.values.clear();
+    table.values.reserve(2 * header->sideSize);
+    const unsigned char* end = bytes.data() + bytes.size();
+    for (const unsigned char* token = data; token + 1 < end; token += 2) {
+        table.values.insert(table.values.end(), size_t(token[1]) + 1, token[0]);
+    }
+    table.values.resize(2 * header->sideSize);
+    return true;
+}
+
+/* Lists the endings one capture or promotion away from a material */
+static set<string> subMaterials(const string& material) {
+    size_t separator = material.find('v');
+    string sides[2] = {material.substr(1, separator - 1), material.substr(separator + 2)};
+    set<string> result;
+    auto add = [&result](const string& white, const string& black) {
+        string sub = tbCanonicalMaterial("K" + white + "vK" + black);
+        if (!sub.empty()) {
+            result.insert(sub);
+        }
+    };
+    for (int colour = 0; colour < 2; colour++) {
+        const string& own = sides[colour];
+        const string& other = sides[colour ^ 1];
+        for (size_t i = 0; i < other.size(); i++) {
+            string captured = other;
+            captured.erase(i, 1);
+            colour == WHITE ? add(own, captured) : add(captured, own);
+        }
+        for (size_t i = 0; i < own.size(); i++) {
+            if (own[i] != 'P') {
+                continue;
+            }
+            for (char promoted : {'Q', 'R', 'B', 'N'}) {
+                string promotedSide = own;
+                promotedSide[i] = promoted;
+                colour == WHITE ? add(promotedSide, other) : add(other, promotedSide);
+                for (size_t j = 0; j < other.size(); j++) {
+                    string captured = other;
+                    captured.erase(j, 1);
+                    colour == WHITE ? add(promotedSide, captured) : add(captured, promotedSide);
+                }
+            }
+        }
+    }
+    return result;
+}
+
+/* Makes a table available in the cache: from its file if present, otherwise by generating it
+   (sub-tables first) and writing the file */
+static bool buildTable(const string& material, const string& directory, int threads, TbCache& cache,
+                       vector<TbGenerationStats>& stats, string& error) {
+    if (cache.count(material)) {
+        return true;
+    }
+    string path = directory + "/" + material + ".ctb";
+    if (readTable(path, material, cache[material])) {
+        return true;
+    }
+    cache.erase(material);
+
+    for (const string& sub : subMaterials(material)) {
+        if (!buildTable(sub, directory, threads, cache, stats, error)) {
+            return false;
+        }
+    }
+
+    auto start = chrono::steady_clock::now();
+    TbData table;
+    parseLayout(material, table.layout);
+    TbGenerator generator(table.layout, cache);
+    size_t workingBytes = generator.workingBytes();
+    for (const auto& loaded : cache) {
+        workingBytes += loaded.second.values.size();
+    }
+    if (!generator.run(threads, table.values)) {
+        error = material + ": a distance to mate exceeds " + to_string(MAX_PLIES) + " plies";
+        return false;
+    }
+    size_t fileBytes = writeTable(path, table.layout, table.values);
+    if (fileBytes == 0) {
+        error = "cannot write " + path;
+        return false;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    stats.push_back({material, 2 * table.layout.sideSize, generator.longestMate(), workingBytes, fileBytes, seconds});
+    cache[material] = move(table);
+    return true;
+}
+
+bool generateTablebase(const string& material, const string& directory, int threads,
+                       vector<TbGenerationStats>& stats, string& error) {
+    string canonical = tbCanonicalMaterial(material);
+    if (canonical.empty()) {
+        error = "invalid material " + material;
+        return false;
+    }
+    initBitboards();
+    TbCache cache;
+    return buildTable(canonical, directory, max(1, threads), cache, stats, error);
+}
+
+/* Constructor */
+Tablebases::Tablebases() : largest(0) {}
+
+/* Destructor */
+Tablebases::~Tablebases() {
+    close();
+}
+
+int Tablebases::open(const string& directory) {
+    close();
+    DIR* folder = opendir(directory.c_str());
+    if (!folder) {
+        return 0;
+    }
+    while (dirent* item = readdir(folder)) {
+        string name = item->d_name;
+        if (name.size() < 5 || name.compare(name.size() - 4, 4, ".ctb") != 0) {
+            continue;
+        }
+        string path = directory + "/" + name;
+        int descriptor = ::open(path.c_str(), O_RDONLY);
+        if (descriptor < 0) {
+            continue;
+        }
+        struct stat info;
+        void* mapping = MAP_FAILED;
+        if (fstat(descriptor, &info) == 0 && info.st_size > 0) {
+            mapping = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_SHARED, descriptor, 0);
+        }
+        ::close(descriptor);
+        if (mapping == MAP_FAILED) {
+            continue;
+        }
+
+        const unsigned char* bytes = static_cast<const unsigned char*>(mapping);
+        TbLayout layout;
+        const TbFileHeader* header = checkHeader(bytes, size_t(info.st_size), layout);
+        if (!header || tables.count(layout.material)) {
+            munmap(mapping, size_t(info.st_size));
+            continue;
+        }
+        const uint64_t* offsets = reinterpret_cast<const uint64_t*>(bytes + sizeof(TbFileHeader));
+        tables[layout.material] = {bytes, size_t(info.st_size), header->sideSize, header->blockSize, offsets,
+                                   reinterpret_cast<const unsigned char*>(offsets + header->blockCount + 1)};
+        largest = max(largest, layout.count);
+    }
+    closedir(folder);
+    return int(tables.size());
+}
+
+void Tablebases::close() {
+    for (auto& entry : tables) {
+        munmap(const_cast<unsigned char*>(entry.second.mapping), entry.second.mappingSize);
+    }
+    tables.clear();
+    largest = 0;
+}
+
+/* Finds the table and index of the position, then walks the runs of the one block holding it */
+bool Tablebases::probe(const ChessGame& game, TbResult& result) const {
+    const Board& board = game.getBoard();
+    if (game.getCastlingRights() || popCount(board.occupied) > TB_MAX_PIECES) {
+        return false;
+    }
+    int side = game.isWhiteToMove() ? WHITE : BLACK;
+    int enPassantSquare = game.getEnPassantSquare();
+    if (enPassantSquare >= 0 && (pawnAttacks[side ^ 1][enPassantSquare] & board.piecesOf(side, PAWN))) {
+        return false;
+    }
+
+    TbPieces position;
+    position.count = 0;
+    for (Bitboard pieces = board.occupied; pieces; ) {
+        int square = popLsb(pieces);
+        position.piece[position.count] = board.squares[square];
+        position.square[position.count++] = square;
+    }
+    if (position.count == 2) {
+        result = {TB_DRAW, 0};
+        return true;
+    }
+
+    int squares[TB_MAX_PIECES];
+    string material = canonicalise(position, side, squares);
+    auto found = tables.find(material);
+    if (found == tables.end()) {
+        return false;
+    }
+    const Table& table = found->second;
+    bool hasPawns = material.find('P') != string::npos;
+    uint64_t entry = side * table.sideSize + encode(position.count, hasPawns, squares);
+
+    // The walk stops at the end of the block: a block whose runs fall short holds no answer
+    uint64_t block = entry / table.blockSize;
+    const unsigned char* token = table.data + table.blockOffsets[block];
+    const unsigned char* blockEnd = table.data + table.blockOffsets[block + 1];
+    uint32_t offset = uint32_t(entry % table.blockSize);
+    uint32_t covered = 0;
+    for (; blockEnd - token >= 2; token += 2) {
+        covered += uint32_t(token[1]) + 1;
+        if (offset < covered) {
+            break;
+        }
+    }
+    if (offset >= covered) {
+        return false;
+    }
+    uint8_t value = token[0];
+    if (value > MAX_PLIES + 1) {
+        return false;
+    }
+    if (value == VALUE_DRAW) {
+        result = {TB_DRAW, 0};
+    } else {
+        int plies = value - 1;
+        result = {(plies & 1) ? TB_WIN : TB_LOSS, plies};
+    }
+    return true;
+}
@@ -0,0 +1,87 @@
+#ifndef TABLEBASE_H
+#define TABLEBASE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class ChessGame;
+
+// Most pieces (kings included) an ending table can hold
+const int TB_MAX_PIECES = 5;
+
+// Win, draw or loss for the side to move
+enum TbOutcome { TB_LOSS = -1, TB_DRAW = 0, TB_WIN = 1 };
+
+// Probe result: outcome and, when decided, plies to mate with best play (0 when already checkmated)
+struct TbResult {
+  TbOutcome outcome;
+  int pliesToMate;
+};
+
+// Figures reported for one generated table
+struct TbGenerationStats {
+  string material;
+  uint64_t positions;  // index entries, both sides to move together
+  int longestMate;     // plies
+  size_t workingBytes; // generator memory while building this table, loaded sub-tables included
+  size_t fileBytes;    // compressed size on disk
+  double seconds;
+};
+
+// Returns the canonical name of an ending such as "KRvKN" (the stronger side as white, pieces ordered
+// queen, rook, bishop, knight, pawn), or an empty string if the name is malformed or has more than
+// TB_MAX_PIECES or fewer than 3 pieces
+string tbCanonicalMaterial(const string& material);
+// Lists the canonical endings with exactly the given number of pieces, kings included
+vector<string> tbMaterialsWithPieces(int pieces);
+
+// Builds the win/draw/loss and distance-to-mate table of one ending by retrograde analysis on the
+// given number of threads and writes it to directory/<material>.ctb. Endings reachable by a capture
+// or promotion are read from the directory when present and generated (and written) first otherwise;
+// each table built is appended to stats. Returns false with a message in error on bad input or a
+// failed write. Castling and en passant are outside the tables, and distances ignore the fifty-move rule
+bool generateTablebase(const string& material, const string& directory, int threads,
+                       vector<TbGenerationStats>& stats, string& error);
+
+// The ending tables of one directory, each memory-mapped and probed in place. A table file is a
+// sequence of independently run-length-coded blocks with an offset index, so a probe decodes at
+// most one block
+class Tablebases {
+private:
+  struct Table {
+    const unsigned char* mapping;
+    size_t mappingSize;
+    uint64_t sideSize;           // index entries per side to move
+    uint32_t blockSize;          // entries per block
+    const uint64_t* blockOffsets; // blockCount + 1 offsets into data
+    const unsigned char* data;
+  };
+  map<string, Table> tables;
+  int largest;
+
+public:
+  Tablebases();
+  ~Tablebases();
+  Tablebases(const Tablebases&) = delete;
+  Tablebases& operator=(const Tablebases&) = delete;
+
+  // Maps every .ctb file in the directory, replacing any tables already open; returns how many were mapped
+  int open(const string& directory);
+  // Unmaps all tables
+  void close();
+  // Number of tables open
+  size_t size() const { return tables.size(); }
+  // Largest piece count covered by an open table, 0 if none
+  int maxPieces() const { return largest; }
+
+  // Looks the position up; returns false if its ending has no table or it has castling rights or
+  // a capturable en passant square. Bare kings are always a draw
+  bool probe(const ChessGame& game, TbResult& result) const;
+};
+
+#endif // TABLEBASE_H
@@ -0,0 +1,120 @@
+#include "TranspositionTable.h"
+
+// Packed data layout: bits 0-15 move, 16-31 score, 32-39 depth + DEPTH_OFFSET, 40-41 bound, 42-47 generation
+static const int DEPTH_OFFSET = 8;
+
+static uint64_t packData(Move move, int score, int depth, Bound bound, uint8_t generation) {
+    return uint64_t(move.data)
+         | uint64_t(uint16_t(int16_t(score))) << 16
+         | uint64_t(uint8_t(depth + DEPTH_OFFSET)) << 32
+         | uint64_t(bound) << 40
+         | uint64_t(generation & 0x3F) << 42;
+}
+
+static int dataDepth(uint64_t data) { return int((data >> 32) & 0xFF) - DEPTH_OFFSET; }
+static Bound dataBound(uint64_t data) { return Bound((data >> 40) & 0x3); }
+static uint8_t dataGeneration(uint64_t data) { return uint8_t((data >> 42) & 0x3F); }
+
+/* Constructor */
+TranspositionTable::TranspositionTable(size_t megabytes) : buckets(nullptr), bucketCount(0), generation(0) {
+    resize(megabytes);
+}
+
+/* Destructor */
+TranspositionTable::~TranspositionTable() {
+    delete[] buckets;
+}
+
+/* Reallocates the table to the largest power-of-two bucket count that fits the budget */
+void TranspositionTable::resize(size_t megabytes) {
+    size_t bytes = (megabytes ? megabytes : 1) * 1024 * 1024;
+    size_t count = 1;
+    while (count * 2 * sizeof(Bucket) <= bytes) {
+        count *= 2;
+    }
+
+    delete[] buckets;
+    buckets = new Bucket[count];
+    bucketCount = count;
+    clear();
+}
+
+/* Empties every entry */
+void TranspositionTable::clear() {
+    for (size_t i = 0; i < bucketCount; i++) {
+        for (int j = 0; j < BUCKET_SIZE; j++) {
+            buckets[i].slots[j].check.store(0, memory_order_relaxed);
+            buckets[i].slots[j].data.store(0, memory_order_relaxed);
+        }
+    }
+    generation.store(0, memory_order_relaxed);
+}
+
+/* Starts a new search generation */
+void TranspositionTable::newSearch() {
+    generation.store((generation.load(memory_order_relaxed) + 1) & 0x3F, memory_order_relaxed);
+}
+
+/* Looks up the key; an entry only counts if its two words XOR back to the key */
+bool TranspositionTable::probe(uint64_t key, TTEntry& entry) const {
+    const Bucket& bucket = bucketFor(key);
+    for (int i = 0; i < BUCKET_SIZE; i++) {
+        uint64_t data = bucket.slots[i].data.load(memory_order_relaxed);
+        uint64_t check = bucket.slots[i].check.load(memory_order_relaxed);
+        if ((check ^ data) == key && dataBound(data) != BOUND_NONE) {
+            entry.bestMove.data = uint16_t(data);
+            entry.score = int16_t(uint16_t(data >> 16));
+            entry.depth = dataDepth(data);
+            entry.bound = dataBound(data);
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Stores a result in the key's bucket */
+void TranspositionTable::store(uint64_t key, Move bestMove, int score, int depth, Bound bound) {
+    Bucket& bucket = bucketFor(key);
+    uint8_t currentGeneration = generation.load(memory_order_relaxed);
+
+    // Prefer the slot already holding this key, otherwise the one worth least:
+    // shallow entries from older searches are replaced first
+    Slot* replace = &bucket.slots[0];
+    int replaceWorth = 1 << 30;
+    for (int i = 0; i < BUCKET_SIZE; i++) {
+        Slot& slot = bucket.slots[i];
+        uint64_t data = slot.data.load(memory_order_relaxed);
+        if ((slot.check.load(memory_order_relaxed) ^ data) == key) {
+            // Keep the previous best move if this result has none
+            if (bestMove == Move()) {
+                bestMove.data = uint16_t(data);
+            }
+            replace = &slot;
+            break;
+        }
+        int age = (currentGeneration - dataGeneration(data)) & 0x3F;
+        int worth = dataBound(data) == BOUND_NONE ? -(1 << 30) : dataDepth(data) - 8 * age;
+        if (worth < replaceWorth) {
+            replaceWorth = worth;
+            replace = &slot;
+        }
+    }
+
+    uint64_t data = packData(bestMove, score, depth, bound, currentGeneration);
+    replace->data.store(data, memory_order_relaxed);
+    replace->check.store(key ^ data, memory_order_relaxed);
+}
+
+/* Approximate occupancy in permille, counting current-generation entries in the first 1000 slots */
+int TranspositionTable::hashfull() const {
+    uint8_t currentGeneration = generation.load(memory_order_relaxed);
+    int used = 0;
+    int sampled = 0;
+    for (size_t i = 0; i < bucketCount && sampled < 1000; i++) {
+        for (int j = 0; j < BUCKET_SIZE && sampled < 1000; j++, sampled++) {
+            uint64_t data = buckets[i].slots[j].data.load(memory_order_relaxed);
+            used += dataBound(data) != BOUND_NONE && dataGeneration(data) == currentGeneration;
+        }
+    }
+    return sampled ? used * 1000 / sampled : 0;
+}
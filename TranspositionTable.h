@@ -0,0 +1,68 @@
+#ifndef TRANSPOSITIONTABLE_H
+#define TRANSPOSITIONTABLE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "Move.h"
+
+using namespace std;
+
+// Kind of bound a stored score represents
+enum Bound : uint8_t { BOUND_NONE, BOUND_UPPER, BOUND_LOWER, BOUND_EXACT };
+
+// Decoded contents of a table entry
+struct TTEntry {
+  Move bestMove;
+  int score;
+  int depth;
+  Bound bound;
+};
+
+// Fixed-size hash table of search results keyed by Zobrist key.
+// Entries are grouped four to a 64-byte bucket. Each entry is two 64-bit words, the packed data and
+// (key ^ data), written without locks; a reader only accepts an entry whose words XOR back to its
+// key, so an entry torn by a concurrent writer is simply treated as a miss.
+class TranspositionTable {
+private:
+  struct Slot {
+    atomic<uint64_t> check; // key ^ data
+    atomic<uint64_t> data;  // move | score | depth | bound | generation
+  };
+
+  static const int BUCKET_SIZE = 4;
+  struct alignas(64) Bucket {
+    Slot slots[BUCKET_SIZE];
+  };
+
+  Bucket* buckets;
+  size_t bucketCount;      // always a power of two
+  atomic<uint8_t> generation; // age of the current search, used to prefer replacing stale entries
+
+  Bucket& bucketFor(uint64_t key) const { return buckets[key & (bucketCount - 1)]; }
+
+public:
+  // Creates a table using roughly the given number of megabytes
+  explicit TranspositionTable(size_t megabytes = 16);
+  ~TranspositionTable();
+
+  TranspositionTable(const TranspositionTable&) = delete;
+  TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+  // Reallocates the table (not safe while other threads are using it)
+  void resize(size_t megabytes);
+  // Empties every entry (not safe while other threads are using it)
+  void clear();
+  // Starts a new search generation so older entries are replaced first
+  void newSearch();
+
+  // Looks up the key; returns true and fills entry on a verified hit
+  bool probe(uint64_t key, TTEntry& entry) const;
+  // Stores a result, replacing the same key or the shallowest/oldest entry in the bucket
+  void store(uint64_t key, Move bestMove, int score, int depth, Bound bound);
+
+  // Approximate occupancy in permille, sampled from the first buckets
+  int hashfull() const;
+};
+
+#endif // TRANSPOSITIONTABLE_H
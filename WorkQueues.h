@@ -0,0 +1,107 @@
+#ifndef WORK_QUEUES_H
+#define WORK_QUEUES_H
+
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+
+/* Queues for the reader -> workers -> in-order writer pipelines of the batch tools. Chunk is the
+   unit of input work, Result what a worker makes of it; both are numbered by a sequence that counts
+   from 0 in input order */
+
+/* Bounded queue between the reader and the workers; close() wakes everyone up at end of input */
+template <typename Chunk>
+class ChunkQueue {
+private:
+	std::deque<Chunk> chunks;
+	size_t capacity;
+	bool closed = false;
+	std::mutex mutex;
+	std::condition_variable notEmpty, notFull;
+
+public:
+	explicit ChunkQueue(size_t capacity) : capacity(capacity) {}
+
+	/* Blocks while the queue is full */
+	void push(Chunk&& chunk) {
+		std::unique_lock<std::mutex> lock(mutex);
+		notFull.wait(lock, [&] { return chunks.size() < capacity; });
+		chunks.push_back(std::move(chunk));
+		notEmpty.notify_one();
+	}
+
+	/* Blocks until a chunk is available; returns false once the queue is closed and drained */
+	bool pop(Chunk& chunk) {
+		std::unique_lock<std::mutex> lock(mutex);
+		notEmpty.wait(lock, [&] { return !chunks.empty() || closed; });
+		if (chunks.empty()) {
+			return false;
+		}
+		chunk = std::move(chunks.front());
+		chunks.pop_front();
+		notFull.notify_one();
+		return true;
+	}
+
+	void close() {
+		std::lock_guard<std::mutex> lock(mutex);
+		closed = true;
+		notEmpty.notify_all();
+	}
+};
+
+/* Collects finished chunks so the writer can emit them in input order. Only a window of capacity
+   chunks past the next one to be written is held: a worker that finishes further ahead waits for the
+   writer to catch up, so a slow chunk (or a slow output) cannot make the queue grow without bound.
+   This cannot deadlock, as the chunk the writer waits for was handed out before any chunk past it
+   and is always inside the window */
+template <typename Result>
+class ResultQueue {
+private:
+	std::map<size_t, Result> finished;
+	size_t capacity;
+	size_t nextToTake = 0;
+	size_t chunkCount = 0;
+	bool countKnown = false;
+	std::mutex mutex;
+	std::condition_variable changed, taken;
+
+public:
+	explicit ResultQueue(size_t capacity) : capacity(capacity > 0 ? capacity : 1) {}
+
+	/* Blocks while the chunk is too far ahead of the writer */
+	void put(size_t sequence, Result&& chunk) {
+		std::unique_lock<std::mutex> lock(mutex);
+		taken.wait(lock, [&] { return sequence < nextToTake + capacity; });
+		finished.emplace(sequence, std::move(chunk));
+		changed.notify_all();
+	}
+
+	/* Called by the reader once the total number of chunks is known */
+	void setChunkCount(size_t count) {
+		std::lock_guard<std::mutex> lock(mutex);
+		chunkCount = count;
+		countKnown = true;
+		changed.notify_all();
+	}
+
+	/* Blocks until the chunk with the given sequence number is done; returns false past the last chunk.
+	   Chunks must be taken in sequence order */
+	bool take(size_t sequence, Result& chunk) {
+		std::unique_lock<std::mutex> lock(mutex);
+		changed.wait(lock, [&] { return finished.count(sequence) || (countKnown && sequence >= chunkCount); });
+		auto it = finished.find(sequence);
+		if (it == finished.end()) {
+			return false;
+		}
+		chunk = std::move(it->second);
+		finished.erase(it);
+		nextToTake = sequence + 1;
+		taken.notify_all();
+		return true;
+	}
+};
+
+#endif // WORK_QUEUES_H
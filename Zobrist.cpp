@@ -0,0 +1,49 @@
+#include "Zobrist.h"
+
+uint64_t zobristPieces[12][64];
+uint64_t zobristBlackToMove;
+uint64_t zobristCastling[16];
+uint64_t zobristEnPassant[8];
+
+// splitmix64 generator with a fixed seed, so keys are identical across runs and processes
+static uint64_t nextKey(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Generates every key once
+static bool buildKeys() {
+    uint64_t state = 0x5A4F425249535431ULL;
+    for (int piece = 0; piece < 12; piece++) {
+        for (int square = 0; square < 64; square++) {
+            zobristPieces[piece][square] = nextKey(state);
+        }
+    }
+    zobristBlackToMove = nextKey(state);
+
+    // One key per castling right; each mask entry is the XOR of the rights it contains
+    uint64_t rightKeys[4];
+    for (int right = 0; right < 4; right++) {
+        rightKeys[right] = nextKey(state);
+    }
+    for (int mask = 0; mask < 16; mask++) {
+        zobristCastling[mask] = 0;
+        for (int right = 0; right < 4; right++) {
+            if (mask & (1 << right)) {
+                zobristCastling[mask] ^= rightKeys[right];
+            }
+        }
+    }
+    for (int file = 0; file < 8; file++) {
+        zobristEnPassant[file] = nextKey(state);
+    }
+    return true;
+}
+
+// Builds the key tables once; the function-local static makes this thread safe
+void initZobrist() {
+    static const bool initialised = buildKeys();
+    (void)initialised;
+}
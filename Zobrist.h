@@ -0,0 +1,17 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include <cstdint>
+
+using namespace std;
+
+// Random keys XORed together to form a 64-bit position key
+extern uint64_t zobristPieces[12][64]; // indexed by pieceIndex() and square
+extern uint64_t zobristBlackToMove;    // included when black is to move
+extern uint64_t zobristCastling[16];   // indexed by the castling rights mask, 0 for no rights
+extern uint64_t zobristEnPassant[8];   // indexed by file, included only when the capture is possible
+
+// Fills the key tables with fixed pseudo-random numbers; safe to call more than once and from several threads
+void initZobrist();
+
+#endif // ZOBRIST_H